@@ -1,6 +1,7 @@
 #include "actions.h"
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <fstream>
 #include <sstream>
@@ -8,6 +9,10 @@
 #include <queue>
 #include <regex>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <chrono>
 
 #include "filesystem.h"
 #include "configstring/configstring.h"
@@ -21,6 +26,26 @@
 
 #include "third_party/matchOS.h"
 #include "testing_files.h"
+#include "dependencies.h"
+#include "executor.h"
+#include "fingerprints.h"
+#include "precompiled.h"
+#include "unity.h"
+#include "hashing.h"
+#include "objectcache.h"
+#include "threadpool.h"
+#include "timings.h"
+#include "filewatch.h"
+#include "buildserver.h"
+#include "jobserver.h"
+
+#ifdef WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
 
 using namespace std;
 using namespace console;
@@ -29,12 +54,27 @@ namespace colors = formatting::colors::fg;
 namespace fmt = formatting;
 namespace fs = FILESYSTEM_NAMESPACE;
 
-/// @brief Gets the directory for different build types (NORMAL => "build", TEST => "test")
-std::string get_build_dir(const BuildType TYPE) {
-	switch(TYPE) {
-		case BuildType::TEST: return "test";
-		default: return "build";
+/// @brief Gets the directory holding every build profile: $COG_BUILD_DIR, else build.dir from CONFIG, else "build"
+std::string get_build_root(const configstring::ConfigObject &CONFIG) {
+	const string OVERRIDE = commands::get_env_var("COG_BUILD_DIR");
+	if(!OVERRIDE.empty()) {
+		return dependencies::normalize_path(OVERRIDE);
 	}
+	string root = "build";
+	get_optional_string_from_config(CONFIG, "build.dir", root);
+	return dependencies::normalize_path(root);
+}
+
+/// @brief Gets the object file path in BUILD_DIR for the C++ source file at FILE (src/a/b.cpp => BUILD_DIR/a/b.o, BUILD_DIR/c.cpp => BUILD_DIR/c.o)
+std::string get_object_path(const std::string FILE, const std::string BUILD_DIR) {
+	string relative = dependencies::normalize_path(FILE);
+	if(relative.rfind("src/", 0) == 0) {
+		relative = relative.substr(4);
+	} else if(relative.rfind(BUILD_DIR + "/", 0) == 0) {
+		// Generated sources (like __Testing__.cpp) already live in BUILD_DIR
+		relative = relative.substr(BUILD_DIR.length() + 1);
+	}
+	return BUILD_DIR + "/" + relative.substr(0, relative.length() - fs::path(relative).extension().string().length()) + ".o";
 }
 
 /// @brief Make a new project called NAME in a new folder called NAME. A default main.cpp and project.cfg is generated
@@ -47,7 +87,6 @@ void create_new_project(const std::string NAME) {
 
 	files::fwrite(NAME + "/.gitignore",
 R"""(build
-test
 )"""
 	);
 
@@ -61,6 +100,12 @@ project.author=You!;
 #cpp.version=11;
 #cpp.strict=true;
 #cpp.static=false;
+#cpp.pch=auto;
+
+# Profile Settings;
+#profile.release.opt-level=3;
+#profile.release.lto=true;
+#profile.release.march=native;
 
 #which.cpp=g++;
 #which.make=make;
@@ -90,39 +135,54 @@ int main() {
 )""");
 }
 
-/// @brief For the C++ source file at FILE, recursively get all dependencies for make to watch timestamps
-std::string get_make_dependencies(const FILESYSTEM_NAMESPACE::path FILE) {
-	string line;
-	string rule = FILE.stem().string() + ".o: " + FILE.string();
-	queue<fs::path> dependencies;
-	dependencies.push(FILE);
-
-	// BFS for #includes branching out from FILE
-	while (!dependencies.empty())  {  
-		const fs::path NEXT = dependencies.front();
-		dependencies.pop();
-
-		ifstream file(NEXT.string());
-		if(file.fail()) {
-			eprintlnf("%sCould not access file %s%s", colors::YELLOW, NEXT.string().c_str(), colors::REVERT);
-			continue;
-		}
+/// @brief For the C++ source file at FILE, get the make rule for its object in BUILD_DIR listing every file it depends on (GRAPH must already contain FILE)
+std::string get_make_dependencies(const dependencies::IncludeGraph &GRAPH, const std::string FILE, const std::string BUILD_DIR) {
+	string rule = get_object_path(FILE, BUILD_DIR) + ": " + dependencies::normalize_path(FILE);
+	for(const string &DEPENDENCY : GRAPH.closure(FILE)) {
+		rule += " " + DEPENDENCY;
+	}
+	return rule;
+}
 
-		// Search for #include "..." but ignore #include <...> since only user files should need to be compiled
-		// Note that #includes in multiline comments may still be grabbed. 
-		while (getline(file, line)) {
-			regex pattern("^#include\\s+\"([^\"]+)\"$");
-			smatch matches;
-			string trimmed = configstring::stringlib::str_trim(line);
-			if(regex_search(trimmed, matches, pattern)) {
-				const string INCLUDE_TARGET = FILE.parent_path().string() + "/" + matches[1].str(); // match 0 is always the whole match
-				rule += " " + INCLUDE_TARGET;
-				dependencies.push(INCLUDE_TARGET);
-			}
+namespace {
+	/// @brief Joins ARGS into a string for a makefile recipe (quoted for the shell with $ escaped for make)
+	string join_for_make(const vector<string> &ARGS) {
+		string result;
+		for(const string &ARG : ARGS) {
+			result += " " + configstring::stringlib::str_replace(commands::shell_quote(ARG), "$", "$$");
 		}
-		file.close();
+		return result;
 	}
-	return rule;
+}
+
+/// @brief Gets the makefile that links TARGET from OBJECT_FILES (each path preceded by a space) with CXX, compiling sources in src and BUILD_DIR into BUILD_DIR.
+/// The flags are quoted for the shell, and RULES (like the dependencies of each object) are added at the end. TARGET is not quoted, make would take the quotes as part of the name and relink every time
+std::string get_makefile(const std::string &BUILD_DIR, const std::string &TARGET, const std::string &CXX, const std::string &OBJECT_FILES, const std::vector<std::string> &COMPILE_FLAGS,
+	const std::vector<std::string> &FORCE_INCLUDE_FLAGS, const std::vector<std::string> &PKG_COMPILE_FLAGS, const std::vector<std::string> &LINK_FLAGS, const std::string &RULES) {
+	return string("# autogenerated makefile\n")
++ "TARGET = " + commands::escape_spaces(TARGET) + "\n"
++ "OBJECTS =" + configstring::stringlib::str_replace(OBJECT_FILES, "\\", "/") + "\n"
++ "CXX = " + CXX + "\n"
++ "CFLAGS =" + join_for_make(COMPILE_FLAGS) + "\n"
++ "INCLUDES =" + join_for_make(FORCE_INCLUDE_FLAGS) + R"""(
+
+ifeq ($(shell echo "Windows"), "Windows")
+	TARGET := $(TARGET).exe
+endif
+)""" + MAKE_MATCH_OS + R"""(
+
+all: $(TARGET)
+
+$(TARGET): $(OBJECTS)
+	@$(CXX) -o $@ $^)""" + join_for_make(LINK_FLAGS) + R"""(
+
+)""" + BUILD_DIR + R"""(/%.o: src/%.cpp
+	@$(CXX) $(CFLAGS) $(INCLUDES) -o $@ -c $<)""" + join_for_make(PKG_COMPILE_FLAGS) + R"""(
+
+)""" + BUILD_DIR + R"""(/%.o: )""" + BUILD_DIR + R"""(/%.cpp
+	@$(CXX) $(CFLAGS) $(INCLUDES) -o $@ -c $<)""" + join_for_make(PKG_COMPILE_FLAGS) + R"""(
+
+)""" + RULES;
 }
 
 /// @brief Print cog's help message
@@ -173,386 +233,1805 @@ Usage:
 		Cog Options:
 			-x --no-default-features	Disable any default project features
 			-F <V> --feature <V>		Enables project feature V and any dependencies
+			-j <N> --jobs <N>		Run up to N compiles at once
 		Tests:
 			If any test names are listed after the --, only those are run
 
-	cog build [cog options...]
+	cog cache <stats|clear>
+
+		Shows statistics for or empties the object cache shared by every project
+
+	cog gc [days]
+
+		Removes build profile directories that have not been built in the last days days (7 by default).
+		The most recently built debug, release, and test profiles are always kept
+
+	cog build [cog options...] -- [training options...]
 	cog run [cog options...] -- [project options...]
 
-		Looks for a project.cfg file, builds the project, and runs it
+		Looks for a project.cfg file, builds the project, and runs it. In a directory with a workspace.cfg instead,
+		build builds every workspace member (only -r and -j apply there)
 		Cog Options:
-			-r --release        		Do not set the DEBUG macro and force rebuild
+			-r --release        		Build the optimized release profile (see profile.release.xxx)
 			-x --no-default-features	Disable any default project features
 			-F <V> --feature <V>		Enables project feature V and any dependencies
+			-j <N> --jobs <N>		Run up to N compiles at once
+			--pgo               		(build only) Build an instrumented release binary, run it to collect a profile, and rebuild optimized with it
+			--pgo-test          		(build only) Like --pgo but collect the profile by running the project's tests
+			--pgo-use           		(build only) Rebuild optimized with the last collected profile without collecting a new one
+			--timings           		(build only) Write how long each step took to timings.json and timings.html in the profile directory
+			--time-report       		(build only) Like --timings but also include the compiler's own time report for each compile
 		Project Options:
-			Any arguments placed after -- are sent to the target project instead of being interpreted by cog
+			Any arguments placed after -- are sent to the target project instead of being interpreted by cog.
+			With --pgo they are used for the training run (and with --pgo-test they name the tests to run)
+
+	cog daemon [start|stop|status|serve]
+
+		Starts (or stops, or shows) a build server for the project that keeps its config, flags, and include graph in memory, which
+		cog build, cog run, and cog test then use. serve runs it in the foreground. Set build.daemon=true to start it on the first build
+
+	cog watch [build|run|test] [cog options...] -- [project options...]
+
+		Builds the project (build by default), then rebuilds it whenever a file in src or packages or project.cfg changes until stopped with Ctrl+C.
+		With run or test, the project or its tests are restarted after each rebuild that changed them.
+		Takes the same options as cog run (or cog test). Only supported on Linux
 )""", VERSION);
 }
 
-/// @brief Build the project from the given config settings and set debug mode (defines the DEBUG macro for the project if true)
-void build(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const configstring::ConfigObject CONFIG) {
-	std::string BUILD_DIR = get_build_dir(TYPE);
+namespace {
+	/// @brief Written to every profile directory on each build, see collect_garbage
+	const string PROFILE_LOCK_FILE = "profile.lock", PROFILE_LOCK_KEY = "profile.name", FEATURES_LOCK_KEY = "profile.features";
+
+	/// @brief Fingerprints of the commands that built each output in a profile directory, see fingerprints::CommandLog
+	const string COMMAND_LOG_NAME = "commands.cache";
+
+	/// @brief Stats of every input of the last successful build in a profile directory, see fingerprints::StatManifest
+	const string MANIFEST_NAME = "manifest.cache";
+
+	/// @brief Inputs modified this long before a build started are not trusted to be in its outputs, since file times lag behind the clock
+	const long long MANIFEST_MARGIN_NS = 50000000;
+
+	/// @brief Written next to profile data (.gcda files) for --pgo: which sources it was collected for, how, and (in the optimized profile) a digest of the data in use
+	const string PGO_LOCK_FILE = "pgo.lock", PGO_SOURCES_KEY = "pgo.sources", PGO_TRAINING_KEY = "pgo.training", PGO_DATA_KEY = "pgo.data";
+
+	/// @brief Lists the member directories of a workspace, see build_workspace
+	const string WORKSPACE_FILE = "workspace.cfg", WORKSPACE_MEMBERS_KEY = "workspace.members", WORKSPACE_DEPENDS_KEY = "workspace.depends";
+
+
+	/// @brief Names a directory where pkg-config results are shared by the members of a workspace build
+	const string PKG_CONFIG_CACHE_VARIABLE = "COG_PKG_CONFIG_CACHE";
+
+	/// @brief Written to every profile directory that uses packages: the last question asked of pkg-config and its answer, see make_plan
+	const string PKG_CONFIG_RESULT_FILE = "pkg-config.cache";
+
+	/// @brief Directory in the object cache directory holding what tools printed, see read_tool_output
+	const string TOOLS_CACHE_DIR = "tools";
+
+	/// @brief How long watch waits for more changes after the first before rebuilding
+	const int WATCH_DEBOUNCE_MS = 100;
+
+	/// @brief Everything needed to compile and link the project once its config has been resolved. Every field that changes the outputs is part of get_plan_fingerprint
+	struct BuildPlan {
+		string buildDir;
+		/// @brief Path of the executable to produce (without .exe)
+		string target;
+		string whichCPP, whichMake;
+		/// @brief What `which.cpp --version` printed, part of every object cache key
+		string compilerIdentity;
+		/// @brief Flags given to every compile before -o and -c
+		vector<string> compileFlags;
+		/// @brief -include flags given to every compile after compileFlags (but not to the precompiled header)
+		vector<string> forceIncludeFlags;
+		/// @brief Header to precompile (relative to the project), "auto" to pick the headers most sources include, or empty for none
+		string pch;
+		/// @brief Number of unity sources to combine the sources into (0 to compile each on its own)
+		size_t unity = 0;
+		/// @brief Sources and directories compiled on their own even in unity builds
+		vector<string> unityExcludes;
+		/// @brief Flags given to every compile after the source file
+		vector<string> pkgCompileFlags;
+		/// @brief Flags given to the link after the objects
+		vector<string> linkFlags;
+		bool test = false;
+		bool compilerDeps = false;
+		/// @brief Share compiled objects through the object cache (native backend only)
+		bool cache = false;
+		/// @brief Number of compiles to run at once
+		size_t jobs = 1;
+		/// @brief "native" or "make"
+		string backend = "native";
+		PgoPhase pgo = PgoPhase::OFF;
+		/// @brief Digest of every file in src when the plan was made (profile guided builds only)
+		string sourcesFingerprint;
+	};
+
+	/// @brief How a profile optimizes, from the profile.<name>.xxx keys in project config
+	struct Profile {
+		/// @brief One of 0, 1, 2, 3, s, z, or g
+		string optLevel = "0";
+		bool lto = false;
+		/// @brief 0 for none up to 3 for everything including macros
+		int debuginfo = 3;
+		/// @brief CPU to generate code for (-march), empty for the compiler's default
+		string march = "";
+		/// @brief Number of partitions link time optimization splits the program into, 0 for the compiler's default
+		size_t codegenUnits = 0;
+		bool strip = false;
+		bool gcSections = false;
+	};
+
+	/// @brief Default settings for profile NAME: release is optimized and stripped, everything else is unoptimized with full debug info
+	Profile get_default_profile(const string &NAME) {
+		Profile profile;
+		if(NAME == "release") {
+			profile.optLevel = "3";
+			profile.lto = true;
+			profile.debuginfo = 0;
+			profile.strip = true;
+			profile.gcSections = true;
+		}
+		return profile;
+	}
+
+	/// @brief Overrides settings in profile with any profile.NAME.xxx keys in CONFIG
+	void read_profile(const configstring::ConfigObject &CONFIG, const string &NAME, Profile &profile) {
+		const string PREFIX = "profile." + NAME + ".";
+
+		// Numbers and strings are both accepted so opt-level=3 and opt-level=s both work
+		const string OPT_LEVEL_KEY = PREFIX + "opt-level";
+		if(CONFIG.has(OPT_LEVEL_KEY)) {
+			string value = "";
+			if(CONFIG.is<double>(OPT_LEVEL_KEY)) {
+				value = format("%g", CONFIG.get<double>(OPT_LEVEL_KEY));
+			} else {
+				get_string_from_config(CONFIG, OPT_LEVEL_KEY, value);
+			}
+			if(value != "0" && value != "1" && value != "2" && value != "3" && value != "s" && value != "z" && value != "g") {
+				throw runtime_error(format("\"%s\" in project config must be 0, 1, 2, 3, s, z, or g but was \"%s\"", commands::escape_quotes(OPT_LEVEL_KEY).c_str(), commands::escape_quotes(value).c_str()));
+			}
+			profile.optLevel = value;
+		}
+
+		// Booleans are accepted as none or full debug info
+		const string DEBUGINFO_KEY = PREFIX + "debuginfo";
+		if(CONFIG.has(DEBUGINFO_KEY)) {
+			if(CONFIG.is<bool>(DEBUGINFO_KEY)) {
+				profile.debuginfo = CONFIG.get<bool>(DEBUGINFO_KEY) ? 3 : 0;
+			} else {
+				double value = 0;
+				get_double_from_config(CONFIG, DEBUGINFO_KEY, value);
+				if(value != 0 && value != 1 && value != 2 && value != 3) {
+					throw runtime_error(format("\"%s\" in project config must be a bool or 0, 1, 2, or 3", commands::escape_quotes(DEBUGINFO_KEY).c_str()));
+				}
+				profile.debuginfo = (int)value;
+			}
+		}
 
-	files::mkdir(BUILD_DIR);
+		double codegenUnits = profile.codegenUnits;
+		get_optional_double_from_config(CONFIG, PREFIX + "codegen-units", codegenUnits);
+		if(codegenUnits < 0) {
+			throw runtime_error(format("\"%s\" in project config must not be negative", commands::escape_quotes(PREFIX + "codegen-units").c_str()));
+		}
+		profile.codegenUnits = (size_t)codegenUnits;
 
-	if(TYPE == BuildType::TEST) {
-		files::fwrite(BUILD_DIR + "/__Testing__.hpp", __TESTING__HPP);
-		files::fwrite(BUILD_DIR + "/__Testing__.cpp", __TESTING__CPP);
+		get_optional_bool_from_config(CONFIG, PREFIX + "lto", profile.lto);
+		get_optional_string_from_config(CONFIG, PREFIX + "march", profile.march);
+		get_optional_bool_from_config(CONFIG, PREFIX + "strip", profile.strip);
+		get_optional_bool_from_config(CONFIG, PREFIX + "gc-sections", profile.gcSections);
 	}
 
-	// Get project settings
-	// version and author can be omitted while name is required
-	string projectName, projectVersion = "1.0", projectAuthor = "anonymous";
-	get_string_from_config(CONFIG, "project.name", projectName);
-	files::validate_fname(projectName);
-	get_optional_version_from_config(CONFIG, "project.version", projectVersion);
-	get_optional_string_from_config(CONFIG, "project.author", projectAuthor);
+	/// @brief Finds every C++ source file in src, in a stable order
+	vector<string> find_sources() {
+		vector<string> sources;
+		for(const auto &entry : fs::recursive_directory_iterator("src")) {
+			if(!fs::is_directory(entry)) {
+				const auto PATH = entry.path();
+				if(PATH.extension() == ".cpp") {
+					sources.push_back(dependencies::normalize_path(PATH.string()));
+				}
+			}
+		}
+		sort(sources.begin(), sources.end());
+		return sources;
+	}
 
-	// All can be omitted
-	string whichCPP = "g++", whichMake = "make", whichPkgConfig = "pkg-config";
-	get_optional_string_from_config(CONFIG, "which.cpp", whichCPP);
-	get_optional_string_from_config(CONFIG, "which.make", whichMake);
-	get_optional_string_from_config(CONFIG, "which.pkg-config", whichPkgConfig);
+	/// @brief Paths (relative to DIR) of every profile data file in DIR, in a stable order
+	vector<string> find_profile_data(const string &DIR) {
+		vector<string> data;
+		if(!fs::is_directory(DIR)) {
+			return data;
+		}
+		for(const auto &entry : fs::recursive_directory_iterator(DIR)) {
+			if(!fs::is_directory(entry) && entry.path().extension() == ".gcda") {
+				data.push_back(dependencies::normalize_path(fs::relative(entry.path(), DIR).string()));
+			}
+		}
+		sort(data.begin(), data.end());
+		return data;
+	}
 
+	/// @brief Digest of the path and content of every file in src, profile data is only used for the sources it was collected from
+	string get_sources_fingerprint() {
+		vector<string> paths;
+		for(const auto &entry : fs::recursive_directory_iterator("src")) {
+			if(!fs::is_directory(entry)) {
+				paths.push_back(dependencies::normalize_path(entry.path().string()));
+			}
+		}
+		sort(paths.begin(), paths.end());
+
+		vector<files::FileStat> stats;
+		vector<files::MappedFile> contents;
+		files::read_all(paths, stats, contents);
+		hashing::Hasher hasher;
+		for(size_t i = 0; i < paths.size(); i++) {
+			if(!stats[i].exists) {
+				throw runtime_error(format("Error reading file \"%s\"", commands::escape_quotes(paths[i]).c_str()));
+			}
+			hasher.add(paths[i]).add(contents[i].view());
+		}
+		return hasher.digest();
+	}
 
-	commands::assert_command_exists(whichCPP, "cpp");
-	commands::assert_command_exists(whichMake, "make");
+	/// @brief Copies the profile data collected in INSTRUMENTED_DIR next to the objects in BUILD_DIR and returns how it was collected ("run" or "test").
+	/// Throws if nothing was collected or it was collected from other sources than FINGERPRINT. New data makes everything in BUILD_DIR rebuild
+	string use_profile_data(const string &BUILD_DIR, const string &INSTRUMENTED_DIR, const string &FINGERPRINT) {
+		const string INSTRUMENTED_LOCK = INSTRUMENTED_DIR + "/" + PGO_LOCK_FILE;
+		const vector<string> DATA = find_profile_data(INSTRUMENTED_DIR);
+		if(!files::fexists(INSTRUMENTED_LOCK) || DATA.empty()) {
+			throw runtime_error("No profile data has been collected yet, collect some with \"cog build --pgo\" or \"cog build --pgo-test\"");
+		}
 
-	bool cppStrict = false, cppStatic = false;
-	get_optional_bool_from_config(CONFIG, "cpp.strict", cppStrict);
-	get_optional_bool_from_config(CONFIG, "cpp.static", cppStatic);
+		string sources = "", training = "run";
+		const configstring::ConfigObject INSTRUMENTED_CONFIG = configstring::parse(files::load(INSTRUMENTED_LOCK).view());
+		get_optional_string_from_config(INSTRUMENTED_CONFIG, PGO_SOURCES_KEY, sources);
+		get_optional_string_from_config(INSTRUMENTED_CONFIG, PGO_TRAINING_KEY, training);
+		if(sources != FINGERPRINT) {
+			throw runtime_error(format("Profile data in \"%s\" is stale since files in src changed after it was collected, collect it again with \"cog build --pgo\" or \"cog build --pgo-test\"", commands::escape_quotes(INSTRUMENTED_DIR).c_str()));
+		}
 
-	double cppVersion = 11;
-	get_optional_double_from_config(CONFIG, "cpp.version", cppVersion);
+		// gcc looks for each object's data next to it
+		error_code error;
+		for(const string &FILE : find_profile_data(BUILD_DIR)) {
+			fs::remove(BUILD_DIR + "/" + FILE, error);
+		}
+		hashing::Hasher hasher;
+		hasher.add(training);
+		for(const string &FILE : DATA) {
+			fs::create_directories(fs::path(BUILD_DIR + "/" + FILE).parent_path());
+			fs::copy_file(INSTRUMENTED_DIR + "/" + FILE, BUILD_DIR + "/" + FILE, fs::copy_options::overwrite_existing);
+			hasher.add(FILE).add(files::fread(BUILD_DIR + "/" + FILE));
+		}
 
-	struct Pkg {
-		string name;
-		/// @brief One of =, <=, >=
-		string relation = "=";
-		/// @brief Version, * for any
-		string version = "*";
-		///@brief Features can make optional packages required
-		bool required = true;
-	};
+		// The data is not part of any compile command, so forgetting the commands is what rebuilds everything when it changes
+		const string LOCK_FILE = BUILD_DIR + "/" + PGO_LOCK_FILE;
+		string previous = "";
+		if(files::fexists(LOCK_FILE)) {
+			get_optional_string_from_config(configstring::parse(files::load(LOCK_FILE).view()), PGO_DATA_KEY, previous);
+		}
+		if(previous != hasher.digest()) {
+			fs::remove(BUILD_DIR + "/" + COMMAND_LOG_NAME, error);
+
+			configstring::ConfigObject lockConfig;
+			lockConfig.set(PGO_SOURCES_KEY, sources);
+			lockConfig.set(PGO_TRAINING_KEY, training);
+			lockConfig.set(PGO_DATA_KEY, hasher.digest());
+			files::fwrite(LOCK_FILE, lockConfig.stringify());
+		}
+		return training;
+	}
 
-	vector<Pkg> packages;
-	regex pkgPatternLG("^pkg\\??.([a-zA-Z0-9+_-]+)(<|>)$");
-	regex pkgPatternSimple("^pkg\\??.([a-zA-Z0-9+_-]+)$");
-	smatch matches;
-
-	struct Feature {
-		bool enabled = true;
-		/// @brief Circular features allowed, used in BFS
-		bool visited = false;
-		/// @brief Features or packages this depends on
-		vector<string> dependencies;
-	};
+	/// @brief Digest of the stat of every path in PATHS and everything under those that are directories. Changes whenever any of them is edited, added, or removed
+	string get_stats_fingerprint(const vector<string> &PATHS) {
+		hashing::Hasher hasher;
+		const auto ADD = [&hasher](const string &PATH) {
+			const files::FileStat STAT = files::stat(PATH);
+			hasher.add(PATH).add(to_string(STAT.mtime)).add(to_string(STAT.size)).add(to_string(STAT.inode));
+		};
+		for(const string &PATH : PATHS) {
+			ADD(PATH);
+			vector<string> children;
+			error_code error;
+			for(auto it = fs::recursive_directory_iterator(PATH, error); !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+				children.push_back(it->path().string());
+			}
+			// Directory order is not stable
+			sort(children.begin(), children.end());
+			for(const string &CHILD : children) {
+				ADD(CHILD);
+			}
+		}
+		return hasher.digest();
+	}
+
+	/// @brief Fingerprint of the stats of every executable named NAME (see get_stats_fingerprint) in the profile directories in BUILD_ROOT
+	string get_executables_fingerprint(const string &BUILD_ROOT, const string &NAME) {
+		vector<string> executables;
+		error_code error;
+		for(auto it = fs::directory_iterator(BUILD_ROOT, error); !error && it != fs::directory_iterator(); it.increment(error)) {
+			const string EXECUTABLE = it->path().string() + "/" + NAME;
+			if(files::fexists(EXECUTABLE)) {
+				executables.push_back(EXECUTABLE);
+			}
+		}
+		sort(executables.begin(), executables.end());
+		return get_stats_fingerprint(executables);
+	}
 
-	map<string, Feature*> features;
-	string featureFlags = "";
-
-	// Read in features and third party packages from config
-	try {
-		const string PKG_PREFIX = "pkg.", OPTIONAL_PKG_PREFIX = "pkg?.", FEATURE_PREFIX = "feature.", FEATURE_NOTE_SUFFIX = ".notes", FEATURE_REQUIRED_SUFFIX = ".required";
-		regex featurePattern(format("^%s([A-Z0-9_]+)(%s)?$", FEATURE_PREFIX.c_str(), FEATURE_REQUIRED_SUFFIX.c_str()));
-		for(const string &KEY : CONFIG.keys()) {
-			const bool
-				IS_PACKAGE = KEY.length() > PKG_PREFIX.length() && KEY.rfind(PKG_PREFIX,0) == 0,
-				IS_OPTIONAL_PACKAGE = KEY.length() > OPTIONAL_PKG_PREFIX.length() && KEY.rfind(OPTIONAL_PKG_PREFIX,0) == 0,
-				IS_FEATURE = KEY.length() > FEATURE_PREFIX.length() && KEY.rfind(FEATURE_PREFIX,0) == 0,
-				IS_FEATURE_DTL = IS_FEATURE && KEY.length() > FEATURE_PREFIX.length() + FEATURE_REQUIRED_SUFFIX.length() && KEY.substr(KEY.length() - FEATURE_REQUIRED_SUFFIX.length()) == FEATURE_REQUIRED_SUFFIX,
-				IS_FEATURE_NOTE = IS_FEATURE && KEY.length() > FEATURE_PREFIX.length() + FEATURE_NOTE_SUFFIX.length() && KEY.substr(KEY.length() - FEATURE_NOTE_SUFFIX.length()) == FEATURE_NOTE_SUFFIX;
-			if(IS_PACKAGE || IS_OPTIONAL_PACKAGE) {
-				Pkg pkg;
-				if(regex_search(KEY, matches, pkgPatternLG)) {
-					pkg.name = matches[1].str(); // match 0 is always the whole match
-					pkg.relation = matches[2].str() + "=";
-				} else if(regex_match(KEY, pkgPatternSimple)) {
-					pkg.name = KEY.substr(4 + IS_OPTIONAL_PACKAGE);
+	/// @brief Reads what COMMAND printed to stdout when run with ARGS into output, returning false if it failed. Since tools are slow to start and their answers only change
+	/// when they do, the output is remembered in the object cache directory by the real path, size, and modification time of every program COMMAND names
+	bool read_tool_output(const string &COMMAND, const vector<string> &ARGS, string &output) {
+		hashing::Hasher key;
+		key.add(COMMAND);
+		for(const string &ARG : ARGS) {
+			key.add(ARG);
+		}
+		bool found = false;
+		for(const string &WORD : commands::split_args(COMMAND)) {
+			const string PROGRAM = commands::find_program(WORD);
+			if(!PROGRAM.empty()) {
+				const files::FileStat STAT = files::stat(PROGRAM);
+				key.add(PROGRAM).add(to_string(STAT.mtime)).add(to_string(STAT.size)).add(to_string(STAT.inode));
+				found = true;
+			}
+		}
+
+		const string DIR = objectcache::get_cache_dir() + "/" + TOOLS_CACHE_DIR, ENTRY = DIR + "/" + key.digest();
+		if(found && files::fexists(ENTRY)) {
+			output = files::fread(ENTRY);
+			return true;
+		}
+		const auto RESULT = commands::run_and_read(COMMAND, ARGS, true);
+		if(RESULT.status != 0) {
+			return false;
+		}
+		output = RESULT.output;
+		if(found) {
+			// Renamed into place so other builds never read a partial entry
+			error_code error;
+			fs::create_directories(DIR, error);
+			const string TEMPORARY = ENTRY + format(".%i", (int)getpid());
+			files::fwrite(TEMPORARY, output);
+			fs::rename(TEMPORARY, ENTRY, error);
+		}
+		return true;
+	}
+
+	/// @brief What COMMAND --version printed (see read_tool_output), throwing like commands::assert_command_exists if it cannot be run
+	string get_tool_identity(const string &COMMAND, const string &WHICH_KEY) {
+		string output;
+		return read_tool_output(COMMAND, {"--version"}, output) ? output : commands::assert_command_exists(COMMAND, WHICH_KEY);
+	}
+
+	/// @brief The arguments that run EXECUTABLE (a path relative to the project or absolute) with ARGS without a shell
+	vector<string> get_executable_argv(const string &EXECUTABLE, const vector<string> &ARGS) {
+		vector<string> argv = {fs::path(EXECUTABLE).is_absolute() ? EXECUTABLE : "./" + EXECUTABLE};
+		argv.insert(argv.end(), ARGS.begin(), ARGS.end());
+		return argv;
+	}
+
+	/// @brief Runs EXECUTABLE (a path relative to the project or absolute) with ARGS and returns its exit code
+	int run_executable(string executable, const vector<string> &ARGS) {
+#ifdef WINDOWS
+		if(!fs::path(executable).is_absolute()) {
+			executable = "./" + executable;
+		}
+		replace(executable.begin(), executable.end(), '/', '\\');
+		return commands::run(format("\"%s\"", commands::escape_quotes(executable).c_str()), ARGS);
+#else
+		return commands::Process(get_executable_argv(executable, ARGS)).wait();
+#endif
+	}
+
+	/// @brief The sources PLAN compiles (besides __Testing__.cpp): every file in src, or the unity sources and excluded files for unity builds
+	vector<string> get_compile_sources(const BuildPlan &PLAN) {
+		const vector<string> SOURCES = find_sources();
+		if(PLAN.unity == 0) {
+			return SOURCES;
+		}
+		vector<string> separate;
+		vector<string> result = unity::write_batches(SOURCES, PLAN.unity, PLAN.unityExcludes, PLAN.buildDir, separate);
+		result.insert(result.end(), separate.begin(), separate.end());
+		return result;
+	}
+
+	/// @brief Records that a build of PLAN running all of its COMPILES took SECONDS and prints it next to the last full build in the other mode (with or without build.unity)
+	void report_full_build(const BuildPlan &PLAN, const size_t COMPILES, const double SECONDS) {
+		const string TIMES_FILE = PLAN.buildDir + "/build.times", NORMAL_KEY = "normal", UNITY_KEY = "unity";
+		double normal = 0, unity = 0;
+		try {
+			if(files::fexists(TIMES_FILE)) {
+				const configstring::ConfigObject TIMES = configstring::parse(files::load(TIMES_FILE).view());
+				get_optional_double_from_config(TIMES, NORMAL_KEY, normal);
+				get_optional_double_from_config(TIMES, UNITY_KEY, unity);
+			}
+		} catch(const runtime_error &ERR) {
+			// Only the comparison is lost
+		}
+		(PLAN.unity > 0 ? unity : normal) = SECONDS;
+		files::fwrite(TIMES_FILE, format("%s=%.3f;%s=%.3f;", NORMAL_KEY.c_str(), normal, UNITY_KEY.c_str(), unity));
+
+		if(PLAN.unity > 0) {
+			eprintlnf("%sFull unity build (%zu compiles) took %.1fs%s%s", colors::CYAN, COMPILES, SECONDS, normal > 0 ? format(" (%.1fs without build.unity)", normal).c_str() : "", colors::REVERT);
+		} else if(unity > 0) {
+			eprintlnf("%sFull build (%zu compiles) took %.1fs (%.1fs with build.unity)%s", colors::CYAN, COMPILES, SECONDS, unity, colors::REVERT);
+		}
+	}
+
+	/// @brief Writes the header PLAN precompiles to the build directory (only when its text changes, since that rebuilds everything).
+	/// With cpp.pch=auto every source is scanned into graph first, and COMPILE_FLAGS are used to measure header sizes
+	void write_precompiled_header(const BuildPlan &PLAN, dependencies::IncludeGraph &graph, const vector<string> &COMPILE_FLAGS) {
+		timings::Scope scope("Choose precompiled headers", "phase");
+		string text;
+		if(PLAN.pch == "auto") {
+			const vector<string> SOURCES = find_sources();
+			graph.scan(SOURCES);
+			vector<string> flags = COMPILE_FLAGS;
+			flags.insert(flags.end(), PLAN.pkgCompileFlags.begin(), PLAN.pkgCompileFlags.end());
+			text = precompiled::choose_headers(graph, SOURCES, PLAN.whichCPP, flags, PLAN.buildDir);
+		} else {
+			text = dependencies::include_directive(PLAN.pch, PLAN.buildDir);
+		}
+		files::fwrite_if_changed(PLAN.buildDir + "/" + precompiled::HEADER_NAME, text);
+	}
+
+	/// @brief Writes a makefile to PLAN's build directory and runs make on it. GRAPH may be kept from an earlier build of PLAN (see watch)
+	void build_with_make(const BuildPlan &PLAN, dependencies::IncludeGraph &graph) {
+		const vector<string> SOURCES = get_compile_sources(PLAN);
+		const string DEPENDENCY_CACHE_FILE = PLAN.buildDir + "/deps.cache";
+		const string HEADER = PLAN.buildDir + "/" + precompiled::HEADER_NAME, PRECOMPILED = HEADER + ".gch";
+
+		// Files unchanged since the last build reuse their includes from the dependency cache instead of being read
+		const bool USE_GRAPH = !PLAN.compilerDeps || PLAN.pch == "auto";
+		if(USE_GRAPH && graph.size() == 0) {
+			graph.load_cache(DEPENDENCY_CACHE_FILE);
+		}
+		if(!PLAN.pch.empty()) {
+			write_precompiled_header(PLAN, graph, PLAN.compileFlags);
+		}
+
+		string dependencyRules = "", precompileRules = "", objectFiles = "";
+		timings::Scope scanScope("Scan dependencies", "phase");
+		if(PLAN.compilerDeps) {
+			// The compiler records each object's dependencies in a .d file next to it, which make includes on the next run
+			dependencyRules = "-include $(OBJECTS:.o=.d)\n";
+			if(!PLAN.pch.empty()) {
+				dependencyRules += "-include " + HEADER + ".d\n";
+			}
+		} else {
+			// Scan every file once for all sources, then generate dependencies from the shared graph
+			graph.scan(SOURCES);
+			for(const string &SOURCE : SOURCES) {
+				dependencyRules += get_make_dependencies(graph, SOURCE, PLAN.buildDir) + '\n';
+			}
+			if(!PLAN.pch.empty()) {
+				// The header is written by this build, so a graph kept from an earlier build may hold its old includes
+				graph.invalidate({HEADER});
+				graph.scan({HEADER});
+				dependencyRules += PRECOMPILED + ": " + HEADER;
+				for(const string &DEPENDENCY : graph.closure(HEADER)) {
+					dependencyRules += " " + DEPENDENCY;
+				}
+				dependencyRules += '\n';
+			}
+		}
+		if(USE_GRAPH) {
+			graph.save_cache(DEPENDENCY_CACHE_FILE);
+		}
+		scanScope.finish();
+
+		// The precompiled header is built with exactly the flags of the sources using it, otherwise the compiler ignores it
+		if(!PLAN.pch.empty()) {
+			precompileRules = PRECOMPILED + ": " + HEADER + "\n"
+				+ "\t@$(CXX) $(CFLAGS) -x c++-header -o $@ -c $<" + join_for_make(PLAN.pkgCompileFlags) + "\n\n"
+				+ "$(OBJECTS): " + PRECOMPILED + "\n\n";
+		}
+
+		// make only compares times, so outputs whose command changed since they were built are removed to make it rebuild them
+		timings::Scope generateScope("Generate makefile", "phase");
+		const string COMMAND_LOG_FILE = PLAN.buildDir + "/" + COMMAND_LOG_NAME;
+		fingerprints::CommandLog commandLog;
+		commandLog.load(COMMAND_LOG_FILE);
+		if(!PLAN.pch.empty()) {
+			vector<string> args = PLAN.compileFlags;
+			args.insert(args.end(), {"-x", "c++-header", "-o", PRECOMPILED, "-c", HEADER});
+			args.insert(args.end(), PLAN.pkgCompileFlags.begin(), PLAN.pkgCompileFlags.end());
+			const string DIGEST = fingerprints::of(PLAN.whichCPP, args);
+			if(!commandLog.matches(PRECOMPILED, DIGEST)) {
+				error_code error;
+				fs::remove(PRECOMPILED, error);
+				commandLog.record(PRECOMPILED, DIGEST);
+			}
+		}
+
+		// __Testing__.o runs the tests from its .init_array entry, so it has to come after every object registering tests
+		vector<string> objectSources = SOURCES;
+		if(PLAN.test) {
+			objectSources.push_back(PLAN.buildDir + "/__Testing__.cpp");
+		}
+		vector<string> objects;
+		bool full = true;
+		for(const string &SOURCE : objectSources) {
+			const string OBJECT = get_object_path(SOURCE, PLAN.buildDir);
+			fs::create_directories(fs::path(OBJECT).parent_path());
+			vector<string> args = PLAN.compileFlags;
+			args.insert(args.end(), PLAN.forceIncludeFlags.begin(), PLAN.forceIncludeFlags.end());
+			args.insert(args.end(), {"-o", OBJECT, "-c", SOURCE});
+			args.insert(args.end(), PLAN.pkgCompileFlags.begin(), PLAN.pkgCompileFlags.end());
+			const string DIGEST = fingerprints::of(PLAN.whichCPP, args);
+			if(!commandLog.matches(OBJECT, DIGEST)) {
+				error_code error;
+				fs::remove(OBJECT, error);
+				commandLog.record(OBJECT, DIGEST);
+			}
+			full = full && !files::fexists(OBJECT);
+			objects.push_back(OBJECT);
+			objectFiles += " " + OBJECT;
+		}
+		vector<string> linkArgs = {"-o", PLAN.target};
+		linkArgs.insert(linkArgs.end(), objects.begin(), objects.end());
+		linkArgs.insert(linkArgs.end(), PLAN.linkFlags.begin(), PLAN.linkFlags.end());
+		const string LINK_DIGEST = fingerprints::of(PLAN.whichCPP, linkArgs);
+		if(!commandLog.matches(PLAN.target, LINK_DIGEST)) {
+			error_code error;
+			fs::remove(PLAN.target, error);
+			fs::remove(PLAN.target + ".exe", error);
+			commandLog.record(PLAN.target, LINK_DIGEST);
+		}
+		commandLog.save(COMMAND_LOG_FILE);
+
+		// The makefile is only rewritten when it changes
+		files::fwrite_if_changed(PLAN.buildDir + "/makefile", get_makefile(PLAN.buildDir, PLAN.target, PLAN.whichCPP, objectFiles,
+			PLAN.compileFlags, PLAN.forceIncludeFlags, PLAN.pkgCompileFlags, PLAN.linkFlags, precompileRules + dependencyRules));
+
+		generateScope.finish();
+
+		// make runs every compile itself, so only the whole run can be timed
+		timings::Scope makeScope("Run make", "phase");
+		const auto START = chrono::steady_clock::now();
+		// Under a jobserver (like a workspace build) make takes its jobs from it, which an explicit --jobs would turn off
+		vector<string> makeArgs = {"--makefile=" + PLAN.buildDir + "/makefile", "--silent"};
+		if(!jobserver::is_available()) {
+			makeArgs.push_back(format("--jobs=%zu", PLAN.jobs));
+		}
+		const auto MAKE_RESULT = commands::run(PLAN.whichMake, makeArgs);
+		if(MAKE_RESULT != 0) {
+			throw runtime_error("Error running make");
+		}
+		if(full) {
+			report_full_build(PLAN, SOURCES.size(), chrono::duration<double>(chrono::steady_clock::now() - START).count());
+		}
+	}
+
+	/// @brief Compiles and links PLAN with cog's own scheduler. Compiles start as soon as their source is found,
+	/// and each compile scans its own includes (shared with every other compile) right before checking if it is out of date. GRAPH may be kept from an earlier build of PLAN (see watch)
+	void build_natively(const BuildPlan &PLAN, dependencies::IncludeGraph &graph) {
+		const string DEPENDENCY_CACHE_FILE = PLAN.buildDir + "/deps.cache";
+		const bool USE_GRAPH = !PLAN.compilerDeps || PLAN.pch == "auto";
+		if(USE_GRAPH && graph.size() == 0) {
+			graph.load_cache(DEPENDENCY_CACHE_FILE);
+		}
+
+		vector<string> compileFlags = PLAN.compileFlags;
+		for(const string &FLAG : match_os_flags()) {
+			compileFlags.push_back(FLAG);
+		}
+
+		// Cached objects must not depend on where the project is checked out, so debug info paths are made relative
+		unique_ptr<objectcache::ObjectCache> cache;
+		vector<string> cacheKeyFlags;
+		if(PLAN.cache) {
+			cache.reset(new objectcache::ObjectCache());
+			cacheKeyFlags = compileFlags;
+			cacheKeyFlags.insert(cacheKeyFlags.end(), PLAN.forceIncludeFlags.begin(), PLAN.forceIncludeFlags.end());
+			compileFlags.push_back("-fdebug-prefix-map=" + fs::current_path().string() + "=.");
+		}
+
+		// Objects are rebuilt when the exact command that would build them changed, like after editing a flag or enabling a feature
+		const string COMMAND_LOG_FILE = PLAN.buildDir + "/" + COMMAND_LOG_NAME;
+		fingerprints::CommandLog commandLog;
+		commandLog.load(COMMAND_LOG_FILE);
+
+		// True if OUTPUT, compiled from SOURCE by the command with fingerprint DIGEST, is missing, was built differently, or is older than anything SOURCE includes
+		const auto IS_STALE = [&PLAN, &graph, &commandLog](const string &SOURCE, const string &OUTPUT, const string &DEPFILE, const string &DIGEST) {
+			const files::FileStat OUTPUT_STAT = files::stat(OUTPUT);
+			bool stale = !OUTPUT_STAT.exists || !commandLog.matches(OUTPUT, DIGEST);
+			if(PLAN.compilerDeps) {
+				vector<string> prerequisites;
+				if(!stale && dependencies::read_depfile(DEPFILE, prerequisites)) {
+					for(const string &PREREQUISITE : prerequisites) {
+						const files::FileStat STAT = files::stat(PREREQUISITE);
+						stale = stale || !STAT.exists || STAT.mtime > OUTPUT_STAT.mtime;
+					}
 				} else {
-					throw runtime_error(format("Package \"%s\" in project config does not contain a valid package name", commands::escape_quotes(KEY).c_str()));
+					stale = true;
 				}
+			} else {
+				long long newest;
+				graph.require(SOURCE, newest);
+				stale = stale || newest > OUTPUT_STAT.mtime;
+			}
+			return stale;
+		};
+
+		mutex objectsMutex;
+		vector<string> objects;
 
-				if(IS_OPTIONAL_PACKAGE) {
-					pkg.required = false;
+		const string TESTING_SOURCE = PLAN.buildDir + "/__Testing__.cpp";
+
+		const auto COMPILE = [&PLAN, &compileFlags, &cache, &cacheKeyFlags, &commandLog, &COMMAND_LOG_FILE, &IS_STALE, &objectsMutex, &objects, &TESTING_SOURCE](const string SOURCE) {
+			return [&PLAN, &compileFlags, &cache, &cacheKeyFlags, &commandLog, &COMMAND_LOG_FILE, &IS_STALE, &objectsMutex, &objects, &TESTING_SOURCE, SOURCE](const bool DEPENDENCY_BUILT, string &output) {
+				const string OBJECT = get_object_path(SOURCE, PLAN.buildDir);
+				if(SOURCE != TESTING_SOURCE) {
+					lock_guard<mutex> lock(objectsMutex);
+					objects.push_back(OBJECT);
 				}
 
-				if(const auto VALUE = CONFIG.get(KEY)->as<configstring::Null>());
-				else get_optional_version_from_config(CONFIG, KEY, pkg.version);
+				vector<string> args = compileFlags;
+				args.insert(args.end(), PLAN.forceIncludeFlags.begin(), PLAN.forceIncludeFlags.end());
+				args.insert(args.end(), {"-o", OBJECT, "-c", SOURCE});
+				args.insert(args.end(), PLAN.pkgCompileFlags.begin(), PLAN.pkgCompileFlags.end());
+				const string DIGEST = fingerprints::of(PLAN.whichCPP, args);
 
-				packages.push_back(pkg);
-			} else if(IS_FEATURE_DTL) {
-				if(!regex_match(KEY, featurePattern)) {
-					throw runtime_error(format("Feature detail \"%s\" in project config does not contain a valid feature name", commands::escape_quotes(KEY).c_str()));
+				// A rebuilt precompiled header means a header every source includes changed
+				timings::Scope checkScope("Check " + SOURCE, "scan");
+				if(!IS_STALE(SOURCE, OBJECT, OBJECT.substr(0, OBJECT.length() - 2) + ".d", DIGEST) && !DEPENDENCY_BUILT) {
+					return executor::JobResult::UP_TO_DATE;
+				}
+				checkScope.finish();
+				if(!commandLog.matches(OBJECT, DIGEST)) {
+					commandLog.forget(OBJECT, COMMAND_LOG_FILE);
 				}
 
-				const string FEATURE_NAME = KEY.substr(0,KEY.length()-9);
-				Feature* pFeature;
-				auto iter = features.find(FEATURE_NAME);
-				if(iter != features.end()) {
-					pFeature = iter->second;
-				} else {
-					pFeature = new Feature;
-					features.insert({FEATURE_NAME, pFeature});
+				fs::create_directories(fs::path(OBJECT).parent_path());
+
+				// The key covers the compiler, every flag, and the preprocessed source (which also writes the .d file in compiler deps mode).
+				// Preprocessing ignores the precompiled header, so the headers in it are part of the key too
+				string key;
+				if(cache) {
+					timings::Scope cacheScope("Look up " + SOURCE, "cache");
+					vector<string> preprocessArgs = compileFlags;
+					preprocessArgs.insert(preprocessArgs.end(), PLAN.forceIncludeFlags.begin(), PLAN.forceIncludeFlags.end());
+					preprocessArgs.insert(preprocessArgs.end(), {"-fno-working-directory", "-E", SOURCE});
+					if(PLAN.compilerDeps) {
+						preprocessArgs.insert(preprocessArgs.end(), {"-MF", OBJECT.substr(0, OBJECT.length() - 2) + ".d", "-MT", OBJECT});
+					}
+					preprocessArgs.insert(preprocessArgs.end(), PLAN.pkgCompileFlags.begin(), PLAN.pkgCompileFlags.end());
+
+					const auto PREPROCESSED = commands::run_and_read(PLAN.whichCPP, preprocessArgs, true);
+					if(PREPROCESSED.status == 0) {
+						hashing::Hasher hasher;
+						hasher.add(PLAN.compilerIdentity).add(SOURCE);
+						for(const string &FLAG : cacheKeyFlags) {
+							hasher.add(FLAG);
+						}
+						for(const string &FLAG : PLAN.pkgCompileFlags) {
+							hasher.add(FLAG);
+						}
+						key = hasher.add(PREPROCESSED.output).digest();
+						if(cache->fetch(key, OBJECT, output)) {
+							commandLog.record(OBJECT, DIGEST);
+							return executor::JobResult::FETCHED;
+						}
+					}
 				}
 
-				string value = "";
-				get_string_from_config(CONFIG,KEY,value);
-				for(const string &ITEM : configstring::stringlib::str_split(value, (const char)',')) {
-					pFeature->dependencies.push_back(configstring::stringlib::str_trim(ITEM));
+				// The object may be a hard link into the cache, which must not be overwritten in place
+				error_code error;
+				fs::remove(OBJECT, error);
+
+				// The compiler's own time report is left out of the fingerprint and cache key so it does not change what gets rebuilt
+				timings::Scope scope("Compile " + SOURCE, "compile");
+				const bool CLANG = PLAN.compilerIdentity.find("clang") != string::npos;
+				if(timings::wants_compiler_reports()) {
+					args.push_back(CLANG ? "-ftime-trace" : "-ftime-report");
+				}
+				const auto RESULT = commands::run_and_capture(PLAN.whichCPP, args);
+				scope.set_peak_memory(RESULT.peakMemory);
+				output = RESULT.output;
+				if(timings::wants_compiler_reports()) {
+					if(CLANG) {
+						scope.set_details("Trace written to " + OBJECT.substr(0, OBJECT.length() - 2) + ".json");
+					} else {
+						// gcc prints its report after any diagnostics
+						const size_t REPORT = output.rfind("\nTime variable");
+						if(REPORT != string::npos) {
+							scope.set_details(output.substr(REPORT + 1));
+							output = output.substr(0, REPORT);
+						}
+					}
+				}
+				scope.finish();
+				if(RESULT.status != 0) {
+					return executor::JobResult::FAILED;
 				}
-			} else if(IS_FEATURE && !IS_FEATURE_NOTE) {
-				if(!regex_match(KEY, featurePattern)) {
-					throw runtime_error(format("Feature \"%s\" in project config does not contain a valid feature name", commands::escape_quotes(KEY).c_str()));
+				commandLog.record(OBJECT, DIGEST);
+				if(!key.empty()) {
+					cache->store(key, OBJECT, output);
+				}
+				return executor::JobResult::BUILT;
+			};
+		};
+
+		// Declared after everything its jobs capture, so if adding jobs throws, its destructor waits for them while those still exist
+		executor::Scheduler scheduler(PLAN.jobs);
+
+		// The precompiled header is built with exactly the flags of the sources using it, otherwise the compiler ignores it
+		vector<size_t> precompileJobs;
+		if(!PLAN.pch.empty()) {
+			write_precompiled_header(PLAN, graph, compileFlags);
+			const string HEADER = PLAN.buildDir + "/" + precompiled::HEADER_NAME, PRECOMPILED = HEADER + ".gch";
+			precompileJobs.push_back(scheduler.add(PRECOMPILED, [&PLAN, &compileFlags, &commandLog, &COMMAND_LOG_FILE, &IS_STALE, HEADER, PRECOMPILED](const bool, string &output) {
+				vector<string> args = compileFlags;
+				args.insert(args.end(), {"-x", "c++-header", "-o", PRECOMPILED, "-c", HEADER});
+				args.insert(args.end(), PLAN.pkgCompileFlags.begin(), PLAN.pkgCompileFlags.end());
+				const string DIGEST = fingerprints::of(PLAN.whichCPP, args);
+				if(!IS_STALE(HEADER, PRECOMPILED, HEADER + ".d", DIGEST)) {
+					return executor::JobResult::UP_TO_DATE;
+				}
+				if(!commandLog.matches(PRECOMPILED, DIGEST)) {
+					commandLog.forget(PRECOMPILED, COMMAND_LOG_FILE);
 				}
 
-				Feature* pFeature;
-				auto iter = features.find(KEY);
-				if(iter != features.end()) {
-					pFeature = iter->second;
-				} else {
-					pFeature = new Feature;
-					features.insert({KEY, pFeature});
+				error_code error;
+				fs::remove(PRECOMPILED, error);
+				timings::Scope scope("Precompile " + HEADER, "compile");
+				const auto RESULT = commands::run_and_capture(PLAN.whichCPP, args);
+				scope.set_peak_memory(RESULT.peakMemory);
+				output = RESULT.output;
+				if(RESULT.status != 0) {
+					return executor::JobResult::FAILED;
 				}
+				commandLog.record(PRECOMPILED, DIGEST);
+				return executor::JobResult::BUILT;
+			}));
+		}
 
-				if(const auto VALUE = CONFIG.get(KEY)->as<configstring::Null>());
-				else get_optional_bool_from_config(CONFIG, KEY, pFeature->enabled);
+		vector<size_t> compileJobs;
+		size_t sourceCount = 0;
+		const auto START = chrono::steady_clock::now();
 
-				pFeature->enabled = pFeature->enabled && DEFAULT_FEATURES;
+		if(PLAN.unity > 0) {
+			// Batches need every source up front
+			for(const string &SOURCE : get_compile_sources(PLAN)) {
+				compileJobs.push_back(scheduler.add(SOURCE, COMPILE(SOURCE), precompileJobs));
 			}
+		} else {
+			// Compiles start while the rest of src is still being walked
+			for(const auto &entry : fs::recursive_directory_iterator("src")) {
+				if(!fs::is_directory(entry) && entry.path().extension() == ".cpp") {
+					const string SOURCE = dependencies::normalize_path(entry.path().string());
+					compileJobs.push_back(scheduler.add(SOURCE, COMPILE(SOURCE), precompileJobs));
+				}
+			}
+		}
+		sourceCount = compileJobs.size();
+		if(PLAN.test) {
+			compileJobs.push_back(scheduler.add(TESTING_SOURCE, COMPILE(TESTING_SOURCE), precompileJobs));
 		}
 
-		queue<string> featuresToEnable;
+#ifdef WINDOWS
+		const string TARGET = PLAN.target + ".exe";
+#else
+		const string TARGET = PLAN.target;
+#endif
+		scheduler.add(TARGET, [&PLAN, &objects, &commandLog, &COMMAND_LOG_FILE, &TESTING_SOURCE, TARGET](const bool DEPENDENCY_BUILT, string &output) {
+			// __Testing__.o runs the tests from its .init_array entry, so it has to come after every object registering tests
+			sort(objects.begin(), objects.end());
+			if(PLAN.test) {
+				objects.push_back(get_object_path(TESTING_SOURCE, PLAN.buildDir));
+			}
+
+			vector<string> args = {"-o", TARGET};
+			args.insert(args.end(), objects.begin(), objects.end());
+			args.insert(args.end(), PLAN.linkFlags.begin(), PLAN.linkFlags.end());
+			const string DIGEST = fingerprints::of(PLAN.whichCPP, args);
+
+			const files::FileStat TARGET_STAT = files::stat(TARGET);
+			bool stale = DEPENDENCY_BUILT || !TARGET_STAT.exists || !commandLog.matches(TARGET, DIGEST);
+			for(const string &OBJECT : objects) {
+				stale = stale || files::stat(OBJECT).mtime > TARGET_STAT.mtime;
+			}
+			if(!stale) {
+				return executor::JobResult::UP_TO_DATE;
+			}
+			if(!commandLog.matches(TARGET, DIGEST)) {
+				commandLog.forget(TARGET, COMMAND_LOG_FILE);
+			}
 
-		for(const string &FEATURE : FEATURES) {
-			featuresToEnable.push("feature." + FEATURE);
+			timings::Scope scope("Link " + TARGET, "link");
+			const auto RESULT = commands::run_and_capture(PLAN.whichCPP, args);
+			scope.set_peak_memory(RESULT.peakMemory);
+			output = RESULT.output;
+			if(RESULT.status != 0) {
+				return executor::JobResult::FAILED;
+			}
+			commandLog.record(TARGET, DIGEST);
+			return executor::JobResult::BUILT;
+		}, compileJobs);
+
+		const bool SUCCEEDED = scheduler.wait();
+		// Only builds that compiled every source are timed, since objects from the cache would make a mode look faster than it is
+		bool full = SUCCEEDED;
+		for(const size_t JOB : compileJobs) {
+			full = full && scheduler.result(JOB) == executor::JobResult::BUILT;
+		}
+		if(full) {
+			report_full_build(PLAN, sourceCount, chrono::duration<double>(chrono::steady_clock::now() - START).count());
+		}
+		if(cache) {
+			cache->flush();
 		}
+		commandLog.save(COMMAND_LOG_FILE);
+		graph.report_unreadable();
+		if(USE_GRAPH) {
+			graph.save_cache(DEPENDENCY_CACHE_FILE);
+		}
+		if(!SUCCEEDED) {
+			throw runtime_error("Error building project");
+		}
+	}
+}
 
-		// Add default features
-		for(auto const& [KEY, P_feature] : features) {
-			if(P_feature->enabled) {
-				featuresToEnable.push(KEY);
+namespace {
+	/// @brief Resolves everything about a build from CONFIG (settings, features, packages, and flags) without compiling anything, see build
+	BuildPlan make_plan(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const size_t JOBS, const PgoPhase PGO, const configstring::ConfigObject &CONFIG) {
+		// Get project settings
+		// version and author can be omitted while name is required
+		string projectName, projectVersion = "1.0", projectAuthor = "anonymous";
+		get_string_from_config(CONFIG, "project.name", projectName);
+		files::validate_fname(projectName);
+		get_optional_version_from_config(CONFIG, "project.version", projectVersion);
+		get_optional_string_from_config(CONFIG, "project.author", projectAuthor);
+
+		// All can be omitted
+		string whichCPP = "g++", whichMake = "make", whichPkgConfig = "pkg-config";
+		get_optional_string_from_config(CONFIG, "which.cpp", whichCPP);
+		get_optional_string_from_config(CONFIG, "which.make", whichMake);
+		get_optional_string_from_config(CONFIG, "which.pkg-config", whichPkgConfig);
+
+
+		const string COMPILER_IDENTITY = whichCPP + "\n" + get_tool_identity(whichCPP, "cpp");
+
+		bool cppStrict = false, cppStatic = false;
+		get_optional_bool_from_config(CONFIG, "cpp.strict", cppStrict);
+		get_optional_bool_from_config(CONFIG, "cpp.static", cppStatic);
+
+		double cppVersion = 11;
+		get_optional_double_from_config(CONFIG, "cpp.version", cppVersion);
+
+		// A header to precompile and include in every source, or "auto" to precompile the system headers most sources include
+		string cppPch = "";
+		get_optional_string_from_config(CONFIG, "cpp.pch", cppPch);
+		if(!cppPch.empty() && cppPch != "auto") {
+			if(!files::fexists(cppPch)) {
+				throw runtime_error(format("\"cpp.pch\" in project config must be \"auto\" or an existing header but was \"%s\"", commands::escape_quotes(cppPch).c_str()));
 			}
+			cppPch = dependencies::normalize_path(cppPch);
 		}
 
-		// BFS to enable features and optional packages
-		while(!featuresToEnable.empty()) {
-			const string NEXT = featuresToEnable.front();
-			auto iter = features.find(NEXT);
-			Feature *pFeature;
+		// "scan" finds dependencies with cog's own include scanner, "compiler" has the compiler write .d files while compiling
+		string buildDeps = "scan";
+		get_optional_string_from_config(CONFIG, "build.deps", buildDeps);
+		if(buildDeps != "scan" && buildDeps != "compiler") {
+			throw runtime_error(format("\"build.deps\" in project config must be \"scan\" or \"compiler\" but was \"%s\"", commands::escape_quotes(buildDeps).c_str()));
+		}
+		const bool COMPILER_DEPS = buildDeps == "compiler";
 
-			if(iter != features.end()) {
-				pFeature = iter->second;
-			} else {
-				throw runtime_error(format("Cannot enable feature \"%s\" since it does not exist", commands::escape_quotes(NEXT).c_str()));
+		// "native" compiles with cog's own parallel scheduler, "make" generates a makefile and runs make on it
+		string buildBackend = "native";
+		get_optional_string_from_config(CONFIG, "build.backend", buildBackend);
+		if(buildBackend != "native" && buildBackend != "make") {
+			throw runtime_error(format("\"build.backend\" in project config must be \"native\" or \"make\" but was \"%s\"", commands::escape_quotes(buildBackend).c_str()));
+		}
+
+		// Sources are combined into build.unity unity sources, except those listed in build.unity.exclude
+		double buildUnity = 0;
+		get_optional_double_from_config(CONFIG, "build.unity", buildUnity);
+		vector<string> unityExcludes;
+		if(CONFIG.has("build.unity.exclude")) {
+			string value = "";
+			get_string_from_config(CONFIG, "build.unity.exclude", value);
+			for(const string &ITEM : configstring::stringlib::str_split(value, (const char)',')) {
+				if(!configstring::stringlib::str_trim(ITEM).empty()) {
+					unityExcludes.push_back(dependencies::normalize_path(configstring::stringlib::str_trim(ITEM)));
+				}
 			}
-			featuresToEnable.pop();
+		}
 
-			if(pFeature->visited) {
-				continue;
-			} else {
-				pFeature->visited = true;
+		// Objects are shared through the object cache in ~/.cache/cog unless disabled
+		bool buildCache = true;
+		get_optional_bool_from_config(CONFIG, "build.cache", buildCache);
+
+		// -j on the command line wins over build.jobs, which wins over one job per hardware thread
+		size_t jobs = JOBS;
+		if(jobs == 0) {
+			double configJobs = 0;
+			get_optional_double_from_config(CONFIG, "build.jobs", configJobs);
+			jobs = configJobs >= 1 ? (size_t)configJobs : threads::default_concurrency();
+		}
+
+		struct Pkg {
+			string name;
+			/// @brief One of =, <=, >=
+			string relation = "=";
+			/// @brief Version, * for any
+			string version = "*";
+			///@brief Features can make optional packages required
+			bool required = true;
+		};
+
+		vector<Pkg> packages;
+		regex pkgPatternLG("^pkg\\??.([a-zA-Z0-9+_-]+)(<|>)$");
+		regex pkgPatternSimple("^pkg\\??.([a-zA-Z0-9+_-]+)$");
+		smatch matches;
+
+		struct Feature {
+			bool enabled = true;
+			/// @brief Circular features allowed, used in BFS
+			bool visited = false;
+			/// @brief Features or packages this depends on
+			vector<string> dependencies;
+		};
+
+		map<string, Feature*> features;
+		string featureFlags = "";
+
+		// Read in features and third party packages from config
+		timings::Scope featuresScope("Resolve features", "phase");
+		try {
+			const string PKG_PREFIX = "pkg.", OPTIONAL_PKG_PREFIX = "pkg?.", FEATURE_PREFIX = "feature.", FEATURE_NOTE_SUFFIX = ".notes", FEATURE_REQUIRED_SUFFIX = ".required";
+			regex featurePattern(format("^%s([A-Z0-9_]+)(%s)?$", FEATURE_PREFIX.c_str(), FEATURE_REQUIRED_SUFFIX.c_str()));
+			// Both pkg. and pkg?. keys start with "pkg", so one prefix query finds every package in the order they were declared
+			for(const string_view KEY_VIEW : CONFIG.keys_with_prefix("pkg")) {
+				const string KEY(KEY_VIEW);
+				const bool
+					IS_PACKAGE = KEY.length() > PKG_PREFIX.length() && KEY.rfind(PKG_PREFIX,0) == 0,
+					IS_OPTIONAL_PACKAGE = KEY.length() > OPTIONAL_PKG_PREFIX.length() && KEY.rfind(OPTIONAL_PKG_PREFIX,0) == 0;
+				if(IS_PACKAGE || IS_OPTIONAL_PACKAGE) {
+					Pkg pkg;
+					if(regex_search(KEY, matches, pkgPatternLG)) {
+						pkg.name = matches[1].str(); // match 0 is always the whole match
+						pkg.relation = matches[2].str() + "=";
+					} else if(regex_match(KEY, pkgPatternSimple)) {
+						pkg.name = KEY.substr(4 + IS_OPTIONAL_PACKAGE);
+					} else {
+						throw runtime_error(format("Package \"%s\" in project config does not contain a valid package name", commands::escape_quotes(KEY).c_str()));
+					}
+
+					if(IS_OPTIONAL_PACKAGE) {
+						pkg.required = false;
+					}
+
+					if(!CONFIG.is<nullptr_t>(KEY)) {
+						get_optional_version_from_config(CONFIG, KEY, pkg.version);
+					}
+
+					packages.push_back(pkg);
+				}
 			}
 
-			pFeature->enabled = true;
+			for(const string_view KEY_VIEW : CONFIG.keys_with_prefix(FEATURE_PREFIX)) {
+				const string KEY(KEY_VIEW);
+				const bool
+					IS_FEATURE = KEY.length() > FEATURE_PREFIX.length(),
+					IS_FEATURE_DTL = IS_FEATURE && KEY.length() > FEATURE_PREFIX.length() + FEATURE_REQUIRED_SUFFIX.length() && KEY.substr(KEY.length() - FEATURE_REQUIRED_SUFFIX.length()) == FEATURE_REQUIRED_SUFFIX,
+					IS_FEATURE_NOTE = IS_FEATURE && KEY.length() > FEATURE_PREFIX.length() + FEATURE_NOTE_SUFFIX.length() && KEY.substr(KEY.length() - FEATURE_NOTE_SUFFIX.length()) == FEATURE_NOTE_SUFFIX;
+				if(IS_FEATURE_DTL) {
+					if(!regex_match(KEY, featurePattern)) {
+						throw runtime_error(format("Feature detail \"%s\" in project config does not contain a valid feature name", commands::escape_quotes(KEY).c_str()));
+					}
+
+					const string FEATURE_NAME = KEY.substr(0,KEY.length()-9);
+					Feature* pFeature;
+					auto iter = features.find(FEATURE_NAME);
+					if(iter != features.end()) {
+						pFeature = iter->second;
+					} else {
+						pFeature = new Feature;
+						features.insert({FEATURE_NAME, pFeature});
+					}
+
+					string value = "";
+					get_string_from_config(CONFIG,KEY,value);
+					for(const string &ITEM : configstring::stringlib::str_split(value, (const char)',')) {
+						pFeature->dependencies.push_back(configstring::stringlib::str_trim(ITEM));
+					}
+				} else if(IS_FEATURE && !IS_FEATURE_NOTE) {
+					if(!regex_match(KEY, featurePattern)) {
+						throw runtime_error(format("Feature \"%s\" in project config does not contain a valid feature name", commands::escape_quotes(KEY).c_str()));
+					}
 
-			for(const string &ITEM : pFeature->dependencies) {
-				if(ITEM.length() > 4 && ITEM.rfind("pkg.",0) == 0) {
-					auto iter = find_if(packages.begin(), packages.end(), [ITEM](const Pkg& PKG) { return PKG.name == ITEM.substr(4); });
-					if(iter == packages.end()) {
-						throw runtime_error(format("Cannot require package \"%s\" since is not specified", commands::escape_quotes(ITEM).c_str()));
+					Feature* pFeature;
+					auto iter = features.find(KEY);
+					if(iter != features.end()) {
+						pFeature = iter->second;
 					} else {
-						iter->required = true;
+						pFeature = new Feature;
+						features.insert({KEY, pFeature});
+					}
+
+					if(!CONFIG.is<nullptr_t>(KEY)) {
+						get_optional_bool_from_config(CONFIG, KEY, pFeature->enabled);
 					}
-				} else if(ITEM.length() > 8 && ITEM.rfind("feature.",0) == 0) {
-					featuresToEnable.push(ITEM);
+
+					pFeature->enabled = pFeature->enabled && DEFAULT_FEATURES;
+				}
+			}
+
+			queue<string> featuresToEnable;
+
+			for(const string &FEATURE : FEATURES) {
+				featuresToEnable.push("feature." + FEATURE);
+			}
+
+			// Add default features
+			for(auto const& [KEY, P_feature] : features) {
+				if(P_feature->enabled) {
+					featuresToEnable.push(KEY);
+				}
+			}
+
+			// BFS to enable features and optional packages
+			while(!featuresToEnable.empty()) {
+				const string NEXT = featuresToEnable.front();
+				auto iter = features.find(NEXT);
+				Feature *pFeature;
+
+				if(iter != features.end()) {
+					pFeature = iter->second;
+				} else {
+					throw runtime_error(format("Cannot enable feature \"%s\" since it does not exist", commands::escape_quotes(NEXT).c_str()));
+				}
+				featuresToEnable.pop();
+
+				if(pFeature->visited) {
+					continue;
 				} else {
-					throw runtime_error(format("Unexpected entry \"%s\" in \"%s.required\"", commands::escape_quotes(ITEM).c_str(), commands::escape_quotes(NEXT).c_str()));
+					pFeature->visited = true;
+				}
+
+				pFeature->enabled = true;
+
+				for(const string &ITEM : pFeature->dependencies) {
+					if(ITEM.length() > 4 && ITEM.rfind("pkg.",0) == 0) {
+						auto iter = find_if(packages.begin(), packages.end(), [ITEM](const Pkg& PKG) { return PKG.name == ITEM.substr(4); });
+						if(iter == packages.end()) {
+							throw runtime_error(format("Cannot require package \"%s\" since is not specified", commands::escape_quotes(ITEM).c_str()));
+						} else {
+							iter->required = true;
+						}
+					} else if(ITEM.length() > 8 && ITEM.rfind("feature.",0) == 0) {
+						featuresToEnable.push(ITEM);
+					} else {
+						throw runtime_error(format("Unexpected entry \"%s\" in \"%s.required\"", commands::escape_quotes(ITEM).c_str(), commands::escape_quotes(NEXT).c_str()));
+					}
 				}
 			}
-		}
 
-		for(auto const& [KEY, P_feature] : features) {
-			if(P_feature->enabled) {
-				featureFlags += format(" -DFEATURE_%s", KEY.substr(8).c_str());
+			for(auto const& [KEY, P_feature] : features) {
+				if(P_feature->enabled) {
+					featureFlags += format(" -DFEATURE_%s", KEY.substr(8).c_str());
+				}
+				delete P_feature;
 			}
-			delete P_feature;
+			features.clear();
+		} catch(const runtime_error &ERR) {
+			for(auto const& [KEY, P_feature] : features) {
+				delete P_feature;
+			}
+			features.clear();
+			throw ERR;
 		}
-		features.clear();
-	} catch(const runtime_error &ERR) {
-		for(auto const& [KEY, P_feature] : features) {
-			delete P_feature;
+		featuresScope.finish();
+
+		// Each profile and feature set builds in its own directory, so switching between them never invalidates another's objects
+		// Anything else that changes how a file is compiled is caught by the per object command fingerprints
+		// Profile guided builds get their own directories too, so training never invalidates the plain release build
+		const string PROFILE = PGO == PgoPhase::GENERATE ? "pgo-instrumented" : PGO == PgoPhase::USE ? "pgo" : TYPE == BuildType::TEST ? "test" : DEBUG ? "debug" : "release";
+		const string FEATURES_HASH = hashing::digest(featureFlags).substr(0, 8);
+		const string BUILD_DIR = get_build_root(CONFIG) + "/" + PROFILE + "-" + FEATURES_HASH;
+
+		// Tests and profile guided builds start from the debug or release settings (depending on -r) and can override them with profile.<name>.xxx
+		const string BASE_PROFILE = DEBUG && PGO == PgoPhase::OFF ? "debug" : "release";
+		Profile profile = get_default_profile(BASE_PROFILE);
+		if(PROFILE != BASE_PROFILE) {
+			read_profile(CONFIG, BASE_PROFILE, profile);
+		}
+		read_profile(CONFIG, PROFILE, profile);
+		fs::create_directories(BUILD_DIR);
+
+		// The lock records what the directory was built for and, through its modification time, when it was last used (see collect_garbage).
+		// It is only rewritten when that changes, otherwise just its modification time is
+		{
+			configstring::ConfigObject lockConfig;
+			lockConfig.set(PROFILE_LOCK_KEY, PROFILE);
+			lockConfig.set(FEATURES_LOCK_KEY, configstring::stringlib::str_trim(featureFlags));
+			if(!files::fwrite_if_changed(BUILD_DIR + "/" + PROFILE_LOCK_FILE, lockConfig.stringify())) {
+				error_code error;
+				fs::last_write_time(BUILD_DIR + "/" + PROFILE_LOCK_FILE, fs::file_time_type::clock::now(), error);
+			}
 		}
-		features.clear();
-		throw ERR;
-	}
 
-	bool forceRebuild = false || !DEBUG;
+		// The optimized build takes its profile data from the instrumented build of the same features
+		const string SOURCES_FINGERPRINT = PGO == PgoPhase::OFF ? "" : get_sources_fingerprint();
+		string pgoTraining = "";
+		if(PGO == PgoPhase::USE) {
+			pgoTraining = use_profile_data(BUILD_DIR, get_build_root(CONFIG) + "/pgo-instrumented-" + FEATURES_HASH, SOURCES_FINGERPRINT);
+		}
 
-	// Lock management to check if forced rebuild is needed
-	{
-		const string LOCK_FILE = BUILD_DIR + "/project.lock";
-		const string PROJECT_LOCK_KEY = "project.identity";
-		const string FEATURE_LOCK_KEY = "features.identity";
-		const string RELEASE_LOCK_KEY = "release.identity";
-		
-		configstring::ConfigObject lockConfig;
-		if(files::fexists(LOCK_FILE)) {
-			lockConfig = configstring::parse(files::fread(LOCK_FILE));
+		if(TYPE == BuildType::TEST) {
+			files::fwrite_if_changed(BUILD_DIR + "/__Testing__.hpp", __TESTING__HPP);
+			files::fwrite_if_changed(BUILD_DIR + "/__Testing__.cpp", __TESTING__CPP);
 		}
 
-		string currentProjectHash = format("%x",hash<string>{}(files::fread(get_config_filename())));
-		string oldProjectFileHash = "";
-		get_optional_string_from_config(lockConfig,PROJECT_LOCK_KEY,oldProjectFileHash);
 
-		string currentFeatureHash = format("%x",hash<string>{}(featureFlags));
-		string oldFeatureHash = "";
-		get_optional_string_from_config(lockConfig,FEATURE_LOCK_KEY,oldFeatureHash);
-		
-		bool isRelease = !DEBUG;
-		bool wasRelease = false;
-		get_optional_bool_from_config(lockConfig,RELEASE_LOCK_KEY,wasRelease);
+		// Remove unneeded packages
+		packages.erase(
+			remove_if(packages.begin(), packages.end(), [](const Pkg PKG) { return !PKG.required; }),
+			packages.end()
+		);
 
-		// If project.cfg changes, force a rebuild and update lock
-		if(oldProjectFileHash != currentProjectHash) {
-			forceRebuild = true;
-			lockConfig.set(PROJECT_LOCK_KEY, new configstring::String(currentProjectHash));
+		// Get required package info
+		string pkgLinkFlags = "", pkgCompileFlags = "";
+		if(packages.size() > 0) {
+			timings::Scope scope("Run pkg-config", "phase");
+			get_tool_identity(whichPkgConfig, "pkg-config");
+	
+			// Format and concat arguments for pkg-config, exec here and not in make to catch errors
+			vector<string> pkgConfigCompileArgs;
+			vector<string> pkgConfigLinkArgs;
+
+			for(const Pkg &PKG : packages) {
+				if(PKG.version != "*") {
+					pkgConfigCompileArgs.push_back(format("%s %s %s", PKG.name.c_str(), PKG.relation.c_str(), PKG.version.c_str()));
+				} else {
+					pkgConfigCompileArgs.push_back(format("%s", PKG.name.c_str()));
+				}
+			}
+
+			// Copy
+			pkgConfigLinkArgs = pkgConfigCompileArgs;
+
+			// Customize
+			pkgConfigCompileArgs.push_back("--cflags");
+			pkgConfigLinkArgs.push_back("--libs");
+			if(cppStatic) {
+				pkgConfigLinkArgs.push_back("--static");
+			}
+
+			// Only pkg-config searches the local packages directory, and this process keeps its own path, so processes that plan many builds
+			// (cog watch and the build server) ask the same question every time
+			const string PKG_CONFIG_PATH = "PKG_CONFIG_PATH", SEARCH_PATH = commands::concat_path(commands::get_env_var(PKG_CONFIG_PATH), "packages");
+
+#ifdef WINDOWS
+			const string INHERITED_PATH = commands::get_env_var(PKG_CONFIG_PATH);
+			commands::set_env_var(PKG_CONFIG_PATH, SEARCH_PATH);
+			const auto PKG_CONFIG_COMPILE_RESULT = commands::run_and_read(whichPkgConfig, pkgConfigCompileArgs);
+			const auto PKG_CONFIG_LINK_RESULT = commands::run_and_read(whichPkgConfig, pkgConfigLinkArgs);
+			commands::set_env_var(PKG_CONFIG_PATH, INHERITED_PATH);
+			if(PKG_CONFIG_COMPILE_RESULT.status != 0) {
+				throw runtime_error("Error finding one or more packages");
+			}
+
+			if(PKG_CONFIG_LINK_RESULT.status != 0) {
+				throw runtime_error("Error finding one or more packages");
+			}
+
+			pkgCompileFlags = " " + configstring::stringlib::str_trim(PKG_CONFIG_COMPILE_RESULT.output);
+			pkgLinkFlags = " " + configstring::stringlib::str_trim(PKG_CONFIG_LINK_RESULT.output);
+#else
+			// Answers are kept in the profile directory (and shared by the members of a workspace build, which often ask for the same packages) until pkg-config,
+			// what is asked, or any directory it searches for packages changes. The local packages directory is part of the question
+			string searchPath = "";
+			read_tool_output(whichPkgConfig, {"--variable=pc_path", "pkg-config"}, searchPath);
+			vector<string> searchDirs;
+			for(const string &PATH : {SEARCH_PATH, commands::get_env_var("PKG_CONFIG_LIBDIR"), configstring::stringlib::str_trim(searchPath)}) {
+				for(const string &DIR : configstring::stringlib::str_split(PATH, (const char)':')) {
+					if(!DIR.empty()) {
+						searchDirs.push_back(DIR);
+					}
+				}
+			}
+			hashing::Hasher question;
+			question.add(whichPkgConfig).add(SEARCH_PATH).add(commands::get_env_var("PKG_CONFIG_LIBDIR")).add(commands::get_env_var("PKG_CONFIG_SYSROOT_DIR"))
+				.add(fs::is_directory("packages") ? fs::absolute("packages").string() : "").add(get_stats_fingerprint(searchDirs));
+			for(const string &ARG : pkgConfigLinkArgs) {
+				question.add(ARG);
+			}
+			const string QUESTION = question.digest(), LOCAL_RESULT = BUILD_DIR + "/" + PKG_CONFIG_RESULT_FILE;
+			const string SHARED_RESULTS = commands::get_env_var(PKG_CONFIG_CACHE_VARIABLE);
+			const string SHARED_RESULT = SHARED_RESULTS.empty() ? "" : SHARED_RESULTS + "/" + QUESTION;
+
+			// A result holds the question, the compile flags, and the link flags on separate lines
+			vector<string> answer;
+			for(const string &RESULT : {LOCAL_RESULT, SHARED_RESULT}) {
+				if(!RESULT.empty() && files::fexists(RESULT)) {
+					answer = configstring::stringlib::str_split(files::fread(RESULT), '\n');
+					if(answer.size() == 3 && answer[0] == QUESTION) {
+						break;
+					}
+					answer.clear();
+				}
+			}
+
+			if(answer.empty()) {
+				// Both queries run at once
+				const vector<string> PKG_CONFIG_COMMAND = commands::split_args(whichPkgConfig);
+				pkgConfigCompileArgs.insert(pkgConfigCompileArgs.begin(), PKG_CONFIG_COMMAND.begin(), PKG_CONFIG_COMMAND.end());
+				pkgConfigLinkArgs.insert(pkgConfigLinkArgs.begin(), PKG_CONFIG_COMMAND.begin(), PKG_CONFIG_COMMAND.end());
+				const vector<string> ENV = {PKG_CONFIG_PATH + "=" + SEARCH_PATH};
+				commands::Process compileQuery(pkgConfigCompileArgs, commands::Stream::CAPTURE, commands::Stream::INHERIT, "", ENV), linkQuery(pkgConfigLinkArgs, commands::Stream::CAPTURE, commands::Stream::INHERIT, "", ENV);
+				commands::wait_all({&compileQuery, &linkQuery});
+				if(compileQuery.get_exit_code() != 0 || linkQuery.get_exit_code() != 0) {
+					throw runtime_error("Error finding one or more packages");
+				}
+
+				answer = {QUESTION, configstring::stringlib::str_trim(compileQuery.get_output()), configstring::stringlib::str_trim(linkQuery.get_output())};
+				if(!SHARED_RESULT.empty()) {
+					// Renamed into place so other members never read a partial answer
+					const string TEMPORARY = SHARED_RESULT + format(".%i", (int)getpid());
+					files::fwrite(TEMPORARY, answer[0] + "\n" + answer[1] + "\n" + answer[2] + "\n");
+					error_code error;
+					fs::rename(TEMPORARY, SHARED_RESULT, error);
+				}
+			}
+			files::fwrite_if_changed(LOCAL_RESULT, answer[0] + "\n" + answer[1] + "\n" + answer[2] + "\n");
+			pkgCompileFlags = " " + answer[1];
+			pkgLinkFlags = " " + answer[2];
+#endif
+		}
+
+		if(buildBackend == "make") {
+			get_tool_identity(whichMake, "make");
 		}
 
-		// If features change, force a rebuild and update lock
-		if(oldFeatureHash != currentFeatureHash) {
-			forceRebuild = true;
-			lockConfig.set(FEATURE_LOCK_KEY, new configstring::String(currentFeatureHash));
+		// Everything below only depends on the plan
+		BuildPlan plan;
+		plan.buildDir = BUILD_DIR;
+		plan.target = BUILD_DIR + "/" + projectName;
+		plan.whichCPP = whichCPP;
+		plan.whichMake = whichMake;
+		plan.test = TYPE == BuildType::TEST;
+		plan.compilerDeps = COMPILER_DEPS;
+		plan.jobs = jobs;
+		plan.compilerIdentity = COMPILER_IDENTITY;
+		// Instrumented objects write their counts to an absolute path and optimized objects depend on profile data outside their command, so neither can be shared
+		plan.cache = buildCache && PGO == PgoPhase::OFF;
+		plan.pch = cppPch;
+		plan.unity = buildUnity >= 1 ? (size_t)buildUnity : 0;
+		plan.unityExcludes = unityExcludes;
+		plan.backend = buildBackend;
+		plan.pgo = PGO;
+		plan.sourcesFingerprint = SOURCES_FINGERPRINT;
+
+		plan.compileFlags = {format("-std=c++%i", (int)cppVersion), "-Wall"};
+		if(TYPE != BuildType::TEST && cppStrict) {
+			plan.compileFlags.insert(plan.compileFlags.end(), {"-Werror", "-Wpedantic"});
+		}
+		plan.compileFlags.insert(plan.compileFlags.end(), {
+			"-std=c++17",
+			format("-DPROJECT_NAME=\"%s\"", commands::escape_quotes(projectName).c_str()),
+			format("-DPROJECT_VERSION=\"%s\"", commands::escape_quotes(projectVersion).c_str()),
+			format("-DPROJECT_AUTHOR=\"%s\"", commands::escape_quotes(projectAuthor).c_str())
+		});
+		// The precompiled header has to be the first header included
+		if(!plan.pch.empty()) {
+			plan.forceIncludeFlags.insert(plan.forceIncludeFlags.end(), {"-include", BUILD_DIR + "/" + precompiled::HEADER_NAME});
+		}
+		if(TYPE == BuildType::TEST) {
+			plan.forceIncludeFlags.insert(plan.forceIncludeFlags.end(), {"-include", BUILD_DIR + "/__Testing__.hpp"});
+		} else {
+			plan.compileFlags.push_back("-DTEST(...)=");
+		}
+		plan.compileFlags.push_back("-O" + profile.optLevel);
+		if(profile.debuginfo > 0) {
+			plan.compileFlags.push_back(profile.debuginfo == 2 ? "-g" : format("-g%i", profile.debuginfo));
+		}
+		if(!profile.march.empty()) {
+			plan.compileFlags.push_back("-march=" + profile.march);
+		}
+		if(profile.lto) {
+			plan.compileFlags.push_back("-flto=auto");
+		}
+		if(profile.gcSections) {
+			plan.compileFlags.insert(plan.compileFlags.end(), {"-ffunction-sections", "-fdata-sections"});
+		}
+		if(PGO == PgoPhase::GENERATE) {
+			plan.compileFlags.insert(plan.compileFlags.end(), {"-fprofile-generate", "-fprofile-update=prefer-atomic"});
+		} else if(PGO == PgoPhase::USE) {
+			// The data always matches the sources, so the only functions missing from it are ones gcc never instruments (like static initializers)
+			plan.compileFlags.insert(plan.compileFlags.end(), {"-fprofile-use", "-Wno-missing-profile"});
+			// Tests rarely run everything, so code they never reached is still optimized for speed instead of size
+			if(pgoTraining == "test") {
+				plan.compileFlags.push_back("-fprofile-partial-training");
+			}
+		}
+		if(COMPILER_DEPS) {
+			plan.compileFlags.insert(plan.compileFlags.end(), {"-MMD", "-MP"});
+		}
+		for(const string &FLAG : commands::split_args(featureFlags)) {
+			plan.compileFlags.push_back(FLAG);
 		}
 
-		// If build mode change, force a rebuild and update lock
-		if(wasRelease != isRelease) {
-			forceRebuild = true;
-			lockConfig.set(RELEASE_LOCK_KEY, new configstring::Boolean(isRelease));
+		plan.pkgCompileFlags = commands::split_args(pkgCompileFlags);
+		if(cppStatic) {
+			plan.linkFlags.push_back("-static");
+		}
+		// With link time optimization code is generated while linking, so the link needs the optimization flags too
+		if(profile.lto) {
+			plan.linkFlags.insert(plan.linkFlags.end(), {"-O" + profile.optLevel, "-flto=auto"});
+			if(!profile.march.empty()) {
+				plan.linkFlags.push_back("-march=" + profile.march);
+			}
+			if(profile.codegenUnits == 1) {
+				plan.linkFlags.push_back("-flto-partition=one");
+			} else if(profile.codegenUnits > 1) {
+				plan.linkFlags.push_back(format("--param=lto-partitions=%zu", profile.codegenUnits));
+			}
+		}
+		if(profile.gcSections) {
+	#ifdef __APPLE__
+			plan.linkFlags.push_back("-Wl,-dead_strip");
+	#else
+			plan.linkFlags.push_back("-Wl,--gc-sections");
+	#endif
+		}
+		if(profile.strip) {
+			plan.linkFlags.push_back("-s");
+		}
+		if(PGO == PgoPhase::GENERATE) {
+			plan.linkFlags.push_back("-fprofile-generate");
+		} else if(PGO == PgoPhase::USE) {
+			plan.linkFlags.push_back("-fprofile-use");
+		}
+		for(const string &FLAG : commands::split_args(pkgLinkFlags)) {
+			plan.linkFlags.push_back(FLAG);
 		}
 
-		// Update lock file
-		files::fwrite(LOCK_FILE, lockConfig.stringify());
-		
-		// lockConfig will automatically delete its values when it goes out of scope
+		return plan;
 	}
 
+	/// @brief Digest of everything in PLAN that changes what it builds (the number of jobs does not)
+	string get_plan_fingerprint(const BuildPlan &PLAN) {
+		hashing::Hasher hasher;
+		hasher.add(VERSION).add(PLAN.buildDir).add(PLAN.target).add(PLAN.whichCPP).add(PLAN.whichMake).add(PLAN.compilerIdentity).add(PLAN.pch).add(to_string(PLAN.unity))
+			.add(to_string(PLAN.test)).add(to_string(PLAN.compilerDeps)).add(to_string(PLAN.cache)).add(PLAN.backend).add(to_string((int)PLAN.pgo));
+		for(const vector<string> *pList : {&PLAN.compileFlags, &PLAN.forceIncludeFlags, &PLAN.unityExcludes, &PLAN.pkgCompileFlags, &PLAN.linkFlags}) {
+			hasher.add(to_string(pList->size()));
+			for(const string &ITEM : *pList) {
+				hasher.add(ITEM);
+			}
+		}
+		return hasher.digest();
+	}
 
-	// Remove unneeded packages
-	packages.erase(
-		remove_if(packages.begin(), packages.end(), [](const Pkg PKG) { return !PKG.required; }),
-		packages.end()
-	);
+	/// @brief Every path whose change could change what PLAN builds: src and everything in it, every file in GRAPH, and (with compiler dependencies) every prerequisite in a depfile
+	vector<string> get_build_inputs(const BuildPlan &PLAN, const dependencies::IncludeGraph &GRAPH) {
+		vector<string> inputs = GRAPH.paths();
+		inputs.push_back("src");
+		for(const auto &entry : fs::recursive_directory_iterator("src")) {
+			inputs.push_back(dependencies::normalize_path(entry.path().string()));
+		}
+		if(PLAN.compilerDeps) {
+			for(const auto &entry : fs::recursive_directory_iterator(PLAN.buildDir)) {
+				vector<string> prerequisites;
+				if(entry.path().extension() == ".d" && dependencies::read_depfile(entry.path().string(), prerequisites)) {
+					for(const string &PREREQUISITE : prerequisites) {
+						inputs.push_back(dependencies::normalize_path(PREREQUISITE));
+					}
+				}
+			}
+		}
+		sort(inputs.begin(), inputs.end());
+		inputs.erase(unique(inputs.begin(), inputs.end()), inputs.end());
+		return inputs;
+	}
 
-	// Get required package info
-	string pkgLinkFlags = "", pkgCompileFlags = "";
-	if(packages.size() > 0) {
-		commands::assert_command_exists(whichPkgConfig, "pkg-config");
-	
-		// Format and concat arguments for pkg-config, exec here and not in make to catch errors
-		vector<string> pkgConfigCompileArgs;
-		vector<string> pkgConfigLinkArgs;
+	/// @brief Compiles and links PLAN with its backend and returns the path of the executable. GRAPH may be kept from an earlier build of PLAN (see watch)
+	string run_plan(const BuildPlan &PLAN, dependencies::IncludeGraph &graph) {
+#ifdef WINDOWS
+		const string EXECUTABLE = PLAN.target + ".exe";
+#else
+		const string EXECUTABLE = PLAN.target;
+#endif
 
-		for(const Pkg &PKG : packages) {
-			if(PKG.version != "*") {
-				pkgConfigCompileArgs.push_back(format("%s %s %s", PKG.name.c_str(), PKG.relation.c_str(), PKG.version.c_str()));
+		// If nothing about the plan changed and no input's stat did since the last successful build, there is nothing to check.
+		// Timed and profile guided builds always run, the first to be measured and the second since profile data is not an input
+		const bool USE_MANIFEST = PLAN.pgo == PgoPhase::OFF && !timings::is_enabled();
+		const string MANIFEST_FILE = PLAN.buildDir + "/" + MANIFEST_NAME, FINGERPRINT = get_plan_fingerprint(PLAN);
+		fingerprints::StatManifest manifest;
+		if(USE_MANIFEST) {
+			manifest.load(MANIFEST_FILE);
+			if(manifest.is_current(FINGERPRINT)) {
+				return EXECUTABLE;
+			}
+		}
+		error_code error;
+		fs::remove(MANIFEST_FILE, error);
+		const long long START = chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count() - MANIFEST_MARGIN_NS;
+
+		// Timings are written even if the build fails, since that can be where the time went
+		try {
+			timings::Scope scope("Build with " + PLAN.backend + " backend", "phase");
+			if(PLAN.backend == "make") {
+				build_with_make(PLAN, graph);
 			} else {
-				pkgConfigCompileArgs.push_back(format("%s", PKG.name.c_str()));
+				build_natively(PLAN, graph);
 			}
+		} catch(const runtime_error &ERR) {
+			if(timings::is_enabled()) {
+				timings::write_reports(PLAN.buildDir);
+			}
+			throw;
 		}
-
-		// Copy
-		pkgConfigLinkArgs = pkgConfigCompileArgs;
-
-		// Customize
-		pkgConfigCompileArgs.push_back("--cflags");
-		pkgConfigLinkArgs.push_back("--libs");
-		if(cppStatic) {
-			pkgConfigLinkArgs.push_back("--static");
+		if(timings::is_enabled()) {
+			eprintlnf("%sTimings written to %s%s", colors::CYAN, timings::write_reports(PLAN.buildDir).c_str(), colors::REVERT);
 		}
 
-		const string PKG_CONFIG_PATH = "PKG_CONFIG_PATH";
-		commands::set_env_var(PKG_CONFIG_PATH, commands::concat_path(commands::get_env_var(PKG_CONFIG_PATH), "packages"));
+		// Counts left by earlier training runs would be merged into the next one, even if they were recorded by different objects
+		if(PLAN.pgo == PgoPhase::GENERATE) {
+			error_code error;
+			for(const string &FILE : find_profile_data(PLAN.buildDir)) {
+				fs::remove(PLAN.buildDir + "/" + FILE, error);
+			}
 
-		const auto PKG_CONFIG_COMPILE_RESULT = commands::run_and_read(whichPkgConfig, pkgConfigCompileArgs);
-		if(PKG_CONFIG_COMPILE_RESULT.status != 0) {
-			throw runtime_error("Error finding one or more packages");
+			configstring::ConfigObject lockConfig;
+			lockConfig.set(PGO_SOURCES_KEY, PLAN.sourcesFingerprint);
+			lockConfig.set(PGO_TRAINING_KEY, PLAN.test ? "test" : "run");
+			files::fwrite(PLAN.buildDir + "/" + PGO_LOCK_FILE, lockConfig.stringify());
 		}
 
-		const auto PKG_CONFIG_LINK_RESULT = commands::run_and_read(whichPkgConfig, pkgConfigLinkArgs);
-		if(PKG_CONFIG_LINK_RESULT.status != 0) {
-			throw runtime_error("Error finding one or more packages");
+		if(USE_MANIFEST && manifest.record(FINGERPRINT, get_build_inputs(PLAN, graph), {EXECUTABLE}, START)) {
+			manifest.save(MANIFEST_FILE);
 		}
-
-		pkgCompileFlags = " " + configstring::stringlib::str_trim(PKG_CONFIG_COMPILE_RESULT.output);
-		pkgLinkFlags = " " + configstring::stringlib::str_trim(PKG_CONFIG_LINK_RESULT.output);
+		return EXECUTABLE;
 	}
+}
+
+/// @brief Build the project from the given config settings and set debug mode (defines the DEBUG macro for the project if true).
+/// JOBS is the number of compiles to run at once (build.jobs or one per hardware thread if 0). Returns the path of the executable
+std::string build(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const size_t JOBS, const PgoPhase PGO, const configstring::ConfigObject &CONFIG) {
+	dependencies::IncludeGraph graph;
+	return run_plan(make_plan(DEBUG, DEFAULT_FEATURES, FEATURES, TYPE, JOBS, PGO, CONFIG), graph);
+}
 
-	string dependencyRules = "", srcFiles = "";
-	// Find all compilable c++ files and generate dependencies
-	for(const auto &entry : fs::recursive_directory_iterator("src")) {
-		if(!fs::is_directory(entry)) {
-			const auto PATH = entry.path();
-			if(PATH.extension() == ".cpp") {
-				srcFiles += PATH.string() + " ";
-				dependencyRules += BUILD_DIR + "/" + get_make_dependencies(PATH) + '\n';
+/// @brief Builds the project, then rebuilds it whenever src, packages, or the project config change until interrupted. With RUN, the project (or its tests if TYPE is TEST)
+/// is started with ARGS after each build that produced a new executable, stopping the previous run first
+void watch(const bool RUN, const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const std::vector<std::string> ARGS, const BuildType TYPE, const size_t JOBS) {
+#ifdef WINDOWS
+	throw runtime_error("Watching for changes is only supported on Linux");
+#else
+	const string CONFIG_FILE = dependencies::normalize_path(get_config_filename());
+	filewatch::Watcher watcher;
+	watcher.add_tree("src");
+	watcher.add_tree("packages");
+	watcher.add_file(CONFIG_FILE);
+
+	// Config, tool versions, features, and package flags are only resolved again when the config or packages change,
+	// and the include graph is kept so only the files that changed are read again
+	unique_ptr<BuildPlan> plan;
+	unique_ptr<dependencies::IncludeGraph> graph;
+	vector<string> changed;
+	unique_ptr<commands::Process> child;
+	long long childBuilt = 0;
+	while(true) {
+		// When events were lost the config counts as changed too, so everything is resolved and scanned again
+		const bool REPLAN = !plan || any_of(changed.begin(), changed.end(), [&CONFIG_FILE](const string &PATH) { return PATH == CONFIG_FILE || PATH.rfind("packages/", 0) == 0; });
+		try {
+			if(REPLAN) {
+				plan.reset();
+				graph.reset(new dependencies::IncludeGraph());
+				plan.reset(new BuildPlan(make_plan(DEBUG, DEFAULT_FEATURES, FEATURES, TYPE, JOBS, PgoPhase::OFF, get_config())));
+			} else {
+				graph->invalidate(changed);
 			}
+			const string EXECUTABLE = run_plan(*plan, *graph);
+
+			// An unchanged executable is left running
+			const long long BUILT = files::stat(EXECUTABLE).mtime;
+			if(RUN && (!child || BUILT != childBuilt)) {
+				if(child) {
+					child->stop();
+					child.reset();
+				}
+				eprintlnf("%s%s%s %s:%s%s", fmt::ITALIC, colors::CYAN, (TYPE == BuildType::TEST ? "Testing" : "Running project"), fs::path(EXECUTABLE).filename().string().c_str(), colors::REVERT, fmt::REVERT_ITALIC);
+				child.reset(new commands::Process(get_executable_argv(EXECUTABLE, ARGS)));
+				childBuilt = BUILT;
+			}
+		} catch(const runtime_error &ERR) {
+			eprintlnf("%sRuntime error: %s%s", colors::RED, ERR.what(), colors::REVERT);
 		}
+
+		eprintlnf("%sWatching for changes...%s", colors::CYAN, colors::REVERT);
+		do {
+			// While the project runs, its exit is checked for between changes
+			changed = watcher.wait(WATCH_DEBOUNCE_MS, child ? 250 : -1);
+			if(child && !child->is_running()) {
+				eprintlnf("%s%sProject exited with code %i%s%s", fmt::ITALIC, colors::CYAN, child->get_exit_code(), colors::REVERT, fmt::REVERT_ITALIC);
+				child.reset();
+			}
+		} while(changed.empty());
 	}
+#endif
+}
 
-	if(TYPE == BuildType::TEST) {
-		srcFiles += std::string(" ") + BUILD_DIR + "/__Testing__.cpp";
+/// @brief Asks the build server of the project to build it (see build), starting one first if build.daemon is set and none is running.
+/// Returns false if no server could build it for this process, in which case it should be built in-process. Errors from the build are thrown
+bool build_on_server(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const size_t JOBS, std::string &executable) {
+	if(!commands::get_env_var("COG_NO_DAEMON").empty()) {
+		return false;
+	}
+	const buildserver::Request REQUEST = {"build", DEBUG, DEFAULT_FEATURES, TYPE == BuildType::TEST, FEATURES, JOBS};
+	buildserver::Response response;
+	if(!buildserver::send(REQUEST, response)) {
+		// The config is only read when there is no server, so builds that reach one skip parsing it
+		bool autostart = false;
+		get_optional_bool_from_config(get_config(), "build.daemon", autostart);
+		if(!autostart || !buildserver::spawn() || !buildserver::send(REQUEST, response)) {
+			return false;
+		}
+	}
+	if(response.status == "error") {
+		throw runtime_error(response.message);
 	}
+	executable = response.message;
+	return response.status == "ok";
+}
 
-	files::fwrite(BUILD_DIR + "/makefile",
-string("# autogenerated makefile\n")
-+ "TARGET = \"" + BUILD_DIR + "/" + commands::escape_spaces(commands::escape_quotes(projectName)) + "\"\n"
-+ "SRC_FILES = " + configstring::stringlib::str_replace(configstring::stringlib::str_trim(srcFiles), "\\", "/") + "\n"
-+ "CXX = " + whichCPP + "\n"
-+ format("CFLAGS = -std=c++%i -Wall%s -g -std=c++17 -DPROJECT_NAME=\"\\\"%s\\\"\" -DPROJECT_VERSION=\"\\\"%s\\\"\" -DPROJECT_AUTHOR=\"\\\"%s\\\"\" %s", (int)cppVersion, (TYPE != BuildType::TEST && cppStrict ? " -Werror -Wpedantic" : ""), commands::escape_quotes(commands::escape_quotes(projectName)).c_str(), commands::escape_quotes(commands::escape_quotes(projectVersion)).c_str(), commands::escape_quotes(commands::escape_quotes(projectAuthor)).c_str(), std::string(TYPE == BuildType::TEST ? std::string("-include ") + BUILD_DIR + "/__Testing__.hpp" : "-D'TEST(...)='").c_str()) + (DEBUG ? " -g3" : "") + featureFlags + " " + R"""(
-OBJECTS = $(patsubst src/%.cpp,)""" + BUILD_DIR + R"""(/%.o,${SRC_FILES})
+/// @brief Serves build requests for the project (see build_on_server) until stopped or idle for build.daemon.idle minutes (30 by default).
+/// Resolved plans and include graphs are kept between builds, and only made again when the config or packages change
+void serve_builds(const configstring::ConfigObject &CONFIG) {
+	double idleMinutes = 30;
+	get_optional_double_from_config(CONFIG, "build.daemon.idle", idleMinutes);
 
-ifeq ($(shell echo "Windows"), "Windows")
-	TARGET := $(TARGET).exe
-endif
-)""" + MAKE_MATCH_OS + R"""(
+	struct Session {
+		BuildPlan plan;
+		dependencies::IncludeGraph graph;
+	};
+	map<string, unique_ptr<Session>> sessions;
+	string inputs = "";
+
+	eprintlnf("%sBuild server listening on %s%s", colors::CYAN, buildserver::get_socket_path().c_str(), colors::REVERT);
+	buildserver::serve([&sessions, &inputs](const buildserver::Request &REQUEST) {
+		// Plans depend on the config and on the package files pkg-config reads, so any change to those starts over
+		const string INPUTS = get_stats_fingerprint({get_config_filename(), "packages"});
+		if(INPUTS != inputs) {
+			sessions.clear();
+			inputs = INPUTS;
+		}
 
-all: $(TARGET)
+		hashing::Hasher key;
+		key.add(REQUEST.debug ? "debug" : "release").add(REQUEST.defaultFeatures ? "default" : "no-default").add(REQUEST.test ? "test" : "normal").add(to_string(REQUEST.jobs));
+		for(const string &FEATURE : REQUEST.features) {
+			key.add(FEATURE);
+		}
+		unique_ptr<Session> &session = sessions[key.digest()];
+		if(session) {
+			session->graph.refresh();
+		} else {
+			const BuildType TYPE = REQUEST.test ? BuildType::TEST : BuildType::NORMAL;
+			session.reset(new Session {make_plan(REQUEST.debug, REQUEST.defaultFeatures, REQUEST.features, TYPE, REQUEST.jobs, PgoPhase::OFF, get_config()), {}});
+		}
+		try {
+			return buildserver::Response {"ok", run_plan(session->plan, session->graph)};
+		} catch(...) {
+			// The graph may be half scanned
+			session.reset();
+			throw;
+		}
+	}, idleMinutes * 60);
+}
 
-$(TARGET): $(OBJECTS)
-	@$(CXX) -o $@ $^)""" + (cppStatic ? " -static" : "") + pkgLinkFlags + R"""(
+/// @brief Build the project (with up to JOBS compiles at once, on the build server if there is one) and then run it with args
+void run(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const std::vector<std::string> ARGS, const BuildType TYPE, const size_t JOBS) {
+	string executable;
+	if(!build_on_server(DEBUG, DEFAULT_FEATURES, FEATURES, TYPE, JOBS, executable)) {
+		executable = build(DEBUG, DEFAULT_FEATURES, FEATURES, TYPE, JOBS);
+	}
+	const string EXECUTABLE = executable;
 
-)""" + BUILD_DIR + R"""(/%.o: src/%.cpp
-	@$(CXX) $(CFLAGS) -o $@ -c $<)""" + pkgCompileFlags + R"""(
+	eprintlnf("%s%s%s %s:%s%s", fmt::ITALIC, colors::CYAN, (TYPE == BuildType::TEST ? "Testing" : "Running project"), fs::path(EXECUTABLE).filename().string().c_str(), colors::REVERT, fmt::REVERT_ITALIC);
+#ifndef WINDOWS
+	// The project replaces cog, so signals like Ctrl+C reach it directly and its exit code is cog's
+	if(TYPE == BuildType::NORMAL) {
+		commands::exec(get_executable_argv(EXECUTABLE, ARGS));
+	}
+#endif
 
-)""" + dependencyRules);
+	eprintlnf("%s%sProject exited with code %i%s%s", fmt::ITALIC, colors::CYAN, run_executable(EXECUTABLE, ARGS), colors::REVERT, fmt::REVERT_ITALIC);
+}
 
-	vector<string> args = {"--makefile=" + BUILD_DIR + "/makefile", "--silent"};
-	if(forceRebuild) {
-		args.push_back("--always-make");
-	}
+/// @brief Builds an instrumented release binary, trains it by running it with ARGS (or by running the tests named in ARGS if TESTS), and rebuilds it optimized with the collected profile.
+/// Returns the path of the optimized executable
+std::string build_with_pgo(const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const bool TESTS, const std::vector<std::string> ARGS, const size_t JOBS, const configstring::ConfigObject &CONFIG) {
+	const string INSTRUMENTED = build(false, DEFAULT_FEATURES, FEATURES, TESTS ? BuildType::TEST : BuildType::NORMAL, JOBS, PgoPhase::GENERATE, CONFIG);
 
-	const auto MAKE_RESULT = commands::run(whichMake, args);
-	if(MAKE_RESULT != 0) {
-		throw runtime_error("Error running make");
+	eprintlnf("%s%sTraining %s:%s%s", fmt::ITALIC, colors::CYAN, fs::path(INSTRUMENTED).filename().string().c_str(), colors::REVERT, fmt::REVERT_ITALIC);
+	const int STATUS = run_executable(INSTRUMENTED, ARGS);
+	if(STATUS != 0) {
+		eprintlnf("%sTraining run exited with code %i, its profile may not be representative%s", colors::YELLOW, STATUS, colors::REVERT);
 	}
-}
 
-/// @brief Build the project and then run it with args
-void run(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const std::vector<std::string> ARGS, const BuildType TYPE, const configstring::ConfigObject CONFIG) {
-	build(DEBUG, DEFAULT_FEATURES, FEATURES, TYPE, CONFIG);
+	return build(false, DEFAULT_FEATURES, FEATURES, BuildType::NORMAL, JOBS, PgoPhase::USE, CONFIG);
+}
 
-	string name;
-	get_string_from_config(CONFIG, "project.name", name);
+/// @brief True if the working directory holds a workspace (a workspace.cfg) rather than a project
+bool is_workspace() {
+	return files::fexists(WORKSPACE_FILE) && !files::fexists("project.cfg") && !files::fexists("project.config");
+}
 
+/// @brief Builds every member project listed in workspace.cfg, each after the members it depends on (workspace.depends in its config) and up to JOBS compiles
+/// at once across all of them (workspace.jobs or one per hardware thread if 0). Every member's own build runs, which finishes right away if it has nothing to do
+void build_workspace(const bool DEBUG, const size_t JOBS) {
 #ifdef WINDOWS
-	const char CMD_PATH_SEPARATOR = '\\';
-	name += ".exe";
+	throw runtime_error("Workspaces are not supported on Windows");
 #else
-	const char CMD_PATH_SEPARATOR = '/';
+	const configstring::ConfigObject WORKSPACE = configstring::parse(files::load(WORKSPACE_FILE).view());
+
+	struct Member {
+		/// @brief Where the member's profiles go unless COG_BUILD_DIR is set (build.dir in its config, relative to dir)
+		string dir, name, buildRoot;
+		vector<string> depends;
+		size_t job = 0;
+	};
+	vector<Member> members;
+	map<string, size_t> byName;
+	string membersValue = "";
+	get_string_from_config(WORKSPACE, WORKSPACE_MEMBERS_KEY, membersValue);
+	for(const string &ITEM : configstring::stringlib::str_split(membersValue, (const char)',')) {
+		const string DIR = dependencies::normalize_path(configstring::stringlib::str_trim(ITEM));
+		if(DIR.empty()) {
+			continue;
+		}
+		const string CONFIG_FILE = files::fexists(DIR + "/project.config") ? DIR + "/project.config" : DIR + "/project.cfg";
+		if(!files::fexists(CONFIG_FILE)) {
+			throw runtime_error(format("Workspace member \"%s\" has no project.cfg", commands::escape_quotes(DIR).c_str()));
+		}
+		const configstring::ConfigObject CONFIG = configstring::parse(files::load(CONFIG_FILE).view());
+
+		Member member;
+		member.dir = DIR;
+		get_string_from_config(CONFIG, "project.name", member.name);
+		string buildDir = "build";
+		get_optional_string_from_config(CONFIG, "build.dir", buildDir);
+		member.buildRoot = (fs::path(DIR) / buildDir).string();
+		string dependsValue = "";
+		get_optional_string_from_config(CONFIG, WORKSPACE_DEPENDS_KEY, dependsValue);
+		for(const string &NAME : configstring::stringlib::str_split(dependsValue, (const char)',')) {
+			if(!configstring::stringlib::str_trim(NAME).empty()) {
+				member.depends.push_back(configstring::stringlib::str_trim(NAME));
+			}
+		}
+		if(!byName.emplace(member.name, members.size()).second) {
+			throw runtime_error(format("Two workspace members are named \"%s\"", commands::escape_quotes(member.name).c_str()));
+		}
+		members.push_back(member);
+	}
+
+	// Members are added to the scheduler after everything they depend on, which also finds cycles
+	vector<size_t> order;
+	vector<int> state(members.size(), 0);
+	const function<void(size_t)> VISIT = [&](const size_t I) {
+		if(state[I] == 2) {
+			return;
+		} else if(state[I] == 1) {
+			throw runtime_error(format("Workspace member \"%s\" depends on itself through workspace.depends", commands::escape_quotes(members[I].name).c_str()));
+		}
+		state[I] = 1;
+		for(const string &NAME : members[I].depends) {
+			const auto DEPENDENCY = byName.find(NAME);
+			if(DEPENDENCY == byName.end()) {
+				throw runtime_error(format("Workspace member \"%s\" depends on \"%s\", which is not a member", commands::escape_quotes(members[I].name).c_str(), commands::escape_quotes(NAME).c_str()));
+			}
+			VISIT(DEPENDENCY->second);
+		}
+		state[I] = 2;
+		order.push_back(I);
+	};
+	for(size_t i = 0; i < members.size(); i++) {
+		VISIT(i);
+	}
+
+	double configJobs = 0;
+	get_optional_double_from_config(WORKSPACE, "workspace.jobs", configJobs);
+	const size_t BUDGET = JOBS > 0 ? JOBS : configJobs >= 1 ? (size_t)configJobs : threads::default_concurrency();
+
+	// Members are built by cog itself, in their own directories, and share one job budget through a jobserver
+	error_code error;
+	const string SELF = fs::read_symlink("/proc/self/exe", error).string();
+	const string COG = error ? "cog" : SELF;
+	const string OUTER_BUILD_DIR = commands::get_env_var("COG_BUILD_DIR");
+	const string STATE_DIR = OUTER_BUILD_DIR.empty() ? "build" : OUTER_BUILD_DIR;
+	const string SHARED_RESULTS = fs::absolute(STATE_DIR + "/pkg-config").string();
+	fs::remove_all(SHARED_RESULTS, error);
+	fs::create_directories(SHARED_RESULTS);
+	jobserver::Server server(BUDGET);
+	commands::set_env_var(PKG_CONFIG_CACHE_VARIABLE, SHARED_RESULTS);
+	// A build server would not see the jobserver
+	commands::set_env_var("COG_NO_DAEMON", "1");
+
+	executor::Scheduler scheduler(min(BUDGET, max(members.size(), (size_t)1)));
+	for(const size_t I : order) {
+		Member &member = members[I];
+		vector<size_t> dependencies;
+		for(const string &NAME : member.depends) {
+			dependencies.push_back(members[byName[NAME]].job);
+		}
+		member.job = scheduler.add(member.name, [&, I](const bool, string &output) {
+			const Member &MEMBER = members[I];
+			// Each member keeps its own profiles under a shared COG_BUILD_DIR
+			const string BUILD_ROOT = OUTER_BUILD_DIR.empty() ? MEMBER.buildRoot : fs::absolute(OUTER_BUILD_DIR + "/" + MEMBER.name).string();
+			const vector<string> ENV = OUTER_BUILD_DIR.empty() ? vector<string>() : vector<string> {"COG_BUILD_DIR=" + BUILD_ROOT};
+			vector<string> argv = {COG, "build", "--jobs", to_string(BUDGET)};
+			if(!DEBUG) {
+				argv.push_back("--release");
+			}
+
+			// A member counts as built if its build replaced an executable, since an up to date build changes nothing
+			const string BEFORE = get_executables_fingerprint(BUILD_ROOT, MEMBER.name);
+			commands::Process process(argv, commands::Stream::CAPTURE, commands::Stream::MERGE, MEMBER.dir, ENV);
+			process.wait();
+			output += format("%s%sBuilt %s (%s)%s%s\n", fmt::ITALIC, colors::CYAN, MEMBER.name.c_str(), MEMBER.dir.c_str(), colors::REVERT, fmt::REVERT_ITALIC) + process.get_output();
+			if(process.get_exit_code() != 0) {
+				output += format("%sError building workspace member %s%s\n", colors::RED, MEMBER.name.c_str(), colors::REVERT);
+				return executor::JobResult::FAILED;
+			}
+
+			return get_executables_fingerprint(BUILD_ROOT, MEMBER.name) == BEFORE ? executor::JobResult::UP_TO_DATE : executor::JobResult::BUILT;
+		}, dependencies);
+	}
+	const bool SUCCEEDED = scheduler.wait();
+
+	size_t built = 0;
+	for(const Member &MEMBER : members) {
+		built += scheduler.result(MEMBER.job) == executor::JobResult::BUILT ? 1 : 0;
+	}
+	eprintlnf("%sBuilt %zu of %zu workspace members%s", colors::CYAN, built, members.size(), colors::REVERT);
+	if(!SUCCEEDED) {
+		throw runtime_error("Error building workspace");
+	}
 #endif
+}
 
-	eprintlnf("%s%s%s %s:%s%s", fmt::ITALIC, colors::CYAN, (TYPE == BuildType::TEST ? "Testing" : "Running project"), name.c_str(), colors::REVERT, fmt::REVERT_ITALIC);
-	
-	eprintlnf("%s%sProject exited with code %i%s%s", fmt::ITALIC, colors::CYAN, commands::run(format(".%c%s%c\"%s\"", CMD_PATH_SEPARATOR, get_build_dir(TYPE).c_str(), CMD_PATH_SEPARATOR, commands::escape_quotes(name).c_str()), ARGS), colors::REVERT, fmt::REVERT_ITALIC);
-}
\ No newline at end of file
+/// @brief Removes profile directories in the build root that have not been built in DAYS days, keeping the most recently built debug, release, and test profiles
+void collect_garbage(const double DAYS, const configstring::ConfigObject &CONFIG) {
+	const string BUILD_ROOT = get_build_root(CONFIG);
+	if(!fs::is_directory(BUILD_ROOT)) {
+		return;
+	}
+
+	// Only directories cog made are touched, which are recognized by their lock
+	struct Profile {
+		fs::path path;
+		fs::file_time_type lastBuilt;
+	};
+	map<string, vector<Profile>> profiles;
+	for(const auto &entry : fs::directory_iterator(BUILD_ROOT)) {
+		const fs::path LOCK = entry.path() / PROFILE_LOCK_FILE;
+		if(!entry.is_directory() || !fs::exists(LOCK)) {
+			continue;
+		}
+		string name = "";
+		try {
+			get_optional_string_from_config(configstring::parse(files::load(LOCK.string()).view()), PROFILE_LOCK_KEY, name);
+		} catch(const runtime_error &ERR) {
+			continue;
+		}
+		profiles[name].push_back({entry.path(), fs::last_write_time(LOCK)});
+	}
+
+	const auto CUTOFF = fs::file_time_type::clock::now() - chrono::duration_cast<fs::file_time_type::duration>(chrono::duration<double>(DAYS * 24 * 60 * 60));
+	size_t removed = 0;
+	for(auto &[NAME, list] : profiles) {
+		sort(list.begin(), list.end(), [](const Profile &A, const Profile &B) { return A.lastBuilt > B.lastBuilt; });
+		for(size_t i = 1; i < list.size(); i++) {
+			if(list[i].lastBuilt < CUTOFF) {
+				printlnf("%sRemoving %s%s", colors::CYAN, list[i].path.string().c_str(), colors::REVERT);
+				fs::remove_all(list[i].path);
+				removed++;
+			}
+		}
+	}
+	printlnf("Removed %zu stale profile director%s", removed, removed == 1 ? "y" : "ies");
+}
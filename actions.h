@@ -7,27 +7,73 @@
 #include "filesystem.h"
 #include "confighelper.h"
 #include "configstring/configstring.h"
+#include "dependencies.h"
 
 enum BuildType {
     NORMAL, TEST
 };
 
-/// @brief Gets the directory for different build types (NORMAL => "build", TEST => "test")
-std::string get_build_dir(const BuildType TYPE);
+enum PgoPhase {
+    /// @brief A plain build without profile guided optimization
+    OFF,
+    /// @brief An instrumented release build that records a profile when run
+    GENERATE,
+    /// @brief A release build optimized with the profile collected by the last GENERATE build
+    USE
+};
+
+/// @brief Gets the directory holding every build profile: $COG_BUILD_DIR, else build.dir from CONFIG, else "build"
+std::string get_build_root(const configstring::ConfigObject &CONFIG = get_config());
 
 /// @brief Make a new project called NAME in a new folder called NAME. A default main.cpp and project.cfg is generated
 void create_new_project(const std::string NAME);
 
-/// @brief For the C++ source file at FILE, recursively get all dependencies for make to watch timestamps
-std::string get_make_dependencies(const FILESYSTEM_NAMESPACE::path FILE);
+/// @brief Gets the object file path in BUILD_DIR for the C++ source file at FILE (src/a/b.cpp => BUILD_DIR/a/b.o, BUILD_DIR/c.cpp => BUILD_DIR/c.o)
+std::string get_object_path(const std::string FILE, const std::string BUILD_DIR);
+
+/// @brief For the C++ source file at FILE, get the make rule for its object in BUILD_DIR listing every file it depends on (GRAPH must already contain FILE)
+std::string get_make_dependencies(const dependencies::IncludeGraph &GRAPH, const std::string FILE, const std::string BUILD_DIR);
+
+/// @brief Gets the makefile that links TARGET from OBJECT_FILES (each path preceded by a space) with CXX, compiling sources in src and BUILD_DIR into BUILD_DIR.
+/// The flags are quoted for the shell, and RULES (like the dependencies of each object) are added at the end. TARGET is not quoted, make would take the quotes as part of the name and relink every time
+std::string get_makefile(const std::string &BUILD_DIR, const std::string &TARGET, const std::string &CXX, const std::string &OBJECT_FILES, const std::vector<std::string> &COMPILE_FLAGS,
+    const std::vector<std::string> &FORCE_INCLUDE_FLAGS, const std::vector<std::string> &PKG_COMPILE_FLAGS, const std::vector<std::string> &LINK_FLAGS, const std::string &RULES);
 
 /// @brief Print cog's help message
 void show_help();
 
-/// @brief Build the project from the given config settings and set debug mode (defines the DEBUG macro for the project if true)
-void build(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const configstring::ConfigObject CONFIG = get_config());
+/// @brief Build the project from the given config settings and set debug mode (defines the DEBUG macro for the project if true).
+/// JOBS is the number of compiles to run at once (build.jobs or one per hardware thread if 0). Returns the path of the executable
+std::string build(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const size_t JOBS = 0, const PgoPhase PGO = PgoPhase::OFF, const configstring::ConfigObject &CONFIG = get_config());
+
+/// @brief Builds the project, then rebuilds it whenever src, packages, or the project config change until interrupted. With RUN, the project (or its tests if TYPE is TEST)
+/// is started with ARGS after each build that produced a new executable, stopping the previous run first
+void watch(const bool RUN, const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const std::vector<std::string> ARGS, const BuildType TYPE, const size_t JOBS = 0);
+
+/// @brief Asks the build server of the project to build it (see build), starting one first if build.daemon is set and none is running.
+/// Returns false if no server could build it for this process, in which case it should be built in-process. Errors from the build are thrown
+bool build_on_server(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const BuildType TYPE, const size_t JOBS, std::string &executable);
+
+/// @brief Serves build requests for the project (see build_on_server) until stopped or idle for build.daemon.idle minutes (30 by default).
+/// Resolved plans and include graphs are kept between builds, and only made again when the config or packages change
+void serve_builds(const configstring::ConfigObject &CONFIG = get_config());
+
+/// @brief Build the project (with up to JOBS compiles at once, on the build server if there is one) and then run it with args
+void run(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const std::vector<std::string> ARGS, const BuildType TYPE, const size_t JOBS = 0);
+
+/// @brief Builds an instrumented release binary, trains it by running it with ARGS (or by running the tests named in ARGS if TESTS), and rebuilds it optimized with the collected profile.
+/// Returns the path of the optimized executable
+std::string build_with_pgo(const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const bool TESTS, const std::vector<std::string> ARGS, const size_t JOBS = 0, const configstring::ConfigObject &CONFIG = get_config());
+
+/// @brief True if the working directory holds a workspace (a workspace.cfg) rather than a project
+bool is_workspace();
+
+/// @brief Builds every member project listed in workspace.cfg, each after the members it depends on (workspace.depends in its config) and up to JOBS compiles
+/// at once across all of them (workspace.jobs or one per hardware thread if 0). Members whose files did not change since they were last built, and that depend on
+/// no member that was rebuilt, are skipped
+void build_workspace(const bool DEBUG, const size_t JOBS = 0);
 
-/// @brief Build the project and then run it with args
-void run(const bool DEBUG, const bool DEFAULT_FEATURES, const std::vector<std::string> FEATURES, const std::vector<std::string> ARGS, const BuildType TYPE, const configstring::ConfigObject CONFIG = get_config());
+/// @brief Removes profile directories in the build root that have not been built in DAYS days, keeping the most recently built debug, release, and test profiles
+void collect_garbage(const double DAYS = 7, const configstring::ConfigObject &CONFIG = get_config());
 
 #endif
\ No newline at end of file
@@ -0,0 +1,239 @@
+// Times cog's own hot paths on generated inputs and prints the results as JSON. Given a baseline (the JSON of an earlier run), every benchmark
+// slower than its baseline by more than the threshold is reported as a regression and the exit status is 1.
+// Usage: bench/cog_bench [--filter TEXT] [--output FILE] [--baseline FILE] [--threshold PERCENT]
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../actions.h"
+#include "../configstring/configstring.h"
+#include "../console.hpp"
+#include "../dependencies.h"
+#include "../files.h"
+#include "../filesystem.h"
+#include "workloads.h"
+
+#ifdef WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = FILESYSTEM_NAMESPACE;
+using namespace std;
+using namespace console;
+
+namespace {
+    struct Result {
+        string name;
+        /// @brief Milliseconds per run, the fastest of every sample
+        double ms = 0;
+        size_t runs = 0;
+    };
+
+    /// @brief Only benchmarks whose name contains this are run
+    string filter = "";
+    vector<Result> results;
+
+    /// @brief Times RUN as the benchmark NAME unless it is filtered out. RUN is repeated until at least 40 ms have passed, five times over, and the
+    /// fastest of those samples is kept since it is the least disturbed by the rest of the machine
+    template<typename Run>
+    void measure(const string &NAME, const Run RUN) {
+        if(NAME.find(filter) == string::npos) {
+            return;
+        }
+        Result result;
+        result.name = NAME;
+        for(int sample = 0; sample < 5; sample++) {
+            const auto START = chrono::steady_clock::now();
+            size_t runs = 0;
+            double elapsed = 0;
+            do {
+                RUN();
+                runs++;
+                elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - START).count();
+            } while(elapsed < 40);
+            if(sample == 0 || elapsed / runs < result.ms) {
+                result.ms = elapsed / runs;
+            }
+            result.runs += runs;
+        }
+        fprintf(stderr, "%-40s %12.4f ms\n", NAME.c_str(), result.ms);
+        results.push_back(result);
+    }
+
+    /// @brief Reads the milliseconds of every benchmark from NAME, the JSON written by an earlier run
+    map<string, double> read_baseline(const string &NAME) {
+        const string TEXT = files::fread(NAME);
+        const string NAME_FIELD = "\"name\": \"", MS_FIELD = "\"ms\": ";
+        map<string, double> baseline;
+        for(size_t start = TEXT.find(NAME_FIELD); start != string::npos; start = TEXT.find(NAME_FIELD, start)) {
+            start += NAME_FIELD.length();
+            const size_t END = TEXT.find('"', start), MS = TEXT.find(MS_FIELD, start);
+            if(END == string::npos || MS == string::npos) {
+                throw runtime_error("Invalid baseline \"" + NAME + "\"");
+            }
+            baseline[TEXT.substr(start, END - start)] = strtod(TEXT.c_str() + MS + MS_FIELD.length(), nullptr);
+        }
+        return baseline;
+    }
+
+    void run_benchmarks() {
+        for(const size_t KEYS : {10, 1000, 100000}) {
+            const string TEXT = workloads::generate_config(KEYS);
+            const configstring::ConfigObject CONFIG = configstring::parse(TEXT);
+            measure("configstring/parse/" + to_string(KEYS), [&TEXT]() { return configstring::parse(TEXT); });
+            measure("configstring/stringify/" + to_string(KEYS), [&CONFIG]() { return CONFIG.stringify(); });
+        }
+
+        // Each run looks up every key, since a single lookup is too quick to time on its own
+        const configstring::ConfigObject CONFIG = configstring::parse(workloads::generate_config(10000));
+        vector<string> keys, missing;
+        for(const string_view KEY : CONFIG.keys()) {
+            keys.push_back(string(KEY));
+            missing.push_back(string(KEY) + ".missing");
+        }
+        const auto COUNT_PRESENT = [&CONFIG](const vector<string> &KEYS) {
+            size_t present = 0;
+            for(const string &KEY : KEYS) {
+                present += CONFIG.has(KEY);
+            }
+            return present;
+        };
+        measure("config_object/has/10000", [&COUNT_PRESENT, &keys]() { return COUNT_PRESENT(keys); });
+        measure("config_object/has_missing/10000", [&COUNT_PRESENT, &missing]() { return COUNT_PRESENT(missing); });
+        measure("config_object/get_typed/10000", [&CONFIG, &keys]() {
+            size_t strings = 0;
+            for(const string &KEY : keys) {
+                strings += CONFIG.is<string>(KEY) ? CONFIG.get<string>(KEY).length() : 0;
+            }
+            return strings;
+        });
+        measure("config_object/keys_with_prefix/10000", [&CONFIG]() { return CONFIG.keys_with_prefix("feature.F1"); });
+        measure("config_object/copy/10000", [&CONFIG]() { return configstring::ConfigObject(CONFIG); });
+
+        namespace stringlib = configstring::stringlib;
+        for(const size_t LENGTH : {32, 4096}) {
+            const string TEXT = workloads::generate_text(LENGTH), ENCODED = stringlib::minimal_encode(TEXT), SUFFIX = "/" + to_string(LENGTH);
+            measure("stringlib/str_trim" + SUFFIX, [&TEXT]() { return stringlib::str_trim(TEXT); });
+            measure("stringlib/str_trim_view" + SUFFIX, [&TEXT]() { return stringlib::str_trim_view(TEXT); });
+            measure("stringlib/str_is_empty" + SUFFIX, [&TEXT]() { return stringlib::str_is_empty(TEXT); });
+            measure("stringlib/str_split" + SUFFIX, [&TEXT]() { return stringlib::str_split(TEXT, ' '); });
+            measure("stringlib/str_split_view" + SUFFIX, [&TEXT]() { return stringlib::str_split_view(TEXT, ' '); });
+            measure("stringlib/str_replace" + SUFFIX, [&TEXT]() { return stringlib::str_replace(TEXT, "=", "%3D"); });
+            measure("stringlib/str_to_lower" + SUFFIX, [&TEXT]() { return stringlib::str_to_lower(TEXT); });
+            measure("stringlib/minimal_encode" + SUFFIX, [&TEXT]() { return stringlib::minimal_encode(TEXT); });
+            measure("stringlib/minimal_decode" + SUFFIX, [&ENCODED]() { return stringlib::minimal_decode(ENCODED); });
+        }
+
+        // Sources are found relative to the project, like in a build
+        const fs::path PREVIOUS = fs::current_path();
+        const string DIR = (fs::temp_directory_path() / ("cog-bench-includes-" + to_string(getpid()))).string();
+        workloads::ProjectShape shape;
+        shape.sources = 1000;
+        shape.headers = 256;
+        shape.depth = 8;
+        const vector<string> SOURCES = workloads::generate_project(DIR, shape);
+        fs::current_path(DIR);
+        try {
+            measure("dependencies/scan/1000", [&SOURCES]() {
+                dependencies::IncludeGraph graph;
+                graph.scan(SOURCES);
+                return graph.size();
+            });
+
+            dependencies::IncludeGraph graph;
+            graph.scan(SOURCES);
+            string rules, objectFiles;
+            for(const string &SOURCE : SOURCES) {
+                rules += get_make_dependencies(graph, SOURCE, "build/debug") + '\n';
+                objectFiles += " " + get_object_path(SOURCE, "build/debug");
+            }
+            measure("dependencies/make_rules/1000", [&graph, &SOURCES]() {
+                string result;
+                for(const string &SOURCE : SOURCES) {
+                    result += get_make_dependencies(graph, SOURCE, "build/debug") + '\n';
+                }
+                return result;
+            });
+
+            const vector<string> COMPILE_FLAGS = {"-std=c++17", "-Wall", "-O2", "-DPROJECT_NAME=\"bench\"", "-DPROJECT_VERSION=\"1.0.0\"", "-Isrc/include", "-I$HOME/include"};
+            measure("makefile/generate/1000", [&objectFiles, &rules, &COMPILE_FLAGS]() {
+                return get_makefile("build/debug", "build/debug/bench", "g++", objectFiles, COMPILE_FLAGS, {}, {"-I/usr/include/pkg"}, {"-lz", "-pthread"}, rules);
+            });
+        } catch(...) {
+            fs::current_path(PREVIOUS);
+            fs::remove_all(DIR);
+            throw;
+        }
+        fs::current_path(PREVIOUS);
+        fs::remove_all(DIR);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    string output = "", baselineFile = "";
+    double threshold = 20;
+    for(int i = 1; i < argc; i++) {
+        const string ARG = argv[i];
+        if(i + 1 < argc && (ARG == "--filter" || ARG == "--output" || ARG == "--baseline" || ARG == "--threshold")) {
+            const string VALUE = argv[++i];
+            if(ARG == "--filter") {
+                filter = VALUE;
+            } else if(ARG == "--output") {
+                output = VALUE;
+            } else if(ARG == "--baseline") {
+                baselineFile = VALUE;
+            } else {
+                threshold = strtod(VALUE.c_str(), nullptr);
+            }
+        } else {
+            fprintf(stderr, "Usage: bench/cog_bench [--filter TEXT] [--output FILE] [--baseline FILE] [--threshold PERCENT]\n");
+            return 2;
+        }
+    }
+
+    try {
+        // Read first so a missing baseline is reported before the benchmarks run
+        const map<string, double> BASELINE = baselineFile.empty() ? map<string, double>() : read_baseline(baselineFile);
+        run_benchmarks();
+
+        size_t regressions = 0;
+        string json = "{\n  \"benchmarks\": [\n";
+        for(size_t i = 0; i < results.size(); i++) {
+            const Result &RESULT = results[i];
+            json += format("    {\"name\": \"%s\", \"ms\": %.6f, \"runs\": %zu", RESULT.name.c_str(), RESULT.ms, RESULT.runs);
+            const auto ITER = BASELINE.find(RESULT.name);
+            if(ITER != BASELINE.end() && ITER->second > 0) {
+                const double CHANGE = RESULT.ms / ITER->second - 1;
+                const bool REGRESSION = CHANGE * 100 > threshold;
+                json += format(", \"baseline_ms\": %.6f, \"change\": %.4f, \"regression\": %s", ITER->second, CHANGE, REGRESSION ? "true" : "false");
+                if(REGRESSION) {
+                    fprintf(stderr, "Regression in %s: %.4f ms => %.4f ms (%+.1f%%)\n", RESULT.name.c_str(), ITER->second, RESULT.ms, CHANGE * 100);
+                    regressions++;
+                }
+            }
+            json += i + 1 < results.size() ? "},\n" : "}\n";
+        }
+        json += "  ]\n}\n";
+
+        if(output.empty()) {
+            fputs(json.c_str(), stdout);
+        } else {
+            files::fwrite(output, json);
+        }
+        if(!baselineFile.empty()) {
+            fprintf(stderr, "%zu of %zu benchmarks more than %.0f%% slower than \"%s\"\n", regressions, results.size(), threshold, baselineFile.c_str());
+        }
+        return regressions == 0 ? 0 : 1;
+    } catch(const exception &ERR) {
+        fprintf(stderr, "Error: %s\n", ERR.what());
+        return 2;
+    }
+}
@@ -0,0 +1,209 @@
+// Compares configstring::parse and configstring::stringlib against the originals in legacy.cpp: first that both give the same result
+// for generated configs and random input, then how long each takes on inputs of increasing size.
+// Usage: bench/configstring_bench
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../configstring/configstring.h"
+#include "legacy.h"
+#include "workloads.h"
+
+using namespace std;
+using workloads::generate_config;
+
+namespace {
+    /// @brief Parses TEXT with PARSE, returning its stringified result or the error prefixed with "!"
+    template<typename Parse>
+    string outcome(const Parse PARSE, const string &TEXT) {
+        try {
+            const configstring::ConfigObject CONFIG = PARSE(TEXT);
+            return to_string(CONFIG.size()) + ":" + CONFIG.stringify();
+        } catch(const runtime_error &ERR) {
+            return "!";
+        }
+    }
+
+    /// @brief Prints TEXT and returns false if the parsers disagree on it
+    bool check(const string &TEXT) {
+        const string EXPECTED = outcome(legacy::parse, TEXT), ACTUAL = outcome([](const string &T) { return configstring::parse(T); }, TEXT);
+        if(EXPECTED != ACTUAL) {
+            printf("Mismatch parsing \"%s\"\n  legacy: %s\n  new:    %s\n", TEXT.c_str(), EXPECTED.c_str(), ACTUAL.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Prints the first input the string functions disagree on and returns false, or returns true if they agree on TEXT
+    bool check_stringlib(const string &TEXT) {
+        namespace next = configstring::stringlib;
+        namespace old = legacy::stringlib;
+        const auto JOIN = [](const auto &PIECES) {
+            string result = to_string(PIECES.size());
+            for(const auto &PIECE : PIECES) {
+                result.append("|").append(PIECE);
+            }
+            return result;
+        };
+        const auto APPENDED = [](const auto APPEND) {
+            string out = "prefix";
+            APPEND(out);
+            return out.substr(6);
+        };
+        const string VIEW(string_view(TEXT).substr(TEXT.length() % 3)), LEGACY_VIEW = TEXT.substr(TEXT.length() % 3);
+
+        vector<pair<string, pair<string, string>>> results = {
+            {"str_trim", {old::str_trim(TEXT), next::str_trim(TEXT)}},
+            {"str_trim_view", {old::str_trim(LEGACY_VIEW), string(next::str_trim_view(string_view(TEXT).substr(TEXT.length() % 3)))}},
+            {"str_is_empty", {to_string(old::str_is_empty(TEXT)), to_string(next::str_is_empty(TEXT))}},
+            {"str_to_lower", {old::str_to_lower(TEXT), next::str_to_lower(TEXT)}},
+            {"str_to_lower append", {old::str_to_lower(TEXT), APPENDED([&TEXT](string &out) { next::str_to_lower(TEXT, out); })}},
+            {"minimal_encode", {old::minimal_encode(TEXT), next::minimal_encode(TEXT)}},
+            {"minimal_encode append", {old::minimal_encode(TEXT), APPENDED([&TEXT](string &out) { next::minimal_encode(TEXT, out); })}},
+            {"minimal_decode", {old::minimal_decode(TEXT), next::minimal_decode(TEXT)}},
+            {"minimal_decode append", {old::minimal_decode(VIEW), APPENDED([&VIEW](string &out) { next::minimal_decode(VIEW, out); })}}
+        };
+        for(const char DELIMITER : {';', ' ', '%'}) {
+            results.push_back({string("str_split ") + DELIMITER, {JOIN(old::str_split(TEXT, DELIMITER)), JOIN(next::str_split(TEXT, DELIMITER))}});
+            results.push_back({string("str_split_view ") + DELIMITER, {JOIN(old::str_split(TEXT, DELIMITER)), JOIN(next::str_split_view(TEXT, DELIMITER))}});
+        }
+        for(const auto &[FROM, TO] : vector<pair<string, string>> {{"%3", ""}, {"aa", "a"}, {"=", "%3D"}, {"a", "aa"}, {" \t", "_"}}) {
+            results.push_back({"str_replace " + FROM, {old::str_replace(TEXT, FROM, TO), next::str_replace(TEXT, FROM, TO)}});
+        }
+
+        for(const auto &[NAME, OUTCOMES] : results) {
+            if(OUTCOMES.first != OUTCOMES.second) {
+                printf("Mismatch in %s for \"%s\"\n  legacy: \"%s\"\n  new:    \"%s\"\n", NAME.c_str(), TEXT.c_str(), OUTCOMES.first.c_str(), OUTCOMES.second.c_str());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Average milliseconds RUN takes, repeated until at least a fifth of a second has passed
+    template<typename Run>
+    double time_ms(const Run RUN) {
+        const auto START = chrono::steady_clock::now();
+        size_t runs = 0;
+        double elapsed = 0;
+        do {
+            RUN();
+            runs++;
+            elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - START).count();
+        } while(elapsed < 200);
+        return elapsed / runs;
+    }
+}
+
+int main() {
+    bool same = true;
+    for(const string &TEXT : vector<string> {
+        "", ";", ";;", "a", "a=", "a==", "=", "=b", "a=b=", "a=b==", "a==b", "a=b=c", " a = b ; c=d", "# comment=with=equals;a=1",
+        "a=%3B%3D%25;b=%253B", "a=%%3B;b=%3", "a=\"\";b=\";c=\"x\"y\"", "a=TRUE;b=False;c=nUlL;d= ;e=\t", "a=1;b=1.5;c=1.;d=.5;e=-1;f=007",
+        "a=1\n\n# comment\n;b=2=", "\ta\t=\tb\t;\n", "k%3Dey=v;k%3Dey=w"
+    }) {
+        same = check(TEXT) && same;
+    }
+    for(const size_t KEYS : {10, 1000}) {
+        same = check(generate_config(KEYS)) && same;
+    }
+
+    // Random input made of the characters the parser treats specially
+    mt19937 random(2003);
+    const string ALPHABET = "ab=;%3BD25 \t\n#\"tT.1";
+    for(int i = 0; i < 20000; i++) {
+        string text(random() % 24, ' ');
+        for(char &c : text) {
+            c = ALPHABET[random() % ALPHABET.length()];
+        }
+        same = check(text) && same;
+    }
+    printf("%s\n", same ? "Both parsers agree on every input" : "The parsers disagree");
+
+    // Random input long enough to cross SIMD blocks at every alignment, made of whitespace, encoded characters, both cases, and bytes
+    // outside ASCII
+    bool sameStrings = true;
+    const string BYTES = string(" \t\n\v\f\r%3BD25=;aAzZ@[`{#\x80\xff") + '\0';
+    for(int i = 0; i < 5000 && sameStrings; i++) {
+        string text(random() % 100, ' ');
+        const size_t VARIETY = 1 + random() % BYTES.length();
+        for(char &c : text) {
+            c = BYTES[random() % VARIETY];
+        }
+        sameStrings = check_stringlib(text);
+    }
+    printf("%s\n", sameStrings ? "Both string libraries agree on every input" : "The string libraries disagree");
+
+    // The hashed index and prefix queries must agree with a scan of keys(), including after removals shift later keys down
+    bool indexed = true;
+    configstring::ConfigObject config = configstring::parse(generate_config(1000));
+    vector<string> removed;
+    for(size_t i = 0; i < config.keys().size(); i += 7) {
+        removed.push_back(string(config.keys()[i]));
+        delete config.remove(removed.back());
+    }
+    for(const string &KEY : removed) {
+        indexed = indexed && !config.has(KEY);
+    }
+    for(const string &PREFIX : vector<string> {"", "feature.", "feature.F1", "pkg.", "pkg.lib99", "lock.", "zzz"}) {
+        vector<string_view> scanned;
+        for(const string_view KEY : config.keys()) {
+            if(KEY.rfind(PREFIX, 0) == 0) {
+                scanned.push_back(KEY);
+                indexed = indexed && config.has(KEY);
+            }
+        }
+        indexed = indexed && config.keys_with_prefix(PREFIX) == scanned;
+    }
+    printf("%s\n", indexed ? "The index agrees with a scan of every key" : "The index disagrees with a scan of every key");
+
+    // Snapshots must load back to the same config, and any damage to one must be detected
+    bool restored = true;
+    for(const size_t KEYS : {0, 10, 1000}) {
+        const configstring::ConfigObject ORIGINAL = configstring::parse(generate_config(KEYS));
+        const string SNAPSHOT = ORIGINAL.snapshot();
+        restored = restored && configstring::ConfigObject::from_snapshot(SNAPSHOT).stringify() == ORIGINAL.stringify();
+        for(size_t i = 0; i < SNAPSHOT.length(); i += 1 + random() % 97) {
+            string damaged = SNAPSHOT;
+            damaged[i] ^= 1 << (random() % 8);
+            restored = restored && outcome([](const string &T) { return configstring::ConfigObject::from_snapshot(T); }, damaged) == "!";
+        }
+        restored = restored && outcome([](const string &T) { return configstring::ConfigObject::from_snapshot(T); }, SNAPSHOT.substr(0, SNAPSHOT.length() / 2)) == "!";
+    }
+    printf("%s\n", restored ? "Snapshots load back unchanged and damage is detected" : "Snapshots do not load back unchanged");
+
+    for(const size_t KEYS : {10, 1000, 10000}) {
+        const string TEXT = generate_config(KEYS);
+        const double LEGACY = time_ms([&TEXT]() { return legacy::parse(TEXT); }), NEW = time_ms([&TEXT]() { return configstring::parse(TEXT); });
+        printf("parse %6zu keys (%7zu bytes): legacy %9.3f ms, new %9.3f ms (%.1fx)\n", KEYS, TEXT.length(), LEGACY, NEW, LEGACY / NEW);
+    }
+
+    // Copies happen whenever a config is passed or returned by value
+    const configstring::ConfigObject LARGE = configstring::parse(generate_config(10000));
+    printf("copy  %6zu keys: %9.3f ms\n", LARGE.size(), time_ms([&LARGE]() { return configstring::ConfigObject(LARGE); }));
+    const string SNAPSHOT = LARGE.snapshot();
+    printf("load  %6zu keys (%7zu bytes) from a snapshot: %9.3f ms\n", LARGE.size(), SNAPSHOT.length(), time_ms([&SNAPSHOT]() { return configstring::ConfigObject::from_snapshot(SNAPSHOT); }));
+
+    // Config values, commands, and compiler output are short, but paths and dependency lists can be long
+    for(const size_t LENGTH : {32, 4096}) {
+        const string TEXT = workloads::generate_text(LENGTH);
+        const string ENCODED = legacy::stringlib::minimal_encode(TEXT);
+        const vector<pair<string, pair<double, double>>> TIMES = {
+            {"str_trim", {time_ms([&TEXT]() { return legacy::stringlib::str_trim(TEXT); }), time_ms([&TEXT]() { return configstring::stringlib::str_trim(TEXT); })}},
+            {"str_is_empty", {time_ms([&TEXT]() { return legacy::stringlib::str_is_empty(TEXT); }), time_ms([&TEXT]() { return configstring::stringlib::str_is_empty(TEXT); })}},
+            {"str_split", {time_ms([&TEXT]() { return legacy::stringlib::str_split(TEXT, ' '); }), time_ms([&TEXT]() { return configstring::stringlib::str_split(TEXT, ' '); })}},
+            {"str_replace", {time_ms([&TEXT]() { return legacy::stringlib::str_replace(TEXT, "=", "%3D"); }), time_ms([&TEXT]() { return configstring::stringlib::str_replace(TEXT, "=", "%3D"); })}},
+            {"str_to_lower", {time_ms([&TEXT]() { return legacy::stringlib::str_to_lower(TEXT); }), time_ms([&TEXT]() { return configstring::stringlib::str_to_lower(TEXT); })}},
+            {"minimal_encode", {time_ms([&TEXT]() { return legacy::stringlib::minimal_encode(TEXT); }), time_ms([&TEXT]() { return configstring::stringlib::minimal_encode(TEXT); })}},
+            {"minimal_decode", {time_ms([&ENCODED]() { return legacy::stringlib::minimal_decode(ENCODED); }), time_ms([&ENCODED]() { return configstring::stringlib::minimal_decode(ENCODED); })}}
+        };
+        for(const auto &[NAME, TIME] : TIMES) {
+            printf("%-14s %4zu bytes: legacy %9.4f ms, new %9.4f ms (%.1fx)\n", NAME.c_str(), TEXT.length(), TIME.first, TIME.second, TIME.first / TIME.second);
+        }
+    }
+    return same && sameStrings && indexed && restored ? 0 : 1;
+}
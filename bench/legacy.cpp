@@ -0,0 +1,111 @@
+#include "legacy.h"
+
+#include <algorithm>
+#include <regex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace legacy {
+    namespace stringlib {
+        std::string str_replace(std::string text, const std::string FROM, const std::string TO) {
+            size_t start_pos = 0;
+            while((start_pos = text.find(FROM, start_pos)) != std::string::npos) {
+                text.replace(start_pos, FROM.length(), TO);
+                start_pos += TO.length();
+            }
+            return text;
+        }
+
+        std::vector<std::string> str_split(const std::string& TEXT, const char DELIMITER) {
+            std::vector<std::string> result;
+            std::stringstream stream(TEXT);
+            std::string tmp;
+
+            while (getline(stream, tmp, DELIMITER))
+                result.push_back(tmp);
+
+            return result;
+        }
+
+        std::string minimal_encode(const std::string& TEXT) {
+            return str_replace(
+                str_replace(
+                    str_replace(
+                        TEXT, "%", "%25"
+                    ),
+                    "=", "%3D"
+                ),
+                ";", "%3B"
+            );
+        }
+
+        std::string minimal_decode(const std::string& TEXT) {
+            return str_replace(
+                str_replace(
+                    str_replace(
+                        TEXT, "%3B", ";"
+                    ),
+                    "%3D", "="
+                ),
+                "%25", "%"
+            );
+        }
+
+        bool str_is_empty(const std::string& TEXT) {
+            if(TEXT == "")
+                return true;
+            else
+                return !std::regex_search(TEXT, std::regex(R"(\S)", std::regex_constants::ECMAScript));
+        }
+
+        std::string str_to_lower(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return std::tolower(c); });
+            return text;
+        }
+
+        std::string str_trim(std::string text) {
+            return std::regex_replace(std::regex_replace(text, std::regex(R"(^\s*)", std::regex_constants::ECMAScript), ""), std::regex(R"(\s*$)", std::regex_constants::ECMAScript), "");
+        }
+    }
+
+    using namespace stringlib;
+
+    /// @brief Parses the value portion of an entry with regular expressions
+    configstring::Value* str_to_value(std::string text) {
+        const std::string LOWER = str_to_lower(text);
+        if(LOWER == "true") {
+            return new configstring::Boolean(true);
+        } else if(LOWER == "false") {
+            return new configstring::Boolean(false);
+        } else if(LOWER == "null" || str_is_empty(text)) {
+            return new configstring::Null;
+        } else if(std::regex_match(text, std::regex(R"(^\d+(?:\.\d+)?$)", std::regex_constants::ECMAScript))) {
+            return new configstring::Number(std::stod(text));
+        } else {
+            return new configstring::String(std::regex_replace(text, std::regex("^\"([" R"(\s\S)" "]*)\"$", std::regex_constants::ECMAScript), "$1"));
+        }
+    }
+
+    /// @brief Splits on ; through a stringstream, then each entry on =, trimming and decoding every piece with regular expressions
+    configstring::ConfigObject parse(const std::string& TEXT) {
+        configstring::ConfigObject result;
+        for(const std::string &ENTRY : str_split(TEXT, (const char)';')) {
+            if(!str_is_empty(ENTRY)) {
+                if(str_trim(ENTRY).rfind("#",0) == 0)
+                    continue;
+                const std::vector<std::string> KEYVALUE = str_split(ENTRY, (const char) '=');
+                if(KEYVALUE.size() == 1) {
+                    result.set(minimal_decode(str_trim(KEYVALUE.at(0))), str_to_value(""));
+                }
+                else if(KEYVALUE.size() == 2) {
+                    result.set(minimal_decode(str_trim(KEYVALUE.at(0))), str_to_value(minimal_decode(str_trim(KEYVALUE.at(1)))));
+                } else {
+                    throw std::runtime_error("Not all entries are in the format \"key=value\".");
+                }
+            }
+        }
+        return result;
+    }
+}
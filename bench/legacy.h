@@ -0,0 +1,29 @@
+#ifndef BENCH_LEGACY_H
+#define BENCH_LEGACY_H
+
+#include <string>
+#include <vector>
+
+#include "../configstring/configstring.h"
+
+/// @brief The original implementations of code that has since been rewritten for speed, kept so benchmarks can compare against them
+/// and check that the rewrites still give exactly the same results
+namespace legacy {
+    /// @brief configstring::stringlib as it was, built on std::regex, std::stringstream, and one std::string::replace per match
+    namespace stringlib {
+        std::string str_replace(std::string text, const std::string FROM, const std::string TO);
+        std::vector<std::string> str_split(const std::string& TEXT, const char DELIMITER);
+        std::string minimal_encode(const std::string& TEXT);
+        std::string minimal_decode(const std::string& TEXT);
+        bool str_is_empty(const std::string& TEXT);
+        std::string str_to_lower(std::string text);
+        std::string str_trim(std::string text);
+    }
+
+    /// @brief Splits on ; through a stringstream, then each entry on =, trimming and decoding every piece with regular expressions
+    configstring::ConfigObject parse(const std::string& TEXT);
+
+    /// @brief Parses the value portion of an entry with regular expressions
+    configstring::Value* str_to_value(std::string text);
+}
+#endif
@@ -0,0 +1,71 @@
+#!/usr/bin/env bash
+# Checks that builds kept running between changes (cog watch and the build server) with build.backend=make follow a header that gains an
+# #include: the generated makefile must list the new header, and editing it must rebuild the sources that now depend on it.
+# Usage: bench/make_deps.sh [cog]
+set -e
+
+COG=$(realpath "${1:-./cog}")
+DIR=$(mktemp -d "${TMPDIR:-/tmp}/cog-make-deps-XXXXXX")
+WATCH=""
+cleanup() {
+	[ -z "$WATCH" ] || kill "$WATCH" 2> /dev/null || true
+	(cd "$DIR" && "$COG" daemon stop > /dev/null 2>&1) || true
+	rm -rf "$DIR"
+}
+trap cleanup EXIT
+
+fail() {
+	echo "FAIL: $1" >&2
+	exit 1
+}
+
+# Checks that the makefile lists $1 as a prerequisite of main.o
+check_makefile() {
+	grep -q "main\.o:.*src/$1" build/*/makefile || fail "the makefile does not list src/$1 for main.o"
+	echo "ok: the makefile lists src/$1"
+}
+
+# Waits until the watch log at $1 says it is watching for the $2th time
+wait_for_watch() {
+	for _ in $(seq 300); do
+		[ "$(grep -c "Watching for changes" "$1")" -lt "$2" ] || return 0
+		sleep 0.1
+	done
+	cat "$1" >&2
+	fail "cog watch did not finish build $2"
+}
+
+mkdir -p "$DIR/src"
+cd "$DIR"
+printf 'project.name=deps;\nbuild.backend=make;\nbuild.cache=false;\n' > project.cfg
+printf '#pragma once\n' > src/a.h
+printf '#pragma once\nconstexpr int B = 1;\n' > src/b.h
+printf '#pragma once\nconstexpr int C = 2;\n' > src/c.h
+printf '#include "a.h"\nint main() { return 0; }\n' > src/main.cpp
+
+# cog watch: a.h starts including b.h
+"$COG" watch build > watch.log 2>&1 &
+WATCH=$!
+wait_for_watch watch.log 1
+# Some file systems only keep whole seconds, and the change must be seen as one
+sleep 1
+printf '#pragma once\n#include "b.h"\n' > src/a.h
+wait_for_watch watch.log 2
+check_makefile b.h
+kill "$WATCH"
+wait "$WATCH" 2> /dev/null || true
+WATCH=""
+
+# Build server: a.h starts including c.h, then c.h changes
+"$COG" daemon > /dev/null 2>&1
+"$COG" build > /dev/null 2>&1
+sleep 1
+printf '#pragma once\n#include "b.h"\n#include "c.h"\n' > src/a.h
+"$COG" build > /dev/null 2>&1
+check_makefile c.h
+BUILT=$(stat -c %Y build/*/main.o)
+sleep 1
+printf '#pragma once\nconstexpr int C = 3;\n' > src/c.h
+"$COG" build > /dev/null 2>&1
+[ "$(stat -c %Y build/*/main.o)" != "$BUILT" ] || fail "editing src/c.h did not rebuild main.o through the build server"
+echo "ok: editing src/c.h rebuilt main.o"
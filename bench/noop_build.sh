@@ -0,0 +1,53 @@
+#!/usr/bin/env bash
+# Times a build with nothing to do on a generated project of many source files.
+# Usage: bench/noop_build.sh [cog] [files] [limit ms]
+# The project is kept in $COG_BENCH_DIR (a temporary directory by default) so later runs skip the first full build
+set -e
+
+COG=$(realpath "${1:-./cog}")
+FILES=${2:-10000}
+LIMIT_MS=${3:-50}
+RUNS=5
+DIR=${COG_BENCH_DIR:-${TMPDIR:-/tmp}/cog-bench-noop-$FILES}
+
+# A build server would hide the work being measured
+export COG_NO_DAEMON=1
+
+if [ ! -f "$DIR/project.cfg" ]; then
+	mkdir -p "$DIR/src"
+	printf 'project.name=bench;\nbuild.cache=false;\n' > "$DIR/project.cfg"
+	printf '#pragma once\ninline int shared() { return 1; }\n' > "$DIR/src/shared.h"
+	i=0
+	while [ $i -lt "$FILES" ]; do
+		SUB="$DIR/src/m$((i / 100))"
+		mkdir -p "$SUB"
+		if [ $i -eq 0 ]; then
+			printf '#include "../shared.h"\nint main() { return shared() - 1; }\n' > "$SUB/f$i.cpp"
+		else
+			printf '#pragma once\nint f%d();\n' $i > "$SUB/f$i.h"
+			printf '#include "f%d.h"\n#include "../shared.h"\nint f%d() { return shared() + %d; }\n' $i $i $i > "$SUB/f$i.cpp"
+		fi
+		i=$((i + 1))
+	done
+	echo "Generated $FILES sources in $DIR"
+fi
+
+cd "$DIR"
+echo "Building once so later builds have nothing to do"
+"$COG" build
+
+# EPOCHREALTIME (microseconds) is read without starting a process, which would be timed too
+BEST=""
+for RUN in $(seq $RUNS); do
+	START=${EPOCHREALTIME/[.,]/}
+	"$COG" build
+	END=${EPOCHREALTIME/[.,]/}
+	ELAPSED=$(((10#$END - 10#$START) / 1000))
+	echo "No-op build $RUN: ${ELAPSED} ms"
+	if [ -z "$BEST" ] || [ "$ELAPSED" -lt "$BEST" ]; then
+		BEST=$ELAPSED
+	fi
+done
+
+echo "Best no-op build of $FILES sources: ${BEST} ms (limit ${LIMIT_MS} ms)"
+[ "$BEST" -le "$LIMIT_MS" ]
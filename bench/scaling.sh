@@ -0,0 +1,109 @@
+#!/usr/bin/env bash
+# Times builds of generated projects of several sizes to show how each part of a build scales. Every size gets a cold build, a no-op build,
+# a no-op build that checks every input (like one whose manifest is out of date), and a build after touching one header in the middle of the
+# include tree. All but the plain no-op build run with --timings, so the time spent in each phase is recorded as well.
+# Usage: bench/scaling.sh [cog] [sources...] (100 and 1000 sources by default)
+# The shape of the projects is set by COG_BENCH_HEADERS (headers per 100 sources, 25 by default), COG_BENCH_DEPTH (4), COG_BENCH_FANOUT (3),
+# COG_BENCH_FEATURES (4), and COG_BENCH_PACKAGES (comma separated, none by default). The results are written to $COG_BENCH_OUT
+# (bench/scaling.json by default) in the format of bench/cog_bench, and projects are kept under $COG_BENCH_DIR so later runs skip generating them
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+COG=$(realpath "${1:-$ROOT/cog}")
+shift || true
+SIZES=${*:-100 1000}
+HEADERS_PER_100=${COG_BENCH_HEADERS:-25}
+DEPTH=${COG_BENCH_DEPTH:-4}
+FANOUT=${COG_BENCH_FANOUT:-3}
+FEATURES=${COG_BENCH_FEATURES:-4}
+PACKAGES=${COG_BENCH_PACKAGES:-}
+OUT=$(realpath -m "${COG_BENCH_OUT:-$ROOT/bench/scaling.json}")
+BASE=${COG_BENCH_DIR:-${TMPDIR:-/tmp}/cog-bench-scaling}
+LOG=$(mktemp)
+trap 'rm -f "$LOG"' EXIT
+
+# A build server would hide the work being measured
+export COG_NO_DAEMON=1
+
+make --no-print-directory -C "$ROOT" bench/synthetic_project > /dev/null
+
+RESULTS=""
+# Adds a result named $1 that took $2 ms
+record() {
+	RESULTS="$RESULTS${RESULTS:+,
+}    {\"name\": \"$1\", \"ms\": $2, \"runs\": 1}"
+}
+
+# Runs cog build with the other arguments and prints how long it took in ms, or its output if it failed.
+# EPOCHREALTIME (microseconds) is read without starting a process, which would be timed too
+build() {
+	local START=${EPOCHREALTIME/[.,]/}
+	if ! "$COG" build "$@" > "$LOG" 2>&1; then
+		cat "$LOG" >&2
+		return 1
+	fi
+	local END=${EPOCHREALTIME/[.,]/}
+	echo $(((10#$END - 10#$START) / 1000))
+}
+
+# Runs cog build --timings and records its time as $1, then the total time of each phase and each other kind of event in timings.json
+timed_build() {
+	local ELAPSED
+	ELAPSED=$(build --timings)
+	record "$1" "$ELAPSED"
+	printf '  %-14s %8d ms\n' "${1##*/}" "$ELAPSED"
+	local TIMINGS
+	TIMINGS=$(ls -t build/*/timings.json | head -n 1)
+	while IFS=$'\t' read -r PART MS; do
+		record "$1/$PART" "$MS"
+		printf '    %-28s %10s ms\n' "$PART" "$MS"
+	done < <(awk '/"dur":/ {
+		match($0, /"name":"[^"]*"/); NAME = substr($0, RSTART + 8, RLENGTH - 9)
+		match($0, /"cat":"[^"]*"/); CATEGORY = substr($0, RSTART + 7, RLENGTH - 8)
+		match($0, /"dur":[0-9.]+/); DURATION = substr($0, RSTART + 6, RLENGTH - 6)
+		# Jobs (compiles, links, scans) can overlap, so they are summed by kind rather than listed one by one
+		KEY = CATEGORY == "phase" ? NAME : CATEGORY
+		if(!(KEY in TOTAL)) ORDER[++COUNT] = KEY
+		TOTAL[KEY] += DURATION
+	} END {
+		for(i = 1; i <= COUNT; i++) printf "%s\t%.3f\n", ORDER[i], TOTAL[ORDER[i]] / 1000
+	}' "$TIMINGS")
+}
+
+for SOURCES in $SIZES; do
+	HEADERS=$((SOURCES * HEADERS_PER_100 / 100))
+	DIR="$BASE/$SOURCES-$HEADERS-$DEPTH-$FANOUT-$FEATURES${PACKAGES:+-${PACKAGES//,/-}}"
+	if [ ! -f "$DIR/project.cfg" ]; then
+		"$ROOT/bench/synthetic_project" "$DIR" --sources "$SOURCES" --headers "$HEADERS" --depth "$DEPTH" --fanout "$FANOUT" \
+			--features "$FEATURES" ${PACKAGES:+--packages "$PACKAGES"}
+	fi
+	cd "$DIR"
+	echo "$SOURCES sources, $HEADERS headers:"
+
+	rm -rf build
+	timed_build "scaling/$SOURCES/cold"
+
+	# Builds with --timings skip the manifest, so one plain build records it before the measured ones
+	build > /dev/null
+	BEST=""
+	for RUN in 1 2 3; do
+		ELAPSED=$(build)
+		if [ -z "$BEST" ] || [ "$ELAPSED" -lt "$BEST" ]; then
+			BEST=$ELAPSED
+		fi
+	done
+	record "scaling/$SOURCES/noop" "$BEST"
+	printf '  %-14s %8d ms\n' "noop" "$BEST"
+
+	timed_build "scaling/$SOURCES/noop_checked"
+
+	# A header in the middle level is included by a share of the sources that depends on the depth and fan-out
+	TOUCHED="src/include/l$((DEPTH / 2))/h0.h"
+	[ -f "$TOUCHED" ] || TOUCHED=src/include/common.h
+	touch "$TOUCHED"
+	timed_build "scaling/$SOURCES/touch_header"
+	cd "$ROOT"
+done
+
+printf '{\n  "benchmarks": [\n%s\n  ]\n}\n' "$RESULTS" > "$OUT"
+echo "Results written to $OUT"
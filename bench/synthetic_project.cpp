@@ -0,0 +1,55 @@
+// Generates a cog project of any size for measuring how builds scale, see bench/scaling.sh.
+// Usage: bench/synthetic_project DIR [--sources N] [--headers N] [--depth N] [--fanout N] [--features N] [--packages a,b,...]
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../configstring/stringlib.h"
+#include "../filesystem.h"
+#include "workloads.h"
+
+namespace fs = FILESYSTEM_NAMESPACE;
+using namespace std;
+
+int main(int argc, char *argv[]) {
+    const char* const USAGE = "Usage: bench/synthetic_project DIR [--sources N] [--headers N] [--depth N] [--fanout N] [--features N] [--packages a,b,...]\n";
+    if(argc < 2 || argv[1][0] == '-') {
+        fputs(USAGE, stderr);
+        return 2;
+    }
+    const string DIR = argv[1];
+    workloads::ProjectShape shape;
+    for(int i = 2; i < argc; i++) {
+        const string ARG = argv[i];
+        if(i + 1 >= argc) {
+            fputs(USAGE, stderr);
+            return 2;
+        }
+        const string VALUE = argv[++i];
+        size_t *pCount = ARG == "--sources" ? &shape.sources : ARG == "--headers" ? &shape.headers : ARG == "--depth" ? &shape.depth
+            : ARG == "--fanout" ? &shape.fanout : ARG == "--features" ? &shape.features : nullptr;
+        if(pCount) {
+            *pCount = strtoull(VALUE.c_str(), nullptr, 10);
+        } else if(ARG == "--packages") {
+            shape.packages = configstring::stringlib::str_split(VALUE, ',');
+        } else {
+            fputs(USAGE, stderr);
+            return 2;
+        }
+    }
+
+    try {
+        if(fs::exists(DIR + "/src") || fs::exists(DIR + "/project.cfg")) {
+            throw runtime_error("\"" + DIR + "\" already holds a project");
+        }
+        const vector<string> SOURCES = workloads::generate_project(DIR, shape);
+        printf("Generated %zu sources and %zu headers (%zu levels, %zu includes each) in %s\n", SOURCES.size(), shape.headers, min(shape.depth, shape.headers), shape.fanout, DIR.c_str());
+        return 0;
+    } catch(const exception &ERR) {
+        fprintf(stderr, "Error: %s\n", ERR.what());
+        return 1;
+    }
+}
@@ -0,0 +1,105 @@
+#include "workloads.h"
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../filesystem.h"
+
+namespace fs = FILESYSTEM_NAMESPACE;
+using namespace std;
+
+namespace workloads {
+    namespace {
+        void write(const string &NAME, const string &TEXT) {
+            ofstream(NAME, ios::binary | ios::trunc) << TEXT;
+        }
+    }
+
+    /// @brief A config with about KEYS keys that looks like a large project.cfg or lock: comments, every value type, and encoded characters
+    std::string generate_config(const size_t KEYS) {
+        string text = "# Generated;\n";
+        for(size_t i = 0; i < KEYS; i++) {
+            switch(i % 6) {
+                case 0: text += "pkg.lib" + to_string(i) + ">=" + to_string(i % 10) + ".0;\n"; break;
+                case 1: text += "feature.F" + to_string(i) + "=" + (i % 4 == 1 ? "true" : "FALSE") + ";\n"; break;
+                case 2: text += "feature.F" + to_string(i - 1) + ".notes=\"Notes with %3B and %3D for " + to_string(i) + "\";\n"; break;
+                case 3: text += "  profile.p" + to_string(i) + ".opt-level = 3 ;\n"; break;
+                case 4: text += "build.key" + to_string(i) + ";\n# Comment " + to_string(i) + ";\n"; break;
+                default: text += "lock.digest" + to_string(i) + "=\"" + to_string(i * 2654435761u) + "abcdef\";\n"; break;
+            }
+        }
+        return text;
+    }
+
+    /// @brief About LENGTH bytes that look like config values, commands, and compiler output: paths and flags with some mixed case, whitespace
+    /// at both ends, and characters minimal_encode replaces
+    std::string generate_text(const size_t LENGTH) {
+        string text = "  \t";
+        for(size_t i = 0; text.length() + 3 < LENGTH; i++) {
+            text += i % 9 == 0 ? "%3B" : i % 7 == 0 ? "=" : i % 5 == 0 ? " " : i % 3 == 0 ? "Ab" : "src/f.cpp";
+        }
+        return text + "\n  ";
+    }
+
+    /// @brief Path (relative to the project) of header INDEX in level LEVEL of a project made by generate_project, like src/include/l0/h0.h
+    std::string header_path(const size_t LEVEL, const size_t INDEX) {
+        return "src/include/l" + to_string(LEVEL) + "/h" + to_string(INDEX) + ".h";
+    }
+
+    /// @brief Writes a project shaped like SHAPE to DIR: project.cfg, src/main.cpp, sources in directories of 100 under src, and headers in one
+    /// directory per level under src/include. Every file includes <vector> and a header every file shares as well. Returns the sources relative to DIR
+    std::vector<std::string> generate_project(const std::string &DIR, const ProjectShape &SHAPE) {
+        // Every cold build should compile everything, so cached objects are not used
+        string config = "project.name=synthetic;\nproject.version=1.0.0;\nbuild.cache=false;\n";
+        for(size_t i = 0; i < SHAPE.features; i++) {
+            config += "feature.F" + to_string(i) + ";\n";
+        }
+        for(const string &PACKAGE : SHAPE.packages) {
+            config += "pkg." + PACKAGE + ";\n";
+        }
+        fs::create_directories(DIR + "/src/include");
+        write(DIR + "/project.cfg", config);
+        write(DIR + "/src/include/common.h", "#pragma once\n#include <vector>\n");
+
+        // Level L holds headers [FIRST[L], FIRST[L + 1]), and every header includes FANOUT headers from the next level
+        const size_t DEPTH = min(SHAPE.depth, SHAPE.headers);
+        vector<size_t> first;
+        for(size_t level = 0; level <= DEPTH; level++) {
+            first.push_back(SHAPE.headers * level / max(DEPTH, (size_t)1));
+        }
+        const auto INCLUDES = [&first, &SHAPE, DEPTH](const size_t LEVEL, const size_t INDEX, const string &PREFIX) {
+            string text = "#include <vector>\n#include \"" + PREFIX + "common.h\"\n";
+            if(LEVEL < DEPTH) {
+                const size_t COUNT = first[LEVEL + 1] - first[LEVEL];
+                for(size_t i = 0; i < min(SHAPE.fanout, COUNT); i++) {
+                    text += "#include \"" + PREFIX + "l" + to_string(LEVEL) + "/h" + to_string((INDEX * SHAPE.fanout + i) % COUNT) + ".h\"\n";
+                }
+            }
+            return text;
+        };
+        for(size_t level = 0; level < DEPTH; level++) {
+            fs::create_directories(DIR + "/src/include/l" + to_string(level));
+            for(size_t i = 0; i < first[level + 1] - first[level]; i++) {
+                const string NAME = "h" + to_string(level) + "_" + to_string(i);
+                write(DIR + "/" + header_path(level, i), "#pragma once\n" + INCLUDES(level + 1, i, "../") + "inline int " + NAME + "() { return " + to_string(i) + "; }\n");
+            }
+        }
+
+        vector<string> sources = {"src/main.cpp"};
+        write(DIR + "/src/main.cpp", INCLUDES(0, 0, "include/") + "int main() { return 0; }\n");
+        for(size_t i = 0; i < SHAPE.sources; i++) {
+            const string DIRECTORY = "src/m" + to_string(i / 100);
+            fs::create_directories(DIR + "/" + DIRECTORY);
+            sources.push_back(DIRECTORY + "/f" + to_string(i) + ".cpp");
+            string text = INCLUDES(0, i, "../include/") + "// A comment mentioning #include \"missing.h\"\nint f" + to_string(i) + "() { return 0; }\n";
+            if(SHAPE.features > 0) {
+                const string FEATURE = "FEATURE_F" + to_string(i % SHAPE.features);
+                text += "#ifdef " + FEATURE + "\nint f" + to_string(i) + "_feature() { return 1; }\n#endif\n";
+            }
+            write(DIR + "/" + sources.back(), text);
+        }
+        return sources;
+    }
+}
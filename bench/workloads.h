@@ -0,0 +1,40 @@
+#ifndef BENCH_WORKLOADS_H
+#define BENCH_WORKLOADS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// @brief Generated inputs shared by the benchmarks, so every benchmark measures the same thing from run to run
+namespace workloads {
+    /// @brief A config with about KEYS keys that looks like a large project.cfg or lock: comments, every value type, and encoded characters
+    std::string generate_config(const size_t KEYS);
+
+    /// @brief About LENGTH bytes that look like config values, commands, and compiler output: paths and flags with some mixed case, whitespace
+    /// at both ends, and characters minimal_encode replaces
+    std::string generate_text(const size_t LENGTH);
+
+    /// @brief The size and structure of a project made by generate_project
+    struct ProjectShape {
+        /// @brief Number of sources besides src/main.cpp
+        size_t sources = 1000;
+        /// @brief Number of headers, spread evenly over depth levels
+        size_t headers = 250;
+        /// @brief Number of levels of headers. Sources include headers in the first level, and headers in each level include headers in the next
+        size_t depth = 4;
+        /// @brief Number of headers each source and header includes from the level below it
+        size_t fanout = 2;
+        /// @brief Number of features declared in project.cfg (all enabled by default), each guarding code in some of the sources
+        size_t features = 0;
+        /// @brief Packages required in project.cfg
+        std::vector<std::string> packages;
+    };
+
+    /// @brief Path (relative to the project) of header INDEX in level LEVEL of a project made by generate_project, like src/include/l0/h0.h
+    std::string header_path(const size_t LEVEL, const size_t INDEX);
+
+    /// @brief Writes a project shaped like SHAPE to DIR: project.cfg, src/main.cpp, sources in directories of 100 under src, and headers in one
+    /// directory per level under src/include. Every file includes <vector> and a header every file shares as well. Returns the sources relative to DIR
+    std::vector<std::string> generate_project(const std::string &DIR, const ProjectShape &SHAPE);
+}
+#endif
@@ -0,0 +1,363 @@
+#include "buildserver.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef WINDOWS
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "filesystem.h"
+#include "commands.h"
+#include "console.hpp"
+#include "hashing.h"
+#include "version.h"
+
+namespace fs = FILESYSTEM_NAMESPACE;
+using namespace std;
+using namespace console;
+
+namespace buildserver {
+    namespace {
+        /// @brief Environment variables that change what a build does, so a server only builds for clients that agree with it on all of them
+        const vector<string> ENVIRONMENT = {"PATH", "PKG_CONFIG_PATH", "COG_BUILD_DIR", "COG_CACHE_DIR"};
+
+        /// @brief Digest of the version of cog and every variable in ENVIRONMENT
+        string get_environment() {
+            hashing::Hasher hasher;
+            hasher.add(VERSION);
+            for(const string &NAME : ENVIRONMENT) {
+                hasher.add(commands::get_env_var(NAME));
+            }
+            return hasher.digest();
+        }
+
+        /// @brief Messages are fields separated by NUL, since paths and compiler errors may contain anything else
+        string join_fields(const vector<string> &FIELDS) {
+            string message;
+            for(const string &FIELD : FIELDS) {
+                message += FIELD;
+                message += '\0';
+            }
+            return message;
+        }
+
+        /// @brief The fields of a message made by join_fields
+        vector<string> split_fields(const string &MESSAGE) {
+            vector<string> fields;
+            size_t start = 0, end;
+            while((end = MESSAGE.find('\0', start)) != string::npos) {
+                fields.push_back(MESSAGE.substr(start, end - start));
+                start = end + 1;
+            }
+            return fields;
+        }
+
+#ifndef WINDOWS
+        /// @brief Connects to the socket at PATH, returning -1 if nothing listens there
+        int connect_to(const string &PATH) {
+            sockaddr_un address {};
+            address.sun_family = AF_UNIX;
+            if(PATH.empty() || PATH.length() >= sizeof(address.sun_path)) {
+                return -1;
+            }
+            PATH.copy(address.sun_path, PATH.length());
+
+            const int FD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if(FD < 0) {
+                return -1;
+            }
+            if(connect(FD, (sockaddr*)&address, sizeof(address)) != 0) {
+                close(FD);
+                return -1;
+            }
+            return FD;
+        }
+
+        /// @brief Writes all of TEXT to FD, returning false if the other end went away
+        bool write_all(const int FD, const string &TEXT) {
+            for(size_t written = 0; written < TEXT.length();) {
+                const ssize_t COUNT = ::send(FD, TEXT.data() + written, TEXT.length() - written, MSG_NOSIGNAL);
+                if(COUNT < 0 && errno != EINTR) {
+                    return false;
+                }
+                written += COUNT > 0 ? COUNT : 0;
+            }
+            return true;
+        }
+
+        /// @brief Reads from FD until the other end stops writing
+        string read_all(const int FD) {
+            string text;
+            char buffer[64 * 1024];
+            ssize_t count;
+            while((count = read(FD, buffer, sizeof(buffer))) != 0) {
+                if(count > 0) {
+                    text.append(buffer, count);
+                } else if(errno != EINTR) {
+                    break;
+                }
+            }
+            return text;
+        }
+
+        /// @brief Sends the first byte of TEXT along with FDS (as SCM_RIGHTS), then the rest
+        bool send_with_fds(const int SOCKET, const string &TEXT, const vector<int> &FDS) {
+            char control[CMSG_SPACE(sizeof(int) * 2)] {};
+            iovec data = {(void*)TEXT.data(), 1};
+            msghdr header {};
+            header.msg_iov = &data;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = CMSG_SPACE(sizeof(int) * FDS.size());
+            cmsghdr *pHeader = CMSG_FIRSTHDR(&header);
+            pHeader->cmsg_level = SOL_SOCKET;
+            pHeader->cmsg_type = SCM_RIGHTS;
+            pHeader->cmsg_len = CMSG_LEN(sizeof(int) * FDS.size());
+            copy(FDS.begin(), FDS.end(), (int*)CMSG_DATA(pHeader));
+
+            ssize_t count;
+            while((count = sendmsg(SOCKET, &header, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+            return count == 1 && write_all(SOCKET, TEXT.substr(1));
+        }
+
+        /// @brief Receives the first byte of a message along with the descriptors sent by send_with_fds, then the rest of the message
+        string receive_with_fds(const int SOCKET, vector<int> &fds) {
+            char first, control[CMSG_SPACE(sizeof(int) * 2)] {};
+            iovec data = {&first, 1};
+            msghdr header {};
+            header.msg_iov = &data;
+            header.msg_iovlen = 1;
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+
+            ssize_t count;
+            while((count = recvmsg(SOCKET, &header, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR);
+            if(count != 1) {
+                return "";
+            }
+            for(cmsghdr *pHeader = CMSG_FIRSTHDR(&header); pHeader != nullptr; pHeader = CMSG_NXTHDR(&header, pHeader)) {
+                if(pHeader->cmsg_level == SOL_SOCKET && pHeader->cmsg_type == SCM_RIGHTS) {
+                    const int *P_FDS = (int*)CMSG_DATA(pHeader);
+                    fds.assign(P_FDS, P_FDS + (pHeader->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+                }
+            }
+            return first + read_all(SOCKET);
+        }
+
+        /// @brief Points stdout and stderr at OUT and ERR for as long as it exists
+        class Redirect final {
+            private:
+                int mOut, mErr;
+
+            public:
+                Redirect(const int OUT, const int ERR) {
+                    cout.flush();
+                    mOut = dup(STDOUT_FILENO);
+                    mErr = dup(STDERR_FILENO);
+                    dup2(OUT, STDOUT_FILENO);
+                    dup2(ERR, STDERR_FILENO);
+                }
+
+                Redirect(const Redirect&) = delete;
+                Redirect& operator=(const Redirect&) = delete;
+
+                ~Redirect() {
+                    cout.flush();
+                    dup2(mOut, STDOUT_FILENO);
+                    dup2(mErr, STDERR_FILENO);
+                    close(mOut);
+                    close(mErr);
+                }
+        };
+#endif
+    }
+
+    /// @brief Path of the socket the build server for the project in the working directory listens on (empty if there is nowhere to put it)
+    std::string get_socket_path() {
+#ifdef WINDOWS
+        return "";
+#else
+        // The runtime directory is private to the user. Otherwise a directory in /tmp is made private to the user, and not used if someone else owns it
+        string dir = commands::get_env_var("XDG_RUNTIME_DIR");
+        if(dir.empty()) {
+            dir = format("/tmp/cog-%u", (unsigned)getuid());
+            ::mkdir(dir.c_str(), 0700);
+            struct stat info;
+            if(lstat(dir.c_str(), &info) != 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 077) != 0) {
+                return "";
+            }
+        }
+        return dir + "/cog-" + hashing::digest(fs::current_path().string()).substr(0, 16) + ".sock";
+#endif
+    }
+
+    /// @brief Sends REQUEST to the build server of the project in the working directory, which writes any output to this process's stdout and stderr.
+    /// Returns false if no server is listening
+    bool send(const Request &REQUEST, Response &response) {
+#ifdef WINDOWS
+        return false;
+#else
+        const int SOCKET = connect_to(get_socket_path());
+        if(SOCKET < 0) {
+            return false;
+        }
+
+        vector<string> fields = {get_environment(), REQUEST.command, REQUEST.debug ? "1" : "0", REQUEST.defaultFeatures ? "1" : "0", REQUEST.test ? "1" : "0", to_string(REQUEST.jobs)};
+        fields.insert(fields.end(), REQUEST.features.begin(), REQUEST.features.end());
+        cout.flush();
+        if(!send_with_fds(SOCKET, join_fields(fields), {STDOUT_FILENO, STDERR_FILENO})) {
+            close(SOCKET);
+            return false;
+        }
+        shutdown(SOCKET, SHUT_WR);
+
+        const vector<string> REPLY = split_fields(read_all(SOCKET));
+        close(SOCKET);
+        if(REPLY.size() != 2) {
+            // The server went away without answering, like if it was killed
+            return false;
+        }
+        response = Response {REPLY[0], REPLY[1]};
+        return true;
+#endif
+    }
+
+    /// @brief Starts a build server for the project in the working directory in the background (as cog daemon serve) and waits until it listens.
+    /// Returns false if it did not start or this platform cannot start one
+    bool spawn() {
+#ifdef __linux__
+        error_code error;
+        const string EXECUTABLE = fs::read_symlink("/proc/self/exe", error).string();
+        if(error || get_socket_path().empty()) {
+            return false;
+        }
+
+        // Forking twice leaves the server without a parent waiting on it, and a new session keeps it running after the terminal closes
+        const pid_t PID = fork();
+        if(PID < 0) {
+            return false;
+        } else if(PID == 0) {
+            setsid();
+            if(fork() == 0) {
+                const int NUL = open("/dev/null", O_RDWR);
+                dup2(NUL, STDIN_FILENO);
+                dup2(NUL, STDOUT_FILENO);
+                dup2(NUL, STDERR_FILENO);
+                execl(EXECUTABLE.c_str(), "cog", "daemon", "serve", (char*)NULL);
+            }
+            _exit(0);
+        }
+        waitpid(PID, nullptr, 0);
+
+        for(int i = 0; i < 300; i++) {
+            const int SOCKET = connect_to(get_socket_path());
+            if(SOCKET >= 0) {
+                close(SOCKET);
+                return true;
+            }
+            this_thread::sleep_for(chrono::milliseconds(10));
+        }
+        return false;
+#else
+        return false;
+#endif
+    }
+
+    /// @brief Listens for requests until stopped or no request arrives for IDLE_SECONDS. HANDLE is called for each build request, one at a time,
+    /// with stdout and stderr sent to the client's
+    void serve(const std::function<Response(const Request&)> HANDLE, const double IDLE_SECONDS) {
+#ifdef WINDOWS
+        throw runtime_error("The build server is not supported on Windows");
+#else
+        const string PATH = get_socket_path();
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        if(PATH.empty() || PATH.length() >= sizeof(address.sun_path)) {
+            throw runtime_error("Cannot find a private directory for the build server's socket");
+        }
+        PATH.copy(address.sun_path, PATH.length());
+
+        // A socket left by a server that died is replaced, but a live server is not
+        const int EXISTING = connect_to(PATH);
+        if(EXISTING >= 0) {
+            close(EXISTING);
+            throw runtime_error("A build server is already running for this project");
+        }
+        unlink(PATH.c_str());
+
+        const int LISTENER = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(LISTENER < 0 || ::bind(LISTENER, (sockaddr*)&address, sizeof(address)) != 0 || listen(LISTENER, 16) != 0) {
+            throw runtime_error(format("Cannot listen on \"%s\"", commands::escape_quotes(PATH).c_str()));
+        }
+
+        // A client that goes away mid build must not take the server with it
+        signal(SIGPIPE, SIG_IGN);
+        const string ENVIRONMENT_DIGEST = get_environment();
+        // poll waits at most INT_MAX milliseconds (under 25 days), which build.daemon.idle may exceed, so the wait is split into several polls
+        const double IDLE_MILLISECONDS = IDLE_SECONDS * 1000;
+        auto lastRequest = chrono::steady_clock::now();
+        bool running = true;
+        while(running) {
+            const double LEFT = IDLE_MILLISECONDS - chrono::duration<double, milli>(chrono::steady_clock::now() - lastRequest).count();
+            if(!(LEFT > 0)) {
+                break;
+            }
+            pollfd request = {LISTENER, POLLIN, 0};
+            if(poll(&request, 1, (int)min(ceil(LEFT), (double)INT_MAX)) <= 0) {
+                continue;
+            }
+            const int CLIENT = accept4(LISTENER, nullptr, nullptr, SOCK_CLOEXEC);
+            if(CLIENT < 0) {
+                continue;
+            }
+
+            vector<int> fds;
+            const vector<string> FIELDS = split_fields(receive_with_fds(CLIENT, fds));
+            Response response = {"refused", ""};
+            if(FIELDS.size() < 6 || fds.size() != 2) {
+                response = {"error", "Malformed request"};
+            } else if(FIELDS[0] != ENVIRONMENT_DIGEST) {
+                // This server can never build for the client, so it makes way for one that can
+                running = false;
+            } else if(FIELDS[1] == "stop") {
+                response = {"ok", ""};
+                running = false;
+            } else if(FIELDS[1] == "status") {
+                response = {"ok", format("Build server %i is listening on %s and stops after %.0f idle minutes", (int)getpid(), PATH.c_str(), IDLE_SECONDS / 60)};
+            } else if(FIELDS[1] == "build") {
+                Redirect redirect(fds[0], fds[1]);
+                try {
+                    response = HANDLE(Request {FIELDS[1], FIELDS[2] == "1", FIELDS[3] == "1", FIELDS[4] == "1", vector<string>(FIELDS.begin() + 6, FIELDS.end()), stoul(FIELDS[5])});
+                } catch(const exception &ERR) {
+                    response = {"error", ERR.what()};
+                }
+            }
+            for(const int FD : fds) {
+                close(FD);
+            }
+            write_all(CLIENT, join_fields({response.status, response.message}));
+            close(CLIENT);
+            lastRequest = chrono::steady_clock::now();
+        }
+
+        close(LISTENER);
+        unlink(PATH.c_str());
+#endif
+    }
+}
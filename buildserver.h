@@ -0,0 +1,40 @@
+#ifndef BUILDSERVER_H
+#define BUILDSERVER_H
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace buildserver {
+    /// @brief What a client asks the build server of its project to do
+    struct Request {
+        /// @brief "build", "status", or "stop"
+        std::string command;
+        bool debug = true, defaultFeatures = true, test = false;
+        std::vector<std::string> features;
+        size_t jobs = 0;
+    };
+
+    struct Response {
+        /// @brief "ok", "error" (message says why), or "refused" (the server runs a different version of cog or in a different environment, so the client must build by itself)
+        std::string status;
+        /// @brief Path of the executable that was built, or what the server reports for a status request
+        std::string message;
+    };
+
+    /// @brief Path of the socket the build server for the project in the working directory listens on (empty if there is nowhere to put it)
+    std::string get_socket_path();
+
+    /// @brief Sends REQUEST to the build server of the project in the working directory, which writes any output to this process's stdout and stderr.
+    /// Returns false if no server is listening
+    bool send(const Request &REQUEST, Response &response);
+
+    /// @brief Starts a build server for the project in the working directory in the background (as cog daemon serve) and waits until it listens.
+    /// Returns false if it did not start or this platform cannot start one
+    bool spawn();
+
+    /// @brief Listens for requests until stopped or no request arrives for IDLE_SECONDS. HANDLE is called for each build request, one at a time,
+    /// with stdout and stderr sent to the client's
+    void serve(const std::function<Response(const Request&)> HANDLE, const double IDLE_SECONDS);
+}
+#endif
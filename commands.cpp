@@ -6,6 +6,26 @@
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <cerrno>
+
+#ifndef WINDOWS
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <thread>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
 
 #include "console.hpp"
 #include "configstring/stringlib.h"
@@ -39,43 +59,396 @@ int setenv(const char *NAME, const char *VALUE, int overwrite)
 #endif
 
 namespace commands {
+#ifndef WINDOWS
+    /// @brief Starts ARGV[0] (searched for in PATH unless it contains a /) with ARGV in directory DIR (this process's if empty), with the NAME=VALUE
+    /// variables in ENV added to (or replacing those in) this process's environment. Throws if it cannot be started
+    Process::Process(const std::vector<std::string> ARGV, const Stream OUT, const Stream ERR, const std::string DIR, const std::vector<std::string> ENV) {
+        if(ARGV.empty()) {
+            throw runtime_error("Failed to run an empty command");
+        }
+        vector<char*> argv;
+        for(const string &ARG : ARGV) {
+            argv.push_back(const_cast<char*>(ARG.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        // Set per child rather than with setenv, since other threads may be starting children with different values
+        vector<char*> envp;
+        for(char **pEntry = environ; *pEntry; pEntry++) {
+            const char* const P_EQUALS = strchr(*pEntry, '=');
+            const size_t NAME_LENGTH = P_EQUALS ? P_EQUALS - *pEntry + 1 : strlen(*pEntry);
+            const bool REPLACED = any_of(ENV.begin(), ENV.end(), [pEntry, NAME_LENGTH](const string &VARIABLE) { return VARIABLE.compare(0, NAME_LENGTH, *pEntry, NAME_LENGTH) == 0; });
+            if(!REPLACED) {
+                envp.push_back(*pEntry);
+            }
+        }
+        for(const string &VARIABLE : ENV) {
+            envp.push_back(const_cast<char*>(VARIABLE.c_str()));
+        }
+        envp.push_back(nullptr);
+
+        // Pipes are close-on-exec so children started by other threads at the same time do not hold them open (which would hide end of file)
+        int outPipe[2] = {-1, -1}, errPipe[2] = {-1, -1};
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        bool ready = true;
+        if(OUT == Stream::CAPTURE) {
+            ready = ready && pipe2(outPipe, O_CLOEXEC) == 0 && posix_spawn_file_actions_adddup2(&actions, outPipe[1], STDOUT_FILENO) == 0;
+        } else if(OUT == Stream::DISCARD) {
+            ready = ready && posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0) == 0;
+        }
+        if(ERR == Stream::CAPTURE) {
+            ready = ready && pipe2(errPipe, O_CLOEXEC) == 0 && posix_spawn_file_actions_adddup2(&actions, errPipe[1], STDERR_FILENO) == 0;
+        } else if(ERR == Stream::DISCARD) {
+            ready = ready && posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0) == 0;
+        } else if(ERR == Stream::MERGE) {
+            ready = ready && posix_spawn_file_actions_adddup2(&actions, STDOUT_FILENO, STDERR_FILENO) == 0;
+        }
+
+        if(!DIR.empty()) {
+            ready = ready && posix_spawn_file_actions_addchdir_np(&actions, DIR.c_str()) == 0;
+        }
+
+        // Children get the default SIGPIPE even when this process ignores it (like the build server), so tools see broken pipes as they would from a shell
+        posix_spawnattr_t attributes;
+        posix_spawnattr_init(&attributes);
+        sigset_t defaults;
+        sigemptyset(&defaults);
+        sigaddset(&defaults, SIGPIPE);
+        ready = ready && posix_spawnattr_setsigdefault(&attributes, &defaults) == 0 && posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF) == 0;
+
+        const int ERROR = ready ? posix_spawnp(&mPid, argv[0], &actions, &attributes, argv.data(), envp.data()) : errno;
+        posix_spawn_file_actions_destroy(&actions);
+        posix_spawnattr_destroy(&attributes);
+        for(const int FD : {outPipe[1], errPipe[1]}) {
+            if(FD >= 0) {
+                close(FD);
+            }
+        }
+        mOut = outPipe[0];
+        mErr = errPipe[0];
+        if(!ready || ERROR != 0) {
+            for(const int FD : {mOut, mErr}) {
+                if(FD >= 0) {
+                    close(FD);
+                }
+            }
+            throw runtime_error(format("Failed to run command \"%s\" (%s)", escape_quotes(ARGV[0]).c_str(), strerror(ERROR)));
+        }
+    }
+
+    Process::~Process() {
+        if(mRunning) {
+            ::kill(mPid, SIGKILL);
+            reap(0);
+        }
+        for(const int FD : {mOut, mErr}) {
+            if(FD >= 0) {
+                close(FD);
+            }
+        }
+    }
+
+    pid_t Process::get_pid() const {
+        return mPid;
+    }
+
+    /// @brief Collects the exit status if the process exited (waiting for it unless OPTIONS is WNOHANG). Returns true if it has exited
+    bool Process::reap(const int OPTIONS) {
+        if(!mRunning) {
+            return true;
+        }
+        int status = 0;
+        struct rusage usage {};
+        pid_t result;
+        while((result = wait4(mPid, &status, OPTIONS, &usage)) < 0 && errno == EINTR);
+        if(result != mPid) {
+            // Already reaped elsewhere, or not finished
+            mRunning = result == 0;
+            return !mRunning;
+        }
+        mRunning = false;
+        mSignal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+        mExitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + mSignal;
+#ifdef __APPLE__
+        mPeakMemory = usage.ru_maxrss / 1024;
+#else
+        mPeakMemory = usage.ru_maxrss;
+#endif
+        return true;
+    }
+
+    /// @brief Reads what is ready on FD into TEXT, closing FD at end of file
+    void Process::drain(int &fd, std::string &text) {
+        char buffer[64 * 1024];
+        const ssize_t COUNT = read(fd, buffer, sizeof(buffer));
+        if(COUNT > 0) {
+            text.append(buffer, COUNT);
+        } else if(COUNT == 0 || errno != EINTR) {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    /// @brief Reads any output that is ready and checks if the process exited, without blocking
+    bool Process::is_running() {
+        for(int *pFd : {&mOut, &mErr}) {
+            pollfd ready = {*pFd, POLLIN, 0};
+            if(*pFd >= 0 && poll(&ready, 1, 0) > 0) {
+                drain(*pFd, pFd == &mOut ? mOutput : mErrors);
+            }
+        }
+        return !reap(WNOHANG);
+    }
+
+    /// @brief Waits for the process to exit while reading its output and returns its exit code. It is killed if still running after TIMEOUT_SECONDS (if not negative)
+    int Process::wait(const double TIMEOUT_SECONDS) {
+        wait_all({this}, TIMEOUT_SECONDS);
+        return mExitCode;
+    }
+
+    /// @brief Sends SIGNAL to the process if it is still running
+    void Process::kill(const int SIGNAL) {
+        if(mRunning) {
+            ::kill(mPid, SIGNAL);
+        }
+    }
+
+    /// @brief Asks the process to stop with SIGTERM, kills it if it is still running after GRACE_SECONDS, and returns its exit code
+    int Process::stop(const double GRACE_SECONDS) {
+        kill(SIGTERM);
+        wait(GRACE_SECONDS);
+        mTimedOut = false;
+        return mExitCode;
+    }
+
+    /// @brief Everything captured from stdout so far
+    const std::string& Process::get_output() const {
+        return mOutput;
+    }
+
+    /// @brief Everything captured from stderr so far
+    const std::string& Process::get_errors() const {
+        return mErrors;
+    }
+
+    /// @brief The exit code, or 128 plus the signal number if a signal ended the process (like a shell reports it)
+    int Process::get_exit_code() const {
+        return mExitCode;
+    }
+
+    /// @brief The signal that ended the process, or 0 if it exited by itself
+    int Process::get_signal() const {
+        return mSignal;
+    }
+
+    /// @brief True if wait or wait_all killed the process for running too long
+    bool Process::timed_out() const {
+        return mTimedOut;
+    }
+
+    /// @brief Peak resident memory in KB of the process or anything it waited on
+    size_t Process::get_peak_memory() const {
+        return mPeakMemory;
+    }
+
+    /// @brief Waits for every process in PROCESSES to exit, reading all of their output with one poll as it arrives.
+    /// Processes still running after TIMEOUT_SECONDS (if not negative) are killed
+    void wait_all(const std::vector<Process*> &PROCESSES, const double TIMEOUT_SECONDS) {
+        const auto DEADLINE = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(max(TIMEOUT_SECONDS, 0.0)));
+        while(true) {
+            vector<pollfd> fds;
+            vector<pair<int*, string*>> targets;
+            bool running = false;
+            for(Process *pProcess : PROCESSES) {
+                for(int *pFd : {&pProcess->mOut, &pProcess->mErr}) {
+                    if(*pFd >= 0) {
+                        fds.push_back({*pFd, POLLIN, 0});
+                        targets.push_back({pFd, pFd == &pProcess->mOut ? &pProcess->mOutput : &pProcess->mErrors});
+                    }
+                }
+                running = running || pProcess->mRunning;
+            }
+            if(!running && fds.empty()) {
+                return;
+            }
+
+            int timeout = -1;
+            if(TIMEOUT_SECONDS >= 0) {
+                const auto LEFT = chrono::duration_cast<chrono::milliseconds>(DEADLINE - chrono::steady_clock::now()).count();
+                if(LEFT <= 0) {
+                    for(Process *pProcess : PROCESSES) {
+                        if(pProcess->mRunning) {
+                            pProcess->kill(SIGKILL);
+                            pProcess->mTimedOut = true;
+                            pProcess->reap(0);
+                        }
+                    }
+                    // Anything the killed processes wrote is still read, but a grandchild holding a pipe open is not waited for
+                    for(size_t i = 0; i < fds.size(); i++) {
+                        while(*targets[i].first >= 0 && poll(&fds[i], 1, 0) > 0) {
+                            Process::drain(*targets[i].first, *targets[i].second);
+                        }
+                    }
+                    return;
+                }
+                timeout = (int)LEFT;
+            }
+
+            if(fds.empty()) {
+                // Only exits are left to wait for. Without a deadline the first running process can simply be waited on
+                for(Process *pProcess : PROCESSES) {
+                    if(pProcess->mRunning && !pProcess->reap(WNOHANG) && timeout < 0) {
+                        pProcess->reap(0);
+                    }
+                }
+                if(timeout >= 0) {
+                    this_thread::sleep_for(chrono::milliseconds(min(timeout, 10)));
+                }
+                continue;
+            }
+
+            // Processes close their pipes when they exit, so this wakes up for exits too (and the rest are waited for once no pipe is left)
+            if(poll(fds.data(), fds.size(), timeout) > 0) {
+                for(size_t i = 0; i < fds.size(); i++) {
+                    if(fds[i].revents != 0) {
+                        Process::drain(*targets[i].first, *targets[i].second);
+                    }
+                }
+            }
+            for(Process *pProcess : PROCESSES) {
+                pProcess->reap(WNOHANG);
+            }
+        }
+    }
+
+    /// @brief Replaces this process with ARGV[0] (searched for in PATH unless it contains a /) like a shell's exec, so signals and the exit code go straight to it.
+    /// Only returns, by throwing, if it cannot be started
+    void exec(const std::vector<std::string> ARGV) {
+        vector<char*> argv;
+        for(const string &ARG : ARGV) {
+            argv.push_back(const_cast<char*>(ARG.c_str()));
+        }
+        argv.push_back(nullptr);
+        cout.flush();
+        cerr.flush();
+        if(!ARGV.empty()) {
+            execvp(argv[0], argv.data());
+        }
+        throw runtime_error(format("Failed to run command \"%s\" (%s)", escape_quotes(ARGV.empty() ? "" : ARGV[0]).c_str(), strerror(errno)));
+    }
+#endif
+
+    namespace {
+#ifdef WINDOWS
+        /// @brief Quotes ARGS for the shell and appends them to COMMAND
+        string get_command_line(const std::string COMMAND, const std::vector<std::string> ARGS) {
+            string line = COMMAND;
+            for(const auto &ARG : ARGS) {
+                line += format(" \"%s\"", escape_quotes(ARG).c_str());
+            }
+            return line;
+        }
+
+        /// @brief Runs the shell command LINE and reads its stdout
+        CommandResult read_command(const std::string COMMAND, const std::string LINE) {
+            char buffer[128];
+            string result = "";
+            FILE* pipe = popen(LINE.c_str(), "r");
+            if (!pipe) {
+                throw runtime_error(format("Failed to run command \"%s\"", escape_quotes(COMMAND).c_str()));
+            }
+            try {
+                while (fgets(buffer, sizeof buffer, pipe) != NULL) {
+                    result += buffer;
+                }
+            } catch (...) {
+                pclose(pipe);
+                throw runtime_error(format("Failed to run command \"%s\"", escape_quotes(COMMAND).c_str()));
+            }
+            return CommandResult {result, pclose(pipe)};
+        }
+#else
+        /// @brief Runs COMMAND (which may hold arguments of its own, split like a shell would) with ARGS and waits for it.
+        /// A command that cannot be started exits with 127, as it would in a shell
+        CommandResult run_process(const std::string COMMAND, const std::vector<std::string> ARGS, const Stream OUT, const Stream ERR) {
+            vector<string> argv = split_args(COMMAND);
+            argv.insert(argv.end(), ARGS.begin(), ARGS.end());
+            unique_ptr<Process> process;
+            try {
+                process.reset(new Process(argv, OUT, ERR));
+            } catch(const runtime_error &ERR) {
+                eprintlnf("%s", ERR.what());
+                return CommandResult {"", 127};
+            }
+            process->wait();
+            return CommandResult {process->get_output(), process->get_exit_code(), process->get_peak_memory()};
+        }
+#endif
+    }
+
     /// @brief Run COMMAND with ARGS and return exit code (stdout is written to console)
     int run(const std::string COMMAND, const std::vector<std::string> ARGS) {
-        string tail = "";
-        for(const auto &ARG : ARGS) {
-            tail += format(" \"%s\"", escape_quotes(ARG).c_str());
-        }
-        return system(format("%s%s", COMMAND.c_str(), tail.c_str()).c_str());
-    }
-    /// @brief Run COMMAND with ARGS and return exit code and command stdout (stdout is not written to console)
-    CommandResult run_and_read(const std::string COMMAND, const std::vector<std::string> ARGS) {
-        string tail = "";
-        for(const auto &ARG : ARGS) {
-            tail += format(" \"%s\"", escape_quotes(ARG).c_str());
-        }
-        
-        char buffer[128];
-        string result = "";
-        FILE* pipe = popen(format("%s%s", COMMAND.c_str(), tail.c_str()).c_str(), "r");
-        if (!pipe) {
-            throw runtime_error(format("Failed to run command \"%s\"", escape_quotes(COMMAND).c_str()));
-        }
-        try {
-            while (fgets(buffer, sizeof buffer, pipe) != NULL) {
-                result += buffer;
-            }
-        } catch (...) {
-            pclose(pipe);
-            throw runtime_error(format("Failed to run command \"%s\"", escape_quotes(COMMAND).c_str()));
-        }
-        return CommandResult {result, pclose(pipe)};
-    }
-    /// @brief Check that command COMMAND can be run by checking that COMMAND --version exists with code 0
-    void assert_command_exists(const std::string COMMAND, const std::string WHICH_KEY, const std::string ARG) {
-        if(commands::run_and_read(COMMAND, vector<string> {ARG}).status != 0) {
+#ifdef WINDOWS
+        return system(get_command_line(COMMAND, ARGS).c_str());
+#else
+        return run_process(COMMAND, ARGS, Stream::INHERIT, Stream::INHERIT).status;
+#endif
+    }
+
+    /// @brief Run COMMAND with ARGS and return exit code and command stdout (stdout is not written to console, stderr is discarded if QUIET)
+    CommandResult run_and_read(const std::string COMMAND, const std::vector<std::string> ARGS, const bool QUIET) {
+#ifdef WINDOWS
+        return read_command(COMMAND, get_command_line(COMMAND, ARGS) + (QUIET ? " 2>NUL" : ""));
+#else
+        return run_process(COMMAND, ARGS, Stream::CAPTURE, QUIET ? Stream::DISCARD : Stream::INHERIT);
+#endif
+    }
+
+    /// @brief Run COMMAND with ARGS and return exit code and command stdout and stderr combined (nothing is written to console)
+    CommandResult run_and_capture(const std::string COMMAND, const std::vector<std::string> ARGS) {
+#ifdef WINDOWS
+        return read_command(COMMAND, get_command_line(COMMAND, ARGS) + " 2>&1");
+#else
+        return run_process(COMMAND, ARGS, Stream::CAPTURE, Stream::MERGE);
+#endif
+    }
+
+    /// @brief Check that command COMMAND can be run by checking that COMMAND --version exists with code 0 and return what it printed
+    std::string assert_command_exists(const std::string COMMAND, const std::string WHICH_KEY, const std::string ARG) {
+        const CommandResult RESULT = commands::run_and_read(COMMAND, vector<string> {ARG});
+        if(RESULT.status != 0) {
             throw runtime_error(format("Command \"%s\" does not exist. Either set which.%s in project.cfg or install %s", COMMAND.c_str(), WHICH_KEY.c_str(), COMMAND.c_str()));
         }
+        return RESULT.output;
     }
+
+    /// @brief Gets the real path (symlinks resolved) of program NAME, searched for in PATH unless it contains a /, or an empty string if it cannot be found (always on Windows)
+    std::string find_program(const std::string NAME) {
+#ifdef WINDOWS
+        return "";
+#else
+        vector<string> candidates;
+        if(NAME.find('/') != string::npos) {
+            candidates.push_back(NAME);
+        } else if(!NAME.empty()) {
+            for(const string &DIR : configstring::stringlib::str_split(get_env_var("PATH"), (const char)':')) {
+                candidates.push_back((DIR.empty() ? "." : DIR) + "/" + NAME);
+            }
+        }
+        for(const string &CANDIDATE : candidates) {
+            struct stat info;
+            if(::stat(CANDIDATE.c_str(), &info) == 0 && S_ISREG(info.st_mode) && access(CANDIDATE.c_str(), X_OK) == 0) {
+                const unique_ptr<char, decltype(&free)> RESOLVED(realpath(CANDIDATE.c_str(), nullptr), &free);
+                if(RESOLVED) {
+                    return RESOLVED.get();
+                }
+            }
+        }
+        return "";
+#endif
+    }
+
     /// @brief Escapes " -> \\" (One literal backslash and one quote)
     std::string escape_quotes(const std::string ARG) {
         return configstring::stringlib::str_replace(ARG,"\"","\\\"");
@@ -86,6 +459,54 @@ namespace commands {
         return configstring::stringlib::str_replace(ARG," ","\\ ");
     }
 
+    /// @brief Quotes ARG for a POSIX shell if it contains anything other than letters, digits, or -_./=+,:@%
+    std::string shell_quote(const std::string ARG) {
+        if(!ARG.empty() && ARG.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_./=+,:@%") == string::npos) {
+            return ARG;
+        }
+        return "'" + configstring::stringlib::str_replace(ARG, "'", "'\\''") + "'";
+    }
+
+    /// @brief Splits TEXT into arguments the way a POSIX shell would (whitespace separated with '...', "...", and \\ quoting) without any expansion
+    std::vector<std::string> split_args(const std::string TEXT) {
+        vector<string> result;
+        string arg;
+        bool inArg = false;
+        for(size_t i = 0; i < TEXT.length(); i++) {
+            const char C = TEXT[i];
+            if(C == ' ' || C == '\t' || C == '\n' || C == '\r') {
+                if(inArg) {
+                    result.push_back(arg);
+                    arg.clear();
+                    inArg = false;
+                }
+            } else if(C == '\\' && i + 1 < TEXT.length()) {
+                arg += TEXT[++i];
+                inArg = true;
+            } else if(C == '\'') {
+                const size_t END = TEXT.find('\'', i + 1);
+                arg += TEXT.substr(i + 1, (END == string::npos ? TEXT.length() : END) - i - 1);
+                i = END == string::npos ? TEXT.length() : END;
+                inArg = true;
+            } else if(C == '"') {
+                for(i++; i < TEXT.length() && TEXT[i] != '"'; i++) {
+                    if(TEXT[i] == '\\' && i + 1 < TEXT.length() && string("\"\\$`").find(TEXT[i + 1]) != string::npos) {
+                        i++;
+                    }
+                    arg += TEXT[i];
+                }
+                inArg = true;
+            } else {
+                arg += C;
+                inArg = true;
+            }
+        }
+        if(inArg) {
+            result.push_back(arg);
+        }
+        return result;
+    }
+
     /// @brief Gets the value of enviornment variable NAME 
     std::string get_env_var(const std::string NAME) {
         const char* VALUE = getenv(NAME.c_str());
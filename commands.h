@@ -1,25 +1,126 @@
 #ifndef COMMANDS_H
 #define COMMANDS_H
+#include <cstddef>
 #include <string>
 #include <vector>
 
+#ifndef WINDOWS
+#include <csignal>
+#include <sys/types.h>
+#endif
+
 #include "configstring/stringlib.h"
 
 namespace commands {
     struct CommandResult {
         std::string output;
         int status;
+        /// @brief Peak resident memory in KB of the command or anything it ran (0 where this is not measured)
+        size_t peakMemory = 0;
     };
+#ifndef WINDOWS
+    /// @brief Where a child's stdout or stderr goes
+    enum Stream {
+        /// @brief Shared with this process
+        INHERIT,
+        /// @brief Read through a pipe, see Process::get_output and Process::get_errors
+        CAPTURE,
+        /// @brief Sent to /dev/null
+        DISCARD,
+        /// @brief (stderr only) Sent wherever stdout goes, so captured output keeps both in order
+        MERGE
+    };
+
+    /// @brief A child process started with posix_spawn from an argument vector, so no shell runs and nothing needs quoting.
+    /// Captured output is read in large chunks as it arrives, and many processes can be waited on at once with wait_all
+    class Process final {
+        private:
+            pid_t mPid = -1;
+            /// @brief Read ends of the stdout and stderr pipes, or -1 once closed (or if not captured)
+            int mOut = -1, mErr = -1;
+            std::string mOutput, mErrors;
+            bool mRunning = true, mTimedOut = false;
+            int mExitCode = -1, mSignal = 0;
+            size_t mPeakMemory = 0;
+
+            /// @brief Collects the exit status if the process exited (waiting for it unless OPTIONS is WNOHANG). Returns true if it has exited
+            bool reap(const int OPTIONS);
+
+            /// @brief Reads what is ready on FD into TEXT, closing FD at end of file
+            static void drain(int &fd, std::string &text);
+
+            friend void wait_all(const std::vector<Process*> &PROCESSES, const double TIMEOUT_SECONDS);
+
+        public:
+            /// @brief Starts ARGV[0] (searched for in PATH unless it contains a /) with ARGV in directory DIR (this process's if empty), with the NAME=VALUE
+            /// variables in ENV added to (or replacing those in) this process's environment. Throws if it cannot be started
+            Process(const std::vector<std::string> ARGV, const Stream OUT = Stream::INHERIT, const Stream ERR = Stream::INHERIT, const std::string DIR = "", const std::vector<std::string> ENV = {});
+
+            pid_t get_pid() const;
+
+            /// @brief Reads any output that is ready and checks if the process exited, without blocking
+            bool is_running();
+
+            /// @brief Waits for the process to exit while reading its output and returns its exit code. It is killed if still running after TIMEOUT_SECONDS (if not negative)
+            int wait(const double TIMEOUT_SECONDS = -1);
+
+            /// @brief Sends SIGNAL to the process if it is still running
+            void kill(const int SIGNAL = SIGTERM);
+
+            /// @brief Asks the process to stop with SIGTERM, kills it if it is still running after GRACE_SECONDS, and returns its exit code
+            int stop(const double GRACE_SECONDS = 2);
+
+            /// @brief Everything captured from stdout so far
+            const std::string& get_output() const;
+
+            /// @brief Everything captured from stderr so far
+            const std::string& get_errors() const;
+
+            /// @brief The exit code, or 128 plus the signal number if a signal ended the process (like a shell reports it)
+            int get_exit_code() const;
+
+            /// @brief The signal that ended the process, or 0 if it exited by itself
+            int get_signal() const;
+
+            /// @brief True if wait or wait_all killed the process for running too long
+            bool timed_out() const;
+
+            /// @brief Peak resident memory in KB of the process or anything it waited on
+            size_t get_peak_memory() const;
+
+            Process(const Process&) = delete;
+            Process& operator=(const Process&) = delete;
+            /// @brief A process still running is killed, so none is left behind as a zombie
+            ~Process();
+    };
+
+    /// @brief Waits for every process in PROCESSES to exit, reading all of their output with one poll as it arrives.
+    /// Processes still running after TIMEOUT_SECONDS (if not negative) are killed
+    void wait_all(const std::vector<Process*> &PROCESSES, const double TIMEOUT_SECONDS = -1);
+
+    /// @brief Replaces this process with ARGV[0] (searched for in PATH unless it contains a /) like a shell's exec, so signals and the exit code go straight to it.
+    /// Only returns, by throwing, if it cannot be started
+    [[noreturn]] void exec(const std::vector<std::string> ARGV);
+#endif
+
     /// @brief Run COMMAND with ARGS and return exit code (stdout is written to console)
     int run(const std::string COMMAND,  const std::vector<std::string> ARGS = std::vector<std::string>());
-    /// @brief Run COMMAND with ARGS and return exit code and command stdout (stdout is not written to console)
-    CommandResult run_and_read(const std::string COMMAND, const std::vector<std::string> ARGS = std::vector<std::string>());
-    /// @brief Check that command COMMAND can be run by checking that COMMAND --version exists with code 0
-    void assert_command_exists(const std::string COMMAND, const std::string WHICH_KEY, const std::string ARG = "--version");
+    /// @brief Run COMMAND with ARGS and return exit code and command stdout (stdout is not written to console, stderr is discarded if QUIET)
+    CommandResult run_and_read(const std::string COMMAND, const std::vector<std::string> ARGS = std::vector<std::string>(), const bool QUIET = false);
+    /// @brief Run COMMAND with ARGS and return exit code and command stdout and stderr combined (nothing is written to console)
+    CommandResult run_and_capture(const std::string COMMAND, const std::vector<std::string> ARGS = std::vector<std::string>());
+    /// @brief Check that command COMMAND can be run by checking that COMMAND --version exists with code 0 and return what it printed
+    std::string assert_command_exists(const std::string COMMAND, const std::string WHICH_KEY, const std::string ARG = "--version");
+    /// @brief Gets the real path (symlinks resolved) of program NAME, searched for in PATH unless it contains a /, or an empty string if it cannot be found (always on Windows)
+    std::string find_program(const std::string NAME);
     /// @brief Escapes " -> \\" (One literal backslash and one quote)
     std::string escape_quotes(const std::string ARG);
     /// @brief Escapes <space> -> \\<space> (One literal backslash and one space)
     std::string escape_spaces(const std::string ARG);
+    /// @brief Quotes ARG for a POSIX shell if it contains anything other than letters, digits, or -_./=+,:@%
+    std::string shell_quote(const std::string ARG);
+    /// @brief Splits TEXT into arguments the way a POSIX shell would (whitespace separated with '...', "...", and \\ quoting) without any expansion
+    std::vector<std::string> split_args(const std::string TEXT);
     /// @brief Gets the value of enviornment variable NAME 
     std::string get_env_var(const std::string NAME);
     /// @brief Sets the value of local enviornment variable NAME to VALUE
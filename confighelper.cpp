@@ -1,35 +1,136 @@
 #include "confighelper.h"
 
+#include <algorithm>
+#include <fstream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#ifdef WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
 
 #include "filesystem.h"
 #include "configstring/configstring.h"
 #include "files.h"
 #include "console.hpp"
 #include "commands.h"
+#include "timings.h"
+#include "hashing.h"
+#include "objectcache.h"
+#include "version.h"
 
 using namespace std;
 
 namespace fs = FILESYSTEM_NAMESPACE;
 
+namespace {
+	/// @brief Directory in the object cache holding snapshots of parsed configs, named by the digest of their text and the version of cog
+	const string CONFIG_SNAPSHOT_DIR = "configs";
+
+	/// @brief Most snapshots kept in CONFIG_SNAPSHOT_DIR; the oldest are removed past this, since every edit of every project's config adds one
+	const size_t CONFIG_SNAPSHOT_LIMIT = 64;
+
+	/// @brief Removes the oldest files in DIR until at most CONFIG_SNAPSHOT_LIMIT are left. Failures are ignored, another process may be doing the same
+	void prune_snapshots(const string &DIR) {
+		error_code error;
+		vector<pair<fs::file_time_type, fs::path>> snapshots;
+		for(auto it = fs::directory_iterator(DIR, error); !error && it != fs::directory_iterator(); it.increment(error)) {
+			error_code timeError;
+			const auto TIME = fs::last_write_time(it->path(), timeError);
+			if(!timeError) {
+				snapshots.emplace_back(TIME, it->path());
+			}
+		}
+		if(snapshots.size() <= CONFIG_SNAPSHOT_LIMIT) {
+			return;
+		}
+		sort(snapshots.begin(), snapshots.end());
+		for(size_t i = 0; i + CONFIG_SNAPSHOT_LIMIT < snapshots.size(); i++) {
+			fs::remove(snapshots[i].second, error);
+		}
+	}
+
+	/// @brief Writes SNAPSHOT to PATH through a renamed temporary file so other processes never read part of one, then prunes old snapshots.
+	/// Failures are ignored, the config is just parsed again
+	void write_snapshot(const string &PATH, const string &SNAPSHOT) {
+		error_code error;
+		const string DIR = fs::path(PATH).parent_path().string();
+		fs::create_directories(DIR, error);
+		const string TEMPORARY = PATH + console::format(".%i", (int)getpid());
+		ofstream stream(TEMPORARY, ios::binary);
+		stream << SNAPSHOT;
+		stream.close();
+		if(stream.fail()) {
+			fs::remove(TEMPORARY, error);
+		} else {
+			fs::rename(TEMPORARY, PATH, error);
+		}
+		prune_snapshots(DIR);
+	}
+}
+
 /// @brief If project.config exists, returns that otherwise returns project.cfg
 std::string get_config_filename() {
 	return files::fexists("project.config") ? "project.config" : "project.cfg";
 }
 
-/// @brief Load project config from project.config or and project.cfg in that order
+/// @brief Load project config from project.config or and project.cfg in that order. Parsed configs are kept as snapshots in the object cache
+/// by the digest of their text, so the text is only parsed again after it changes (or after cog, and maybe how it parses, changes)
 configstring::ConfigObject get_config() {
-	return configstring::parse(files::fread(get_config_filename()));
+	timings::Scope scope("Parse config", "phase");
+	const files::MappedFile TEXT = files::load(get_config_filename());
+	const string DIGEST = hashing::Hasher().add(VERSION).add(TEXT.view()).digest();
+
+	// The last config is also kept in memory, since a command may read it more than once (e.g. to check build.daemon and then to build)
+	static mutex lastMutex;
+	static string lastDigest;
+	static configstring::ConfigObject last;
+	{
+		const lock_guard<mutex> LOCK(lastMutex);
+		if(lastDigest == DIGEST) {
+			return last;
+		}
+	}
+
+	const string PATH = objectcache::get_cache_dir() + "/" + CONFIG_SNAPSHOT_DIR + "/" + DIGEST;
+	configstring::ConfigObject config;
+	files::MappedFile snapshot;
+	bool loaded = false;
+	if(files::try_map(PATH, snapshot)) {
+		try {
+			config = configstring::ConfigObject::from_snapshot(snapshot.view());
+			loaded = true;
+		} catch(const runtime_error &ERR) {
+			// A damaged or outdated snapshot is replaced below
+		}
+	}
+	if(!loaded) {
+		config = configstring::parse(TEXT.view());
+		// Projects that turn the cache off leave nothing in it (an invalid build.cache is reported by whatever reads it)
+		if(!config.is<bool>("build.cache") || config.get<bool>("build.cache")) {
+			write_snapshot(PATH, config.snapshot());
+		}
+	}
+
+	const lock_guard<mutex> LOCK(lastMutex);
+	lastDigest = DIGEST;
+	last = config;
+	return config;
 }
 
 /// @brief If KEY exists, get KEY from CONFIG as a string or throw an error
 void get_string_from_config(const configstring::ConfigObject &CONFIG, const std::string KEY, std::string &outValue) {
-	if(const auto VALUE = CONFIG.get(KEY)->as<configstring::String>()) {
-		outValue = VALUE->getValue();
-	}  else {
+	if(CONFIG.has(KEY) && !CONFIG.is<string>(KEY)) {
 		throw runtime_error(console::format("\"%s\" in project config is not a string", commands::escape_quotes(KEY).c_str()));
 	}
+	outValue = CONFIG.get<string>(KEY);
 }
 
 /// @brief Get KEY from CONFIG as a string or throw an error
@@ -41,11 +142,10 @@ void get_optional_string_from_config(const configstring::ConfigObject &CONFIG, c
 
 /// @brief Get KEY from CONFIG as a bool or throw an error
 void get_bool_from_config(const configstring::ConfigObject &CONFIG, const std::string KEY, bool &outValue) {
-	if(const auto VALUE = CONFIG.get(KEY)->as<configstring::Boolean>()) {
-		outValue = VALUE->getValue();
-	}  else {
+	if(CONFIG.has(KEY) && !CONFIG.is<bool>(KEY)) {
 		throw runtime_error(console::format("\"%s\" in project config is not a boolean", commands::escape_quotes(KEY).c_str()));
 	}
+	outValue = CONFIG.get<bool>(KEY);
 }
 
 /// @brief If KEY exists, get KEY from CONFIG as a bool or throw an error
@@ -57,11 +157,10 @@ void get_optional_bool_from_config(const configstring::ConfigObject &CONFIG, con
 
 /// @brief Get KEY from CONFIG as a double or throw an error
 void get_double_from_config(const configstring::ConfigObject &CONFIG, const std::string KEY, double &outValue) {
-	if(const auto VALUE = CONFIG.get(KEY)->as<configstring::Number>()) {
-		outValue = VALUE->getValue();
-	}  else {
+	if(CONFIG.has(KEY) && !CONFIG.is<double>(KEY)) {
 		throw runtime_error(console::format("\"%s\" in project config is not a number", commands::escape_quotes(KEY).c_str()));
 	}
+	outValue = CONFIG.get<double>(KEY);
 }
 
 /// @brief If KEY exists, get KEY from CONFIG as a double or throw an error
@@ -75,10 +174,10 @@ void get_optional_double_from_config(const configstring::ConfigObject &CONFIG, c
 /// (Note that 1 or 1.0 would be interpreted as a number while 1.0.0 is a string, this grabs either)
 void get_optional_version_from_config(const configstring::ConfigObject &CONFIG, const std::string KEY, std::string &outValue) {
 	if(CONFIG.has(KEY)) {
-		if(const auto VALUE = CONFIG.get(KEY)->as<configstring::String>()) {
-			outValue = VALUE->getValue();
-		} else if(const auto value = CONFIG.get(KEY)->as<configstring::Number>()) {
-			outValue = console::format("%.1f",value->getValue());
+		if(CONFIG.is<string>(KEY)) {
+			outValue = CONFIG.get<string>(KEY);
+		} else if(CONFIG.is<double>(KEY)) {
+			outValue = console::format("%.1f",CONFIG.get<double>(KEY));
 		} else {
 			throw runtime_error(console::format("\"%s\" in project config is not a string or number", commands::escape_quotes(KEY).c_str()));
 		}
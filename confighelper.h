@@ -8,7 +8,8 @@
 /// @brief If project.config exists, returns that otherwise returns project.cfg
 std::string get_config_filename();
 
-/// @brief Load project config from project.config or and project.cfg in that order
+/// @brief Load project config from project.config or and project.cfg in that order. Parsed configs are kept as snapshots in the object cache
+/// by the digest of their text, so the text is only parsed again after it changes (or after cog, and maybe how it parses, changes)
 configstring::ConfigObject get_config() ;
 
 /// @brief If KEY exists, get KEY from CONFIG as a string or throw an error
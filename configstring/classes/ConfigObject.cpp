@@ -1,37 +1,144 @@
-
 #include "ConfigObject.h"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 #include "values.hpp"
 #include "../stringlib.h"
 
 namespace configstring {
+    namespace {
+        /// @brief Smallest block allocated for keys
+        const size_t KEY_CHUNK_SIZE = 4096;
+
+        /// @brief Identifies a snapshot and the version of its layout
+        const char SNAPSHOT_MAGIC[8] = {'c', 'o', 'g', 'c', 'f', 'g', '\0', '\0'};
+        const uint32_t SNAPSHOT_VERSION = 1;
+
+        /// @brief Snapshot layout: magic, version, entry count, key bytes, string bytes, and a checksum of everything after the header
+        const size_t SNAPSHOT_HEADER_SIZE = 40, SNAPSHOT_CHECKSUM_OFFSET = 32;
+
+        /// @brief Each entry: key offset, key length, type, string length, and a payload holding the number, boolean, or string offset
+        const size_t SNAPSHOT_ENTRY_SIZE = 24;
+
+        /// @brief Rounds SIZE up to a multiple of 8
+        size_t align8(const size_t SIZE) {
+            return (SIZE + 7) & ~(size_t)7;
+        }
+
+        /// @brief 64 bit FNV-1a of DATA
+        uint64_t checksum(const std::string_view DATA) {
+            uint64_t hash = 0xcbf29ce484222325ULL;
+            for(const char C : DATA) {
+                hash = (hash ^ (unsigned char)C) * 0x100000001b3ULL;
+            }
+            return hash;
+        }
+
+        /// @brief Copies the SIZE bytes of VALUE into text at OFFSET
+        void put(std::string &text, const size_t OFFSET, const void* const VALUE, const size_t SIZE) {
+            std::memcpy(&text[OFFSET], VALUE, SIZE);
+        }
+
+        /// @brief Reads a T from DATA at OFFSET, which need not be aligned
+        template<typename T>
+        T take(const std::string_view DATA, const size_t OFFSET) {
+            T value;
+            std::memcpy(&value, DATA.data() + OFFSET, sizeof(T));
+            return value;
+        }
+    }
+
     /// @brief Returns the index of key in mKeys (and thus the index of the matching value in mValues) or -1 if it is not found
-    long ConfigObject::getKeyIndex(const std::string key) const {
-        const auto ITER = std::find(mKeys.begin(), mKeys.end(), key);
-        if(ITER != mKeys.end())
-            return ITER - mKeys.begin();
-        else
+    long ConfigObject::getKeyIndex(const std::string_view KEY) const {
+        if(mSlots.empty())
             return -1;
+        return (long)mSlots[findSlot(KEY)] - 1;
+    }
+
+    /// @brief Returns the slot in mSlots holding KEY, or the empty slot where it would go
+    size_t ConfigObject::findSlot(const std::string_view KEY) const {
+        // Linear probing; the table is never more than half full so an empty slot is always close
+        const size_t MASK = mSlots.size() - 1;
+        size_t slot = std::hash<std::string_view>{}(KEY) & MASK;
+        while(mSlots[slot] != 0 && mKeys[mSlots[slot] - 1] != KEY) {
+            slot = (slot + 1) & MASK;
+        }
+        return slot;
+    }
+
+    /// @brief Rebuilds mSlots from mKeys with room for at least CAPACITY keys
+    void ConfigObject::rehash(const size_t CAPACITY) {
+        size_t slots = 8;
+        while(slots < CAPACITY * 2) {
+            slots *= 2;
+        }
+        mSlots.assign(slots, 0);
+        for(size_t i = 0; i < mKeys.size(); i++) {
+            mSlots[findSlot(mKeys[i])] = i + 1;
+        }
+    }
+
+    /// @brief Returns the value of KEY. Throws std::runtime_error if key does not exist
+    const TaggedValue& ConfigObject::at(const std::string_view KEY) const {
+        const long INDEX = getKeyIndex(KEY);
+        if(INDEX > -1)
+            return mValues[INDEX];
+        else 
+            throw std::runtime_error("Unable to get nonexistant key \"" + std::string(KEY) + "\".");
+    }
+
+    /// @brief Throws the std::runtime_error for reading KEY as the wrong TYPE
+    void ConfigObject::throwTypeError(const std::string_view KEY, const TaggedValue::Type TYPE) const {
+        const char* const NAMES[] = {"null", "a number", "a boolean", "a string"};
+        throw std::runtime_error("Key \"" + std::string(KEY) + "\" is not " + NAMES[(int)TYPE] + ".");
+    }
+
+    /// @brief Copies KEY into mKeyChunks and returns a view of the copy
+    std::string_view ConfigObject::storeKey(const std::string_view KEY) {
+        if(KEY.length() > mKeyChunkFree) {
+            mKeyChunkFree = std::max(KEY_CHUNK_SIZE, KEY.length());
+            mKeyChunks.emplace_back(new char[mKeyChunkFree]);
+            mpKeyChunkNext = mKeyChunks.back().get();
+        }
+        char* const P_start = mpKeyChunkNext;
+        std::memcpy(P_start, KEY.data(), KEY.length());
+        mpKeyChunkNext += KEY.length();
+        mKeyChunkFree -= KEY.length();
+        return std::string_view(P_start, KEY.length());
     }
 
-    /// @brief Used in operator= and copy constructor to duplicated pointed to values 
-    void ConfigObject::deepCopyValues(const ConfigObject& OTHER) {
-        for(Value* value : OTHER.mValues) {
-            Value* copy;
-            if (const auto N = value->as<Number>()) {
-                copy = new Number(N->getValue());
-            } else if (const auto B = value->as<Boolean>()) {
-                copy = new Boolean(B->getValue());
-            } else if (const auto S = value->as<String>()) {
-                copy = new String(S->getValue());
-            } else if (const auto num = value->as<Null>()) {
-                copy = new Null;
+    /// @brief Sets KEY to VALUE, whose string (if any) is already in mArena
+    void ConfigObject::setTagged(const std::string_view KEY, const TaggedValue VALUE) {
+        if(mSlots.size() < (mKeys.size() + 1) * 2) {
+            rehash(mKeys.size() + 1);
+        }
+        const size_t SLOT = findSlot(KEY);
+        if(mSlots[SLOT] != 0) {
+            mValues[mSlots[SLOT] - 1] = VALUE;
+            if(mSlots[SLOT] - 1 < mShims.size()) {
+                mShims[mSlots[SLOT] - 1].reset();
             }
-            mValues.push_back(copy);
+        } else {
+            mKeys.push_back(storeKey(KEY));
+            mValues.push_back(VALUE);
+            mSlots[SLOT] = mKeys.size();
+            mSorted.clear();
+        }
+    }
+
+    /// @brief Creates a free store Value holding a copy of VALUE
+    Value* ConfigObject::toValue(const TaggedValue &VALUE) const {
+        switch(VALUE.type()) {
+            case TaggedValue::Type::NUMBER: return new Number(VALUE.number());
+            case TaggedValue::Type::BOOLEAN: return new Boolean(VALUE.boolean());
+            case TaggedValue::Type::STRING: return new String(std::string(VALUE.string(mArena)));
+            default: return new Null;
         }
     }
 
@@ -43,75 +150,297 @@ namespace configstring {
         return mKeys.size();
     }
 
-    /// @brief A std::vector&lt;std::string&gt; of keys in this ConfigObject (Useful for iterating) 
-    std::vector<std::string> ConfigObject::keys() const {
+    /// @brief The keys in this ConfigObject in the order they were added (Useful for iterating). The reference is valid until the ConfigObject changes,
+    /// each view until its key is removed
+    const std::vector<std::string_view>& ConfigObject::keys() const {
         return mKeys;
     }
 
+    /// @brief Keys starting with PREFIX in the order they were added, e.g. every "feature." key. The views are valid until their keys are removed
+    std::vector<std::string_view> ConfigObject::keys_with_prefix(const std::string_view PREFIX) const {
+        std::vector<size_t> matches;
+        {
+            const std::lock_guard<std::mutex> LOCK(mCacheMutex);
+            if(mSorted.size() != mKeys.size()) {
+                mSorted.resize(mKeys.size());
+                for(size_t i = 0; i < mSorted.size(); i++) {
+                    mSorted[i] = i;
+                }
+                std::sort(mSorted.begin(), mSorted.end(), [this](const size_t A, const size_t B) { return mKeys[A] < mKeys[B]; });
+            }
+
+            // Keys with a common prefix are adjacent once sorted, starting at the first key not less than the prefix
+            auto iter = std::lower_bound(mSorted.begin(), mSorted.end(), PREFIX, [this](const size_t INDEX, const std::string_view P) { return mKeys[INDEX] < P; });
+            for(; iter != mSorted.end() && mKeys[*iter].substr(0, PREFIX.length()) == PREFIX; iter++) {
+                matches.push_back(*iter);
+            }
+        }
+
+        std::sort(matches.begin(), matches.end());
+        std::vector<std::string_view> result;
+        result.reserve(matches.size());
+        for(const size_t INDEX : matches) {
+            result.push_back(mKeys[INDEX]);
+        }
+        return result;
+    }
+
     /// @brief True if key exists, false otherwise (Useful to validate a key before using get or remove)
-    bool ConfigObject::has(const std::string key) const {
-        return std::find(mKeys.begin(), mKeys.end(), key) != mKeys.end();
+    bool ConfigObject::has(const std::string_view KEY) const {
+        return getKeyIndex(KEY) > -1;
     }
 
-    /// @brief Gets the value associated with key. Throws std::runtime_error if key does not exist
-    Value* ConfigObject::get(const std::string key) const {
-        const long INDEX = getKeyIndex(key);
-        if(INDEX > -1)
-            return mValues.at(INDEX);
-        else 
-            throw std::runtime_error("Unable to get nonexistant key \"" + key + "\".");
+    /// @brief Gets the value associated with key as a Value owned by this ConfigObject until key is set or removed. Throws std::runtime_error if key does not exist
+    Value* ConfigObject::get(const std::string_view KEY) const {
+        const TaggedValue &VALUE = at(KEY);
+        const size_t INDEX = &VALUE - mValues.data();
+        const std::lock_guard<std::mutex> LOCK(mCacheMutex);
+        if(mShims.size() < mValues.size()) {
+            mShims.resize(mValues.size());
+        }
+        if(!mShims[INDEX]) {
+            mShims[INDEX].reset(toValue(VALUE));
+        }
+        return mShims[INDEX].get();
     }
 
-    /// @brief Set the value associated with key. Adds the key and value if key does not exist
-    void ConfigObject::set(const std::string key, Value* const P_value) {
-        const long INDEX = getKeyIndex(key);
-        if(INDEX > -1) {
-            mValues.at(INDEX) = P_value;
+    /// @brief Set key to null. Adds the key if it does not exist
+    void ConfigObject::set(const std::string_view KEY, const std::nullptr_t) {
+        setTagged(KEY, TaggedValue());
+    }
+
+    /// @brief Set key to a number. Adds the key if it does not exist
+    void ConfigObject::set(const std::string_view KEY, const double D) {
+        setTagged(KEY, TaggedValue(D));
+    }
+
+    /// @brief Set key to a boolean. Adds the key if it does not exist
+    void ConfigObject::set(const std::string_view KEY, const bool B) {
+        setTagged(KEY, TaggedValue(B));
+    }
+
+    /// @brief Set key to a string. Adds the key if it does not exist
+    void ConfigObject::set(const std::string_view KEY, const std::string_view TEXT) {
+        setTagged(KEY, TaggedValue(TEXT, mArena));
+    }
+
+    /// @brief Set key to a string. Adds the key if it does not exist
+    void ConfigObject::set(const std::string_view KEY, const char* const TEXT) {
+        set(KEY, std::string_view(TEXT));
+    }
+
+    /// @brief Set the value associated with key from a free store Value, which is deleted. Adds the key and value if key does not exist
+    void ConfigObject::set(const std::string_view KEY, Value* const P_value) {
+        if(const auto N = P_value->as<Number>()) {
+            set(KEY, N->getValue());
+        } else if(const auto B = P_value->as<Boolean>()) {
+            set(KEY, B->getValue());
+        } else if(const auto S = P_value->as<String>()) {
+            set(KEY, std::string_view(S->getValue()));
         } else {
-            mKeys.push_back(key);
-            mValues.push_back(P_value);
+            set(KEY, nullptr);
         }
+        delete P_value;
     }
     
-    /// @brief Removes key and its associated value. Throws std::runtime_error if key does not exist. The removed value is returned and not deleted
-    Value* ConfigObject::remove(const std::string key) {
-        const long INDEX = getKeyIndex(key);
+    /// @brief Removes key and its associated value. Throws std::runtime_error if key does not exist. The removed value is returned as a free store Value for the caller to delete
+    Value* ConfigObject::remove(const std::string_view KEY) {
+        const long INDEX = getKeyIndex(KEY);
         if(INDEX > -1) {
-            Value* const P_value =  mValues.at(INDEX);
+            Value* const P_value = toValue(mValues[INDEX]);
             mKeys.erase(mKeys.begin() + INDEX);
             mValues.erase(mValues.begin() + INDEX);
+            if((size_t)INDEX < mShims.size()) {
+                mShims.erase(mShims.begin() + INDEX);
+            }
+            // Later keys moved down an index, so every slot after them would be stale
+            rehash(mKeys.size());
+            mSorted.clear();
             return P_value;
         } else { 
-            throw std::runtime_error("Unable to remove nonexistant key \"" + key + "\".");
+            throw std::runtime_error("Unable to remove nonexistant key \"" + std::string(KEY) + "\".");
         }
     }
 
     /// @brief Get a representation of this ConfigObject in a writable form
     std::string ConfigObject::stringify() const {
         std::string result;
-        for(std::string key : keys()) {
-            const Value* value = get(key);
-            result += stringlib::minimal_encode(key) + "=" + stringlib::minimal_encode(value->stringify()) + ";";
+        for(size_t i = 0; i < mKeys.size(); i++) {
+            stringlib::minimal_encode(mKeys[i], result);
+            result += '=';
+            stringlib::minimal_encode(mValues[i].stringify(mArena), result);
+            result += ';';
         }
         return result;
     }
 
-    ConfigObject::ConfigObject(const ConfigObject& OTHER): mKeys(OTHER.mKeys) {
-        deepCopyValues(OTHER);
+    /// @brief Get this ConfigObject in the binary snapshot format: a versioned, checksummed header followed by fixed width entries and the bytes of
+    /// keys and strings, all at 8 byte aligned offsets in native byte order. Meant for caches read back by the same machine
+    std::string ConfigObject::snapshot() const {
+        size_t keyBytes = 0, stringBytes = 0;
+        for(size_t i = 0; i < mKeys.size(); i++) {
+            keyBytes += mKeys[i].length();
+            if(mValues[i].type() == TaggedValue::Type::STRING) {
+                stringBytes += mValues[i].string(mArena).length();
+            }
+        }
+
+        const size_t KEYS_START = SNAPSHOT_HEADER_SIZE + mKeys.size() * SNAPSHOT_ENTRY_SIZE, STRINGS_START = KEYS_START + align8(keyBytes);
+        std::string result(STRINGS_START + align8(stringBytes), '\0');
+        size_t keyOffset = 0, stringOffset = 0;
+        for(size_t i = 0; i < mKeys.size(); i++) {
+            const size_t ENTRY = SNAPSHOT_HEADER_SIZE + i * SNAPSHOT_ENTRY_SIZE;
+            const uint32_t KEY_OFFSET = (uint32_t)keyOffset, KEY_LENGTH = (uint32_t)mKeys[i].length(), TYPE = (uint32_t)mValues[i].type();
+            uint32_t stringLength = 0;
+            uint64_t payload = 0;
+            put(result, KEYS_START + keyOffset, mKeys[i].data(), KEY_LENGTH);
+            keyOffset += KEY_LENGTH;
+
+            if(mValues[i].type() == TaggedValue::Type::NUMBER) {
+                const double NUMBER = mValues[i].number();
+                std::memcpy(&payload, &NUMBER, sizeof(NUMBER));
+            } else if(mValues[i].type() == TaggedValue::Type::BOOLEAN) {
+                payload = mValues[i].boolean();
+            } else if(mValues[i].type() == TaggedValue::Type::STRING) {
+                const std::string_view TEXT = mValues[i].string(mArena);
+                put(result, STRINGS_START + stringOffset, TEXT.data(), TEXT.length());
+                stringLength = (uint32_t)TEXT.length();
+                payload = stringOffset;
+                stringOffset += TEXT.length();
+            }
+            put(result, ENTRY, &KEY_OFFSET, 4);
+            put(result, ENTRY + 4, &KEY_LENGTH, 4);
+            put(result, ENTRY + 8, &TYPE, 4);
+            put(result, ENTRY + 12, &stringLength, 4);
+            put(result, ENTRY + 16, &payload, 8);
+        }
+
+        const uint32_t ENTRIES = (uint32_t)mKeys.size();
+        const uint64_t KEY_BYTES = keyBytes, STRING_BYTES = stringBytes;
+        put(result, 0, SNAPSHOT_MAGIC, 8);
+        put(result, 8, &SNAPSHOT_VERSION, 4);
+        put(result, 12, &ENTRIES, 4);
+        put(result, 16, &KEY_BYTES, 8);
+        put(result, 24, &STRING_BYTES, 8);
+        const uint64_t CHECKSUM = checksum(std::string_view(result).substr(SNAPSHOT_HEADER_SIZE));
+        put(result, SNAPSHOT_CHECKSUM_OFFSET, &CHECKSUM, 8);
+        return result;
     }
 
-    ConfigObject::~ConfigObject() {
-        for(const Value* value : mValues)
-            delete value;
+    /// @brief Loads a ConfigObject from DATA written by snapshot, with one allocation each for keys, strings, and the tables rather than per entry.
+    /// Throws std::runtime_error if DATA is truncated, corrupt, or from another version
+    ConfigObject ConfigObject::from_snapshot(const std::string_view DATA) {
+        if(DATA.length() < SNAPSHOT_HEADER_SIZE || std::memcmp(DATA.data(), SNAPSHOT_MAGIC, 8) != 0 || take<uint32_t>(DATA, 8) != SNAPSHOT_VERSION) {
+            throw std::runtime_error("Config snapshot is not in a supported format.");
+        }
+        const uint32_t ENTRIES = take<uint32_t>(DATA, 12);
+        const uint64_t KEY_BYTES = take<uint64_t>(DATA, 16), STRING_BYTES = take<uint64_t>(DATA, 24);
+        // Sizes are checked one at a time so a corrupt header cannot overflow the total
+        if(KEY_BYTES > DATA.length() || STRING_BYTES > DATA.length()
+            || SNAPSHOT_HEADER_SIZE + (uint64_t)ENTRIES * SNAPSHOT_ENTRY_SIZE + align8(KEY_BYTES) + align8(STRING_BYTES) != DATA.length()
+            || checksum(DATA.substr(SNAPSHOT_HEADER_SIZE)) != take<uint64_t>(DATA, SNAPSHOT_CHECKSUM_OFFSET)) {
+            throw std::runtime_error("Config snapshot is truncated or corrupt.");
+        }
+
+        const size_t KEYS_START = SNAPSHOT_HEADER_SIZE + (size_t)ENTRIES * SNAPSHOT_ENTRY_SIZE, STRINGS_START = KEYS_START + align8(KEY_BYTES);
+        ConfigObject result;
+        if(KEY_BYTES > 0) {
+            result.mKeyChunks.emplace_back(new char[KEY_BYTES]);
+            std::memcpy(result.mKeyChunks.back().get(), DATA.data() + KEYS_START, KEY_BYTES);
+        }
+        result.mArena.assign(DATA.data() + STRINGS_START, STRING_BYTES);
+        result.mKeys.reserve(ENTRIES);
+        result.mValues.reserve(ENTRIES);
+        result.rehash(ENTRIES);
+
+        for(size_t i = 0; i < ENTRIES; i++) {
+            const size_t ENTRY = SNAPSHOT_HEADER_SIZE + i * SNAPSHOT_ENTRY_SIZE;
+            const uint32_t KEY_OFFSET = take<uint32_t>(DATA, ENTRY), KEY_LENGTH = take<uint32_t>(DATA, ENTRY + 4), TYPE = take<uint32_t>(DATA, ENTRY + 8), STRING_LENGTH = take<uint32_t>(DATA, ENTRY + 12);
+            const uint64_t PAYLOAD = take<uint64_t>(DATA, ENTRY + 16);
+            if((uint64_t)KEY_OFFSET + KEY_LENGTH > KEY_BYTES || TYPE > (uint32_t)TaggedValue::Type::STRING
+                || (TYPE == (uint32_t)TaggedValue::Type::STRING && PAYLOAD + STRING_LENGTH > STRING_BYTES)) {
+                throw std::runtime_error("Config snapshot is truncated or corrupt.");
+            }
+
+            TaggedValue value;
+            if(TYPE == (uint32_t)TaggedValue::Type::NUMBER) {
+                double number;
+                std::memcpy(&number, &PAYLOAD, sizeof(number));
+                value = TaggedValue(number);
+            } else if(TYPE == (uint32_t)TaggedValue::Type::BOOLEAN) {
+                value = TaggedValue(PAYLOAD != 0);
+            } else if(TYPE == (uint32_t)TaggedValue::Type::STRING) {
+                value = STRING_LENGTH <= TaggedValue::INLINE_CAPACITY ? TaggedValue(std::string_view(DATA.data() + STRINGS_START + PAYLOAD, STRING_LENGTH), result.mArena) : TaggedValue::in_arena(PAYLOAD, STRING_LENGTH);
+            }
+
+            // Keys view the single block holding every key
+            const std::string_view KEY(result.mKeyChunks.empty() ? "" : result.mKeyChunks.back().get() + KEY_OFFSET, KEY_LENGTH);
+            const size_t SLOT = result.findSlot(KEY);
+            if(result.mSlots[SLOT] != 0) {
+                result.mValues[result.mSlots[SLOT] - 1] = value;
+            } else {
+                result.mKeys.push_back(KEY);
+                result.mValues.push_back(value);
+                result.mSlots[SLOT] = result.mKeys.size();
+            }
+        }
+        return result;
     }
 
+    /// @brief Makes this a copy of OTHER, which must be empty, packing its keys into one block
+    void ConfigObject::copyFrom(const ConfigObject &OTHER) {
+        size_t keyBytes = 0;
+        for(const std::string_view KEY : OTHER.mKeys) {
+            keyBytes += KEY.length();
+        }
+        if(keyBytes > 0) {
+            mKeyChunks.emplace_back(new char[keyBytes]);
+            mpKeyChunkNext = mKeyChunks.back().get();
+            mKeyChunkFree = keyBytes;
+        }
+        mKeys.reserve(OTHER.mKeys.size());
+        for(const std::string_view KEY : OTHER.mKeys) {
+            mKeys.push_back(storeKey(KEY));
+        }
+        mValues = OTHER.mValues;
+        mArena = OTHER.mArena;
+        mSlots = OTHER.mSlots;
+    }
+
+    ConfigObject::ConfigObject(const ConfigObject& OTHER) {
+        copyFrom(OTHER);
+    }
+
+    ConfigObject::ConfigObject(ConfigObject&& other) noexcept: mKeys(std::move(other.mKeys)), mKeyChunks(std::move(other.mKeyChunks)), mpKeyChunkNext(other.mpKeyChunkNext), mKeyChunkFree(other.mKeyChunkFree),
+        mValues(std::move(other.mValues)), mArena(std::move(other.mArena)), mSlots(std::move(other.mSlots)), mSorted(std::move(other.mSorted)), mShims(std::move(other.mShims)) {
+        other.mpKeyChunkNext = nullptr;
+        other.mKeyChunkFree = 0;
+    }
+
+    ConfigObject::~ConfigObject() {}
+
     ConfigObject& ConfigObject::operator=(const ConfigObject& OTHER) {
         if(this != &OTHER) {
-            this->~ConfigObject();
-            mKeys = OTHER.mKeys;
-            mValues = std::vector<Value*>();
-            deepCopyValues(OTHER);
+            ConfigObject copy(OTHER);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    ConfigObject& ConfigObject::operator=(ConfigObject&& other) noexcept {
+        if(this != &other) {
+            mKeys = std::move(other.mKeys);
+            mKeyChunks = std::move(other.mKeyChunks);
+            mpKeyChunkNext = other.mpKeyChunkNext;
+            mKeyChunkFree = other.mKeyChunkFree;
+            mValues = std::move(other.mValues);
+            mArena = std::move(other.mArena);
+            mSlots = std::move(other.mSlots);
+            mSorted = std::move(other.mSorted);
+            mShims = std::move(other.mShims);
+            other.mpKeyChunkNext = nullptr;
+            other.mKeyChunkFree = 0;
         }
         return *this;
     }
-}
\ No newline at end of file
+}
@@ -1,27 +1,75 @@
 #ifndef CONFIGOBJECT_H
 #define CONFIGOBJECT_H
 
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "values.hpp"
 
 namespace configstring {
-    /// @brief A map of string keys and Values; all Values should be free store allocated and will automatically be deleted when the ConfigObject goes out of scope
+    /// @brief A map of string keys and values stored inline as TaggedValues. The older Value* interface still works: values passed to set are
+    /// converted and deleted, and get returns a Value owned by the ConfigObject
     class ConfigObject final {
         private:
-            /// @brief List of keys
-            std::vector<std::string> mKeys;
+            /// @brief List of keys in insertion order, viewing bytes in mKeyChunks
+            std::vector<std::string_view> mKeys;
+
+            /// @brief Blocks the bytes of keys are copied into. Blocks never move, so views into them stay valid as keys are added
+            std::vector<std::unique_ptr<char[]>> mKeyChunks;
+
+            /// @brief The first unused byte of the last block in mKeyChunks and how many bytes are left after it
+            char* mpKeyChunkNext = nullptr;
+            size_t mKeyChunkFree = 0;
 
             /// @brief List of values in order matching their keys
-            std::vector<Value*> mValues;
+            std::vector<TaggedValue> mValues;
+
+            /// @brief Storage for strings too long to keep inline in mValues. Overwritten strings stay until the ConfigObject is destroyed
+            std::string mArena;
+
+            /// @brief Open addressing hash table of indices into mKeys plus one, 0 marks an empty slot. Its size is a power of two at least twice the number of keys
+            std::vector<size_t> mSlots;
+
+            /// @brief Indices into mKeys sorted by key, built by the first prefix query after keys are added or removed
+            mutable std::vector<size_t> mSorted;
+
+            /// @brief Values handed out by the Value* get, by index, created on first use
+            mutable std::vector<std::unique_ptr<Value>> mShims;
+
+            /// @brief Guards mSorted and mShims so const members can run from several threads
+            mutable std::mutex mCacheMutex;
 
             /// @brief Returns the index of key in mKeys (and thus the index of the matching value in mValues) or -1 if it is not found
-            long getKeyIndex(const std::string key) const;
+            long getKeyIndex(const std::string_view KEY) const;
+
+            /// @brief Returns the slot in mSlots holding KEY, or the empty slot where it would go
+            size_t findSlot(const std::string_view KEY) const;
+
+            /// @brief Rebuilds mSlots from mKeys with room for at least CAPACITY keys
+            void rehash(const size_t CAPACITY);
+
+            /// @brief Returns the value of KEY. Throws std::runtime_error if key does not exist
+            const TaggedValue& at(const std::string_view KEY) const;
+
+            /// @brief Throws the std::runtime_error for reading KEY as the wrong TYPE
+            [[noreturn]] void throwTypeError(const std::string_view KEY, const TaggedValue::Type TYPE) const;
+
+            /// @brief Copies KEY into mKeyChunks and returns a view of the copy
+            std::string_view storeKey(const std::string_view KEY);
+
+            /// @brief Sets KEY to VALUE, whose string (if any) is already in mArena
+            void setTagged(const std::string_view KEY, const TaggedValue VALUE);
+
+            /// @brief Makes this a copy of OTHER, which must be empty, packing its keys into one block
+            void copyFrom(const ConfigObject &OTHER);
+
+            /// @brief Creates a free store Value holding a copy of VALUE
+            Value* toValue(const TaggedValue &VALUE) const;
 
-            /// @brief Used in operator= and copy constructor to duplicated pointed to values 
-            void deepCopyValues(const ConfigObject& OTHER);
-            
         public:
             /// @brief Default constructor
             ConfigObject();
@@ -29,28 +77,83 @@ namespace configstring {
             /// @brief The number of entries in this ConfigObject 
             size_t size() const;
 
-            /// @brief A std::vector&lt;std::string&gt; of keys in this ConfigObject (Useful for iterating) 
-            std::vector<std::string> keys() const;
+            /// @brief The keys in this ConfigObject in the order they were added (Useful for iterating). The reference is valid until the ConfigObject changes,
+            /// each view until its key is removed
+            const std::vector<std::string_view>& keys() const;
+
+            /// @brief Keys starting with PREFIX in the order they were added, e.g. every "feature." key. The views are valid until their keys are removed
+            std::vector<std::string_view> keys_with_prefix(const std::string_view PREFIX) const;
 
             /// @brief True if key exists, false otherwise (Useful to validate a key before using get or remove)
-            bool has(const std::string key) const;
+            bool has(const std::string_view KEY) const;
+
+            /// @brief True if KEY exists and holds a T (std::nullptr_t, double, bool, std::string, or std::string_view)
+            template<typename T>
+            bool is(const std::string_view KEY) const {
+                const long INDEX = getKeyIndex(KEY);
+                return INDEX > -1 && mValues[INDEX].type() == TaggedValue::type_of<T>();
+            }
+
+            /// @brief Gets the value of KEY as a T (std::nullptr_t, double, bool, std::string, or std::string_view). Throws std::runtime_error if key
+            /// does not exist or holds another type. A std::string_view is valid until the ConfigObject changes
+            template<typename T>
+            T get(const std::string_view KEY) const {
+                const TaggedValue &VALUE = at(KEY);
+                if(VALUE.type() != TaggedValue::type_of<T>()) {
+                    throwTypeError(KEY, TaggedValue::type_of<T>());
+                }
+                if constexpr(std::is_same_v<T, std::nullptr_t>) {
+                    return nullptr;
+                } else if constexpr(std::is_same_v<T, double>) {
+                    return VALUE.number();
+                } else if constexpr(std::is_same_v<T, bool>) {
+                    return VALUE.boolean();
+                } else {
+                    return T(VALUE.string(mArena));
+                }
+            }
+
+            /// @brief Gets the value associated with key as a Value owned by this ConfigObject until key is set or removed. Throws std::runtime_error if key does not exist
+            Value* get(const std::string_view KEY) const;
 
-            /// @brief Gets the value associated with key. Throws std::runtime_error if key does not exist
-            Value* get(const std::string key) const;
+            /// @brief Set key to null. Adds the key if it does not exist
+            void set(const std::string_view KEY, const std::nullptr_t);
 
-            /// @brief Set the value associated with key. Adds the key and value if key does not exist
-            void set(const std::string key, Value* const P_value);
+            /// @brief Set key to a number. Adds the key if it does not exist
+            void set(const std::string_view KEY, const double D);
 
-            /// @brief Removes key and its associated value. Throws std::runtime_error if key does not exist. The removed value is returned and not deleted
-            Value* remove(const std::string key);
+            /// @brief Set key to a boolean. Adds the key if it does not exist
+            void set(const std::string_view KEY, const bool B);
+
+            /// @brief Set key to a string. Adds the key if it does not exist
+            void set(const std::string_view KEY, const std::string_view TEXT);
+
+            /// @brief Set key to a string. Adds the key if it does not exist
+            void set(const std::string_view KEY, const char* const TEXT);
+
+            /// @brief Set the value associated with key from a free store Value, which is deleted. Adds the key and value if key does not exist
+            void set(const std::string_view KEY, Value* const P_value);
+
+            /// @brief Removes key and its associated value. Throws std::runtime_error if key does not exist. The removed value is returned as a free store Value for the caller to delete
+            Value* remove(const std::string_view KEY);
 
             /// @brief Get a representation of this ConfigObject in a writable form
             std::string stringify() const;
 
+            /// @brief Get this ConfigObject in the binary snapshot format: a versioned, checksummed header followed by fixed width entries and the bytes of
+            /// keys and strings, all at 8 byte aligned offsets in native byte order. Meant for caches read back by the same machine
+            std::string snapshot() const;
+
+            /// @brief Loads a ConfigObject from DATA written by snapshot, with one allocation each for keys, strings, and the tables rather than per entry.
+            /// Throws std::runtime_error if DATA is truncated, corrupt, or from another version
+            static ConfigObject from_snapshot(const std::string_view DATA);
+
             // Three shall be the number thou shalt count, and the number of the counting shall be three.
             ConfigObject(const ConfigObject &OTHER);
+            ConfigObject(ConfigObject &&other) noexcept;
             ~ConfigObject();
             ConfigObject& operator=(const ConfigObject& OTHER);
+            ConfigObject& operator=(ConfigObject&& other) noexcept;
     };
 }
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,8 @@
 #include "values.hpp"
 
+#include <cstring>
 #include <string>
+#include <string_view>
 #include <sstream>
 
 namespace configstring {
@@ -54,4 +56,70 @@ namespace configstring {
     std::string String::stringify() const {
         return "\"" + mValue  + "\"";
     }
+
+    //================== class TaggedValue ===================//
+    /// @brief Creates a null value
+    TaggedValue::TaggedValue(): mNumber(0) {}
+
+    /// @brief Creates a number
+    TaggedValue::TaggedValue(const double D): mType(Type::NUMBER), mNumber(D) {}
+
+    /// @brief Creates a boolean
+    TaggedValue::TaggedValue(const bool B): mType(Type::BOOLEAN), mBoolean(B) {}
+
+    /// @brief Creates a string, appending TEXT to arena if it is too long to store inline
+    TaggedValue::TaggedValue(const std::string_view TEXT, std::string &arena): mType(Type::STRING), mNumber(0) {
+        if(TEXT.length() <= INLINE_CAPACITY) {
+            mInlineLength = (unsigned char)TEXT.length();
+            std::memcpy(mInline, TEXT.data(), TEXT.length());
+        } else {
+            mInlineLength = IN_ARENA;
+            mArena.offset = (unsigned int)arena.length();
+            mArena.length = (unsigned int)TEXT.length();
+            arena.append(TEXT);
+        }
+    }
+
+    /// @brief A string of LENGTH characters already in an arena at OFFSET, for LENGTH over INLINE_CAPACITY
+    TaggedValue TaggedValue::in_arena(const size_t OFFSET, const size_t LENGTH) {
+        TaggedValue result;
+        result.mType = Type::STRING;
+        result.mInlineLength = IN_ARENA;
+        result.mArena.offset = (unsigned int)OFFSET;
+        result.mArena.length = (unsigned int)LENGTH;
+        return result;
+    }
+
+    /// @brief The type of value held
+    TaggedValue::Type TaggedValue::type() const {
+        return mType;
+    }
+
+    /// @brief The number held, only meaningful if type() is NUMBER
+    double TaggedValue::number() const {
+        return mNumber;
+    }
+
+    /// @brief The boolean held, only meaningful if type() is BOOLEAN
+    bool TaggedValue::boolean() const {
+        return mBoolean;
+    }
+
+    /// @brief The string held, only meaningful if type() is STRING. ARENA must be the string given when this value was created
+    std::string_view TaggedValue::string(const std::string &ARENA) const {
+        if(mInlineLength == IN_ARENA) {
+            return std::string_view(ARENA).substr(mArena.offset, mArena.length);
+        }
+        return std::string_view(mInline, mInlineLength);
+    }
+
+    /// @brief Get this value in a writable form, matching Value::stringify
+    std::string TaggedValue::stringify(const std::string &ARENA) const {
+        switch(mType) {
+            case Type::NUMBER: return Number(mNumber).stringify();
+            case Type::BOOLEAN: return mBoolean ? "true" : "false";
+            case Type::STRING: return "\"" + std::string(string(ARENA)) + "\"";
+            default: return "null";
+        }
+    }
 }
\ No newline at end of file
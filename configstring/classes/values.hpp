@@ -1,7 +1,10 @@
 #ifndef VALUES_HPP
 #define VALUES_HPP
 
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
 namespace configstring {
     class Value {
@@ -88,5 +91,78 @@ namespace configstring {
             /// @brief Get the value of this String in a writable form
             std::string stringify() const override;
     };
+
+    /// @brief A value stored inline without RTTI: a type tag plus a number, boolean, or string. Strings of up to INLINE_CAPACITY characters
+    /// are kept in the value itself, longer ones in an arena string owned by whoever holds the value (see ConfigObject)
+    class TaggedValue final {
+        public:
+            enum class Type : unsigned char { NULL_VALUE, NUMBER, BOOLEAN, STRING };
+
+            /// @brief The longest string stored without the arena
+            static constexpr size_t INLINE_CAPACITY = 14;
+
+            /// @brief The Type used to store a C++ T, one of std::nullptr_t, double, bool, std::string, or std::string_view
+            template<typename T>
+            static constexpr Type type_of() {
+                if constexpr(std::is_same_v<T, std::nullptr_t>) {
+                    return Type::NULL_VALUE;
+                } else if constexpr(std::is_same_v<T, double>) {
+                    return Type::NUMBER;
+                } else if constexpr(std::is_same_v<T, bool>) {
+                    return Type::BOOLEAN;
+                } else {
+                    static_assert(std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>, "Config values are null, double, bool, or strings");
+                    return Type::STRING;
+                }
+            }
+
+        private:
+            Type mType = Type::NULL_VALUE;
+            /// @brief mInlineLength of a string kept in the arena
+            static constexpr unsigned char IN_ARENA = 0xFF;
+
+            /// @brief Length of an inline string, or IN_ARENA
+            unsigned char mInlineLength = 0;
+            union {
+                double mNumber;
+                bool mBoolean;
+                char mInline[INLINE_CAPACITY];
+                /// @brief Where a long string starts in the arena and how long it is
+                struct {
+                    unsigned int offset, length;
+                } mArena;
+            };
+
+        public:
+            /// @brief Creates a null value
+            TaggedValue();
+
+            /// @brief Creates a number
+            explicit TaggedValue(const double D);
+
+            /// @brief Creates a boolean
+            explicit TaggedValue(const bool B);
+
+            /// @brief Creates a string, appending TEXT to arena if it is too long to store inline
+            TaggedValue(const std::string_view TEXT, std::string &arena);
+
+            /// @brief A string of LENGTH characters already in an arena at OFFSET, for LENGTH over INLINE_CAPACITY
+            static TaggedValue in_arena(const size_t OFFSET, const size_t LENGTH);
+
+            /// @brief The type of value held
+            Type type() const;
+
+            /// @brief The number held, only meaningful if type() is NUMBER
+            double number() const;
+
+            /// @brief The boolean held, only meaningful if type() is BOOLEAN
+            bool boolean() const;
+
+            /// @brief The string held, only meaningful if type() is STRING. ARENA must be the string given when this value was created
+            std::string_view string(const std::string &ARENA) const;
+
+            /// @brief Get this value in a writable form, matching Value::stringify
+            std::string stringify(const std::string &ARENA) const;
+    };
 }
 #endif
\ No newline at end of file
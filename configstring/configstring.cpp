@@ -1,15 +1,68 @@
 #include <string>
+#include <string_view>
 #include <vector>
-#include <regex>
-#include <sstream>
-#include <algorithm>
-#include <exception>
+#include <cstdlib>
+#include <stdexcept>
 
 #include "configstring.h"
 
 using namespace configstring::stringlib;
 
 namespace configstring {
+    namespace {
+        /// @brief TEXT decoded into a new string, see minimal_decode
+        std::string decode(const std::string_view TEXT) {
+            std::string result;
+            minimal_decode(TEXT, result);
+            return result;
+        }
+
+        /// @brief True if TEXT equals LOWER (which is all lowercase) ignoring case
+        bool equals_ignoring_case(const std::string_view TEXT, const std::string_view LOWER) {
+            if(TEXT.length() != LOWER.length()) {
+                return false;
+            }
+            for(size_t i = 0; i < TEXT.length(); i++) {
+                if((TEXT[i] >= 'A' && TEXT[i] <= 'Z' ? TEXT[i] - 'A' + 'a' : TEXT[i]) != LOWER[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief True if TEXT is one or more digits, optionally followed by a dot and one or more digits
+        bool is_number(const std::string_view TEXT) {
+            size_t i = 0, digits = 0;
+            for(; i < TEXT.length() && TEXT[i] >= '0' && TEXT[i] <= '9'; i++, digits++);
+            if(digits == 0) {
+                return false;
+            } else if(i == TEXT.length()) {
+                return true;
+            } else if(TEXT[i++] != '.') {
+                return false;
+            }
+            for(digits = 0; i < TEXT.length() && TEXT[i] >= '0' && TEXT[i] <= '9'; i++, digits++);
+            return digits > 0 && i == TEXT.length();
+        }
+
+        /// @brief Sets KEY in OBJECT to the typed value of the already trimmed and decoded TEXT, see str_to_value
+        void assign(ConfigObject &object, const std::string_view KEY, const std::string_view TEXT) {
+            if(equals_ignoring_case(TEXT, "true")) {
+                object.set(KEY, true);
+            } else if(equals_ignoring_case(TEXT, "false")) {
+                object.set(KEY, false);
+            } else if(equals_ignoring_case(TEXT, "null") || str_is_empty(TEXT)) {
+                object.set(KEY, nullptr);
+            } else if(is_number(TEXT)) {
+                object.set(KEY, std::strtod(std::string(TEXT).c_str(), nullptr));
+            } else if(TEXT.length() >= 2 && TEXT.front() == '"' && TEXT.back() == '"') {
+                object.set(KEY, TEXT.substr(1, TEXT.length() - 2));
+            } else {
+                object.set(KEY, TEXT);
+            }
+        }
+    }
+
     /// @brief Converts the ConfigObject to a string that can be parsed later
     std::string stringify(const ConfigObject& OBJECT) {
         return OBJECT.stringify();
@@ -17,38 +70,56 @@ namespace configstring {
 
     /// @brief Parses the value portion of an entry and returns a free store pointer to a wrapped C++ value
     Value* str_to_value(std::string text) {
-        const std::string LOWER = str_to_lower(text);
-        if(LOWER == "true") {
-            return new Boolean(true);
-        } else if(LOWER == "false") {
-            return new Boolean(false);
-        } else if(LOWER == "null" || str_is_empty(text)) {
-            return new Null;
-        } else if(std::regex_match(text, std::regex(R"(^\d+(?:\.\d+)?$)", std::regex_constants::ECMAScript))) {
-            return new Number(std::stod(text));
-        } else {
-            return new String(std::regex_replace(text, std::regex("^\"([" R"(\s\S)" "]*)\"$", std::regex_constants::ECMAScript), "$1"));
-        }
+        ConfigObject object;
+        assign(object, "", text);
+        return object.remove("");
     }
 
-    /// @brief Parses a full source string into a ConfigObject with typed values
-    ConfigObject parse(const std::string& TEXT) {
+    /// @brief Parses a full source string into a ConfigObject with typed values. Throws std::runtime_error naming the line and column of the first malformed entry
+    ConfigObject parse(const std::string_view TEXT) {
+        // One pass over the text finds the end of each entry, its = signs, and where lines start. Entries are views into TEXT,
+        // so only decoded keys and values are allocated
         ConfigObject result;
-        for(const std::string &ENTRY : str_split(TEXT, (const char)';')) {
-            if(!str_is_empty(ENTRY)) {
-                if(str_trim(ENTRY).rfind("#",0) == 0)
-                    continue;
-                const std::vector<std::string> KEYVALUE = str_split(ENTRY, (const char) '=');
-                if(KEYVALUE.size() == 1) {
-                    result.set(minimal_decode(str_trim(KEYVALUE.at(0))), str_to_value(""));
+        size_t line = 1, lineStart = 0, entryStart = 0;
+        size_t firstEquals = std::string_view::npos, secondEquals = std::string_view::npos, errorLine = 0, errorColumn = 0;
+        bool thirdEquals = false;
+        for(size_t i = 0; i <= TEXT.length(); i++) {
+            if(i < TEXT.length() && TEXT[i] != ';') {
+                if(TEXT[i] == '=') {
+                    if(firstEquals == std::string_view::npos) {
+                        firstEquals = i;
+                    } else if(secondEquals == std::string_view::npos) {
+                        secondEquals = i;
+                        errorLine = line;
+                        errorColumn = i - lineStart + 1;
+                    } else {
+                        thirdEquals = true;
+                    }
+                } else if(TEXT[i] == '\n') {
+                    line++;
+                    lineStart = i + 1;
+                }
+                continue;
+            }
+
+            const std::string_view ENTRY = TEXT.substr(entryStart, i - entryStart);
+            const std::string_view TRIMMED = str_trim_view(ENTRY);
+            if(!TRIMMED.empty() && TRIMMED.front() != '#') {
+                // A second = is only allowed as the last character of the entry, where it ends an empty value
+                if(secondEquals != std::string_view::npos && (thirdEquals || secondEquals + 1 != i)) {
+                    throw std::runtime_error("Not all entries are in the format \"key=value\" (line " + std::to_string(errorLine) + ", column " + std::to_string(errorColumn) + ").");
                 }
-                else if(KEYVALUE.size() == 2) {
-                    result.set(minimal_decode(str_trim(KEYVALUE.at(0))), str_to_value(minimal_decode(str_trim(KEYVALUE.at(1)))));
+                if(firstEquals == std::string_view::npos) {
+                    result.set(decode(TRIMMED), nullptr);
                 } else {
-                    throw std::runtime_error("Not all entries are in the format \"key=value\".");
+                    const size_t VALUE_END = secondEquals == std::string_view::npos ? i : secondEquals;
+                    assign(result, decode(str_trim_view(TEXT.substr(entryStart, firstEquals - entryStart))), decode(str_trim_view(TEXT.substr(firstEquals + 1, VALUE_END - firstEquals - 1))));
                 }
             }
+            entryStart = i + 1;
+            firstEquals = secondEquals = std::string_view::npos;
+            thirdEquals = false;
         }
         return result;
     }
-}
\ No newline at end of file
+}
@@ -2,6 +2,7 @@
 #define CONFIGSTRING_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "stringlib.h"
@@ -15,7 +16,7 @@ namespace configstring {
     /// @brief Parses the value portion of an entry and returns a free store pointer to a wrapped C++ value
     Value* str_to_value(std::string text);
 
-    /// @brief Parses a full source string into a ConfigObject with typed values
-    ConfigObject parse(const std::string& TEXT);
+    /// @brief Parses a full source string into a ConfigObject with typed values. Throws std::runtime_error naming the line and column of the first malformed entry
+    ConfigObject parse(const std::string_view TEXT);
 }
 #endif
\ No newline at end of file
@@ -1,11 +1,200 @@
 #include "stringlib.h"
 
+#include <cstring>
 #include <string>
-#include <sstream>
-#include <regex>
+#include <string_view>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define STRINGLIB_X86
+#include <immintrin.h>
+#endif
 
 namespace configstring {
     namespace stringlib {
+        namespace {
+            /// @brief True for the characters str_trim removes (\\n \\r \\t \\f \\v <space>)
+            bool is_space(const char C) {
+                return C == ' ' || (C >= '\t' && C <= '\r');
+            }
+
+            // Every kernel works on the bytes [begin, end) of P. The SIMD versions handle whole blocks and leave the rest to the
+            // next narrower version, so the AVX2 kernels also exercise the SSE2 and scalar ones on the tail
+
+            /// @brief The code minimal_encode writes in place of C, or nullptr if C is kept as is
+            const char* encoding_of(const char C) {
+                return C == '%' ? "%25" : C == '=' ? "%3D" : C == ';' ? "%3B" : nullptr;
+            }
+
+            /// @brief Appends bytes [begin, END) encoded like minimal_encode to out
+            void encode_scalar(const char *P, size_t begin, const size_t END, std::string &out) {
+                size_t done = begin;
+                for(; begin < END; begin++) {
+                    const char* const P_CODE = encoding_of(P[begin]);
+                    if(P_CODE) {
+                        out.append(P + done, begin - done).append(P_CODE, 3);
+                        done = begin + 1;
+                    }
+                }
+                out.append(P + done, END - done);
+            }
+
+            /// @brief Index of the first byte that is not whitespace, or END if there is none
+            size_t find_not_space_scalar(const char *P, size_t begin, const size_t END) {
+                for(; begin < END && is_space(P[begin]); begin++);
+                return begin;
+            }
+
+            /// @brief One past the index of the last byte before END that is not whitespace, or BEGIN if there is none
+            size_t rfind_not_space_scalar(const char *P, const size_t BEGIN, size_t end) {
+                for(; end > BEGIN && is_space(P[end - 1]); end--);
+                return end;
+            }
+
+            /// @brief Lowercases A-Z in place, like std::tolower in the "C" locale
+            void to_lower_scalar(char *p, size_t begin, const size_t END) {
+                for(; begin < END; begin++) {
+                    if(p[begin] >= 'A' && p[begin] <= 'Z') {
+                        p[begin] += 'a' - 'A';
+                    }
+                }
+            }
+
+#ifdef STRINGLIB_X86
+            /// @brief Mask of the bytes of BYTES that are whitespace: ' ', or '\\t' through '\\r' (which are at most 4 above '\\t' as unsigned bytes)
+            __m128i space_mask_sse2(const __m128i BYTES) {
+                const __m128i OFFSET = _mm_sub_epi8(BYTES, _mm_set1_epi8('\t'));
+                return _mm_or_si128(_mm_cmpeq_epi8(BYTES, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(_mm_min_epu8(OFFSET, _mm_set1_epi8(4)), OFFSET));
+            }
+
+            void encode_sse2(const char *P, size_t begin, const size_t END, std::string &out) {
+                const __m128i PERCENT = _mm_set1_epi8('%'), EQUALS = _mm_set1_epi8('='), SEMICOLON = _mm_set1_epi8(';');
+                size_t done = begin;
+                for(; begin + 16 <= END; begin += 16) {
+                    const __m128i BYTES = _mm_loadu_si128(reinterpret_cast<const __m128i*>(P + begin));
+                    // Each set bit is a byte to replace, so blocks without any cost one compare
+                    for(unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(BYTES, PERCENT), _mm_cmpeq_epi8(BYTES, EQUALS)), _mm_cmpeq_epi8(BYTES, SEMICOLON))); mask != 0; mask &= mask - 1) {
+                        const size_t INDEX = begin + __builtin_ctz(mask);
+                        out.append(P + done, INDEX - done).append(encoding_of(P[INDEX]), 3);
+                        done = INDEX + 1;
+                    }
+                }
+                out.append(P + done, begin - done);
+                encode_scalar(P, begin, END, out);
+            }
+
+            size_t find_not_space_sse2(const char *P, size_t begin, const size_t END) {
+                for(; begin + 16 <= END; begin += 16) {
+                    const unsigned MASK = ~_mm_movemask_epi8(space_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(P + begin)))) & 0xFFFFu;
+                    if(MASK != 0) {
+                        return begin + __builtin_ctz(MASK);
+                    }
+                }
+                return find_not_space_scalar(P, begin, END);
+            }
+
+            size_t rfind_not_space_sse2(const char *P, const size_t BEGIN, size_t end) {
+                for(; end >= BEGIN + 16; end -= 16) {
+                    const unsigned MASK = ~_mm_movemask_epi8(space_mask_sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(P + end - 16)))) & 0xFFFFu;
+                    if(MASK != 0) {
+                        return end - 16 + (32 - __builtin_clz(MASK));
+                    }
+                }
+                return rfind_not_space_scalar(P, BEGIN, end);
+            }
+
+            void to_lower_sse2(char *p, size_t begin, const size_t END) {
+                for(; begin + 16 <= END; begin += 16) {
+                    __m128i* const P_BLOCK = reinterpret_cast<__m128i*>(p + begin);
+                    const __m128i BYTES = _mm_loadu_si128(P_BLOCK), OFFSET = _mm_sub_epi8(BYTES, _mm_set1_epi8('A'));
+                    const __m128i UPPER = _mm_cmpeq_epi8(_mm_min_epu8(OFFSET, _mm_set1_epi8('Z' - 'A')), OFFSET);
+                    _mm_storeu_si128(P_BLOCK, _mm_add_epi8(BYTES, _mm_and_si128(UPPER, _mm_set1_epi8('a' - 'A'))));
+                }
+                to_lower_scalar(p, begin, END);
+            }
+
+            __attribute__((target("avx2"))) __m256i space_mask_avx2(const __m256i BYTES) {
+                const __m256i OFFSET = _mm256_sub_epi8(BYTES, _mm256_set1_epi8('\t'));
+                return _mm256_or_si256(_mm256_cmpeq_epi8(BYTES, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(_mm256_min_epu8(OFFSET, _mm256_set1_epi8(4)), OFFSET));
+            }
+
+            __attribute__((target("avx2"))) void encode_avx2(const char *P, size_t begin, const size_t END, std::string &out) {
+                const __m256i PERCENT = _mm256_set1_epi8('%'), EQUALS = _mm256_set1_epi8('='), SEMICOLON = _mm256_set1_epi8(';');
+                size_t done = begin;
+                for(; begin + 32 <= END; begin += 32) {
+                    const __m256i BYTES = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(P + begin));
+                    for(unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(BYTES, PERCENT), _mm256_cmpeq_epi8(BYTES, EQUALS)), _mm256_cmpeq_epi8(BYTES, SEMICOLON))); mask != 0; mask &= mask - 1) {
+                        const size_t INDEX = begin + __builtin_ctz(mask);
+                        out.append(P + done, INDEX - done).append(encoding_of(P[INDEX]), 3);
+                        done = INDEX + 1;
+                    }
+                }
+                out.append(P + done, begin - done);
+                encode_sse2(P, begin, END, out);
+            }
+
+            __attribute__((target("avx2"))) size_t find_not_space_avx2(const char *P, size_t begin, const size_t END) {
+                for(; begin + 32 <= END; begin += 32) {
+                    const unsigned MASK = ~(unsigned)_mm256_movemask_epi8(space_mask_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(P + begin))));
+                    if(MASK != 0) {
+                        return begin + __builtin_ctz(MASK);
+                    }
+                }
+                return find_not_space_sse2(P, begin, END);
+            }
+
+            __attribute__((target("avx2"))) size_t rfind_not_space_avx2(const char *P, const size_t BEGIN, size_t end) {
+                for(; end >= BEGIN + 32; end -= 32) {
+                    const unsigned MASK = ~(unsigned)_mm256_movemask_epi8(space_mask_avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(P + end - 32))));
+                    if(MASK != 0) {
+                        return end - 32 + (32 - __builtin_clz(MASK));
+                    }
+                }
+                return rfind_not_space_sse2(P, BEGIN, end);
+            }
+
+            __attribute__((target("avx2"))) void to_lower_avx2(char *p, size_t begin, const size_t END) {
+                for(; begin + 32 <= END; begin += 32) {
+                    __m256i* const P_BLOCK = reinterpret_cast<__m256i*>(p + begin);
+                    const __m256i BYTES = _mm256_loadu_si256(P_BLOCK), OFFSET = _mm256_sub_epi8(BYTES, _mm256_set1_epi8('A'));
+                    const __m256i UPPER = _mm256_cmpeq_epi8(_mm256_min_epu8(OFFSET, _mm256_set1_epi8('Z' - 'A')), OFFSET);
+                    _mm256_storeu_si256(P_BLOCK, _mm256_add_epi8(BYTES, _mm256_and_si256(UPPER, _mm256_set1_epi8('a' - 'A'))));
+                }
+                to_lower_sse2(p, begin, END);
+            }
+#endif
+
+            /// @brief The widest version of each kernel this CPU supports
+            struct Kernels {
+                void (*encode)(const char*, size_t, size_t, std::string&) = encode_scalar;
+                size_t (*findNotSpace)(const char*, size_t, size_t) = find_not_space_scalar;
+                size_t (*rfindNotSpace)(const char*, size_t, size_t) = rfind_not_space_scalar;
+                void (*toLower)(char*, size_t, size_t) = to_lower_scalar;
+            };
+
+            /// @brief Picks the kernels on first use (SSE2 is part of every x86-64 CPU, AVX2 is checked at runtime)
+            const Kernels& kernels() {
+                static const Kernels KERNELS = [] {
+                    Kernels result;
+#ifdef STRINGLIB_X86
+                    result = {encode_sse2, find_not_space_sse2, rfind_not_space_sse2, to_lower_sse2};
+                    __builtin_cpu_init();
+                    if(__builtin_cpu_supports("avx2")) {
+                        result = {encode_avx2, find_not_space_avx2, rfind_not_space_avx2, to_lower_avx2};
+                    }
+#endif
+                    return result;
+                }();
+                return KERNELS;
+            }
+
+            /// @brief The first C in [P, END), or END if there is none. memchr is already vectorized and picked at runtime by the C library
+            const char* find_byte(const char *P, const char *END, const char C) {
+                const void* const P_FOUND = P == END ? nullptr : memchr(P, C, END - P);
+                return P_FOUND ? static_cast<const char*>(P_FOUND) : END;
+            }
+        }
+
         /**
          * @brief Returns a copy of the input with all instances of from replaced with to
          * 
@@ -15,12 +204,36 @@ namespace configstring {
          * @return std::string 
          */
         std::string str_replace(std::string text, const std::string FROM, const std::string TO) {
-            size_t start_pos = 0;
-            while((start_pos = text.find(FROM, start_pos)) != std::string::npos) {
-                text.replace(start_pos, FROM.length(), TO);
-                start_pos += TO.length();
+            std::string result;
+            str_replace(text, FROM, TO, result);
+            return result;
+        }
+
+        /**
+         * @brief Appends TEXT with all instances of FROM replaced with TO to out, in one pass. An empty FROM matches nothing
+         * 
+         * @param TEXT 
+         * @param FROM 
+         * @param TO 
+         * @param out 
+         */
+        void str_replace(const std::string_view TEXT, const std::string_view FROM, const std::string_view TO, std::string &out) {
+            if(FROM.empty()) {
+                out.append(TEXT);
+                return;
             }
-            return text;
+            out.reserve(out.length() + TEXT.length());
+            const char *p = TEXT.data(), *done = p;
+            const char* const END = p + TEXT.length();
+            while((p = find_byte(p, END, FROM[0])) != END && (size_t)(END - p) >= FROM.length()) {
+                if(memcmp(p, FROM.data(), FROM.length()) == 0) {
+                    out.append(done, p - done).append(TO.data(), TO.length());
+                    p = done = p + FROM.length();
+                } else {
+                    p++;
+                }
+            }
+            out.append(done, END - done);
         }
 
         /**
@@ -31,63 +244,95 @@ namespace configstring {
          * @return std::vector&lt;std::string&gt; 
          */
         std::vector<std::string> str_split(const std::string& TEXT, const char DELIMITER) {
-            std::vector<std::string> result;
-            std::stringstream stream(TEXT);
-            std::string tmp;
-
-            while (getline(stream, tmp, DELIMITER))
-                result.push_back(tmp);
+            const std::vector<std::string_view> VIEWS = str_split_view(TEXT, DELIMITER);
+            return std::vector<std::string>(VIEWS.begin(), VIEWS.end());
+        }
 
+        /**
+         * @brief Like str_split, but returns views into TEXT instead of copies
+         * 
+         * @param TEXT 
+         * @param DELIMITER 
+         * @return std::vector&lt;std::string_view&gt; 
+         */
+        std::vector<std::string_view> str_split_view(const std::string_view TEXT, const char DELIMITER) {
+            std::vector<std::string_view> result;
+            const char *p = TEXT.data();
+            const char* const END = p + TEXT.length();
+            while(p != END) {
+                const char* const P_PIECE_END = find_byte(p, END, DELIMITER);
+                result.emplace_back(p, P_PIECE_END - p);
+                p = P_PIECE_END == END ? END : P_PIECE_END + 1;
+            }
             return result;
         }
 
         /**
          * @brief Encodes "%" => "%25", "=" => "%3D", ";" => "%3B"
          * 
-         * @param TEXT
+         * @param TEXT 
          * @return std::string 
          */
         std::string minimal_encode(const std::string& TEXT) {
-            return str_replace(
-                str_replace(
-                    str_replace(
-                        TEXT, "%", "%25"
-                    ),
-                    "=", "%3D"
-                ),
-                ";", "%3B"
-            );
+            std::string result;
+            minimal_encode(TEXT, result);
+            return result;
+        }
+
+        /**
+         * @brief Appends TEXT encoded like minimal_encode to out
+         * 
+         * @param TEXT 
+         * @param out 
+         */
+        void minimal_encode(const std::string_view TEXT, std::string &out) {
+            out.reserve(out.length() + TEXT.length());
+            kernels().encode(TEXT.data(), 0, TEXT.length(), out);
         }
 
         /**
          * @brief Encodes "%3B" => ";", "=" => "%3D", "%25" => "%"
          * 
-         * @param TEXT
+         * @param TEXT 
          * @return std::string 
          */
         std::string minimal_decode(const std::string& TEXT) {
-            return str_replace(
-                str_replace(
-                    str_replace(
-                        TEXT, "%3B", ";"
-                    ),
-                    "%3D", "="
-                ),
-                "%25", "%"
-            );
+            std::string result;
+            minimal_decode(TEXT, result);
+            return result;
+        }
+
+        /**
+         * @brief Appends TEXT decoded like minimal_decode to out
+         * 
+         * @param TEXT 
+         * @param out 
+         */
+        void minimal_decode(const std::string_view TEXT, std::string &out) {
+            // Encoded sequences cannot overlap or produce each other, so one pass matches decoding each of them in turn
+            out.reserve(out.length() + TEXT.length());
+            const char *p = TEXT.data(), *done = p;
+            const char* const END = p + TEXT.length();
+            while((p = find_byte(p, END, '%')) != END && END - p > 2) {
+                const char DECODED = p[1] == '3' ? (p[2] == 'B' ? ';' : p[2] == 'D' ? '=' : '\0') : p[1] == '2' && p[2] == '5' ? '%' : '\0';
+                if(DECODED != '\0') {
+                    out.append(done, p - done).push_back(DECODED);
+                    p = done = p + 3;
+                } else {
+                    p++;
+                }
+            }
+            out.append(done, END - done);
         }
 
         /**
          * @brief Is the input empty ("") or only whitespace (\\n \\r \\t \\f \\v <space>)
          * 
          * @param TEXT 
-         * @return bool
+         * @return bool 
          */
-        bool str_is_empty(const std::string& TEXT) {
-            if(TEXT == "")
-                return true;
-            else
-                return !std::regex_search(TEXT, std::regex(R"(\S)", std::regex_constants::ECMAScript));
+        bool str_is_empty(const std::string_view TEXT) {
+            return kernels().findNotSpace(TEXT.data(), 0, TEXT.length()) == TEXT.length();
         }
 
         /**
@@ -97,10 +342,22 @@ namespace configstring {
          * @return std::string 
          */
         std::string str_to_lower(std::string text) {
-            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return std::tolower(c); });
+            kernels().toLower(&text[0], 0, text.length());
             return text;
         }
 
+        /**
+         * @brief Appends TEXT in lowercase to out
+         * 
+         * @param TEXT 
+         * @param out 
+         */
+        void str_to_lower(const std::string_view TEXT, std::string &out) {
+            const size_t START = out.length();
+            out.append(TEXT);
+            kernels().toLower(&out[0], START, out.length());
+        }
+
         /**
          * @brief Returns a copy of the input with leading and trailing whitespace removed (\\n \\r \\t \\f \\v <space>)
          * 
@@ -108,7 +365,20 @@ namespace configstring {
          * @return std::string 
          */
         std::string str_trim(std::string text) {
-            return std::regex_replace(std::regex_replace(text, std::regex(R"(^\s*)", std::regex_constants::ECMAScript), ""), std::regex(R"(\s*$)", std::regex_constants::ECMAScript), "");
+            const std::string_view TRIMMED = str_trim_view(text);
+            return text.substr(TRIMMED.data() - text.data(), TRIMMED.length());
+        }
+
+        /**
+         * @brief Returns a view of the input without leading and trailing whitespace (\\n \\r \\t \\f \\v <space>)
+         * 
+         * @param TEXT 
+         * @return std::string_view 
+         */
+        std::string_view str_trim_view(const std::string_view TEXT) {
+            const Kernels &KERNELS = kernels();
+            const size_t START = KERNELS.findNotSpace(TEXT.data(), 0, TEXT.length());
+            return TEXT.substr(START, KERNELS.rfindNotSpace(TEXT.data(), START, TEXT.length()) - START);
         }
     }
-}
\ No newline at end of file
+}
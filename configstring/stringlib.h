@@ -2,6 +2,7 @@
 #define STRINGLIB_H
 
 #include<string>
+#include <string_view>
 #include <vector>
 
 namespace configstring {
@@ -16,6 +17,16 @@ namespace configstring {
          */
         std::string str_replace(std::string text, const std::string FROM, const std::string TO);
 
+        /**
+         * @brief Appends TEXT with all instances of FROM replaced with TO to out, in one pass. An empty FROM matches nothing
+         * 
+         * @param TEXT 
+         * @param FROM 
+         * @param TO 
+         * @param out 
+         */
+        void str_replace(const std::string_view TEXT, const std::string_view FROM, const std::string_view TO, std::string &out);
+
         /**
          * @brief Returns a vector of the input text splits on all of the delimiter. Note, if the string ends with the delimiter, no empty entry is added.
          * 
@@ -25,6 +36,15 @@ namespace configstring {
          */
         std::vector<std::string> str_split(const std::string& TEXT, const char DELIMITER);
 
+        /**
+         * @brief Like str_split, but returns views into TEXT instead of copies
+         * 
+         * @param TEXT 
+         * @param DELIMITER 
+         * @return std::vector&lt;std::string_view&gt; 
+         */
+        std::vector<std::string_view> str_split_view(const std::string_view TEXT, const char DELIMITER);
+
         /**
          * @brief Encodes "%" => "%25", "=" => "%3D", ";" => "%3B"
          * 
@@ -33,6 +53,14 @@ namespace configstring {
          */
         std::string minimal_encode(const std::string& TEXT);
 
+        /**
+         * @brief Appends TEXT encoded like minimal_encode to out
+         * 
+         * @param TEXT
+         * @param out 
+         */
+        void minimal_encode(const std::string_view TEXT, std::string &out);
+
         /**
          * @brief Encodes "%3B" => ";", "=" => "%3D", "%25" => "%"
          * 
@@ -41,13 +69,21 @@ namespace configstring {
          */
         std::string minimal_decode(const std::string& TEXT);
 
+        /**
+         * @brief Appends TEXT decoded like minimal_decode to out
+         * 
+         * @param TEXT
+         * @param out 
+         */
+        void minimal_decode(const std::string_view TEXT, std::string &out);
+
         /**
          * @brief Is the input empty ("") or only whitespace (\\n \\r \\t \\f \\v <space>)
          * 
          * @param TEXT 
          * @return bool
          */
-        bool str_is_empty(const std::string& TEXT);
+        bool str_is_empty(const std::string_view TEXT);
 
         /**
          * @brief Returns a copy of the input text in lowercase
@@ -57,6 +93,14 @@ namespace configstring {
          */
         std::string str_to_lower(std::string text);
 
+        /**
+         * @brief Appends TEXT in lowercase to out
+         * 
+         * @param TEXT 
+         * @param out 
+         */
+        void str_to_lower(const std::string_view TEXT, std::string &out);
+
         /**
          * @brief Returns a copy of the input with leading and trailing whitespace removed (\\n \\r \\t \\f \\v <space>)
          * 
@@ -64,6 +108,14 @@ namespace configstring {
          * @return std::string 
          */
         std::string str_trim(std::string text);
+
+        /**
+         * @brief Returns a view of the input without leading and trailing whitespace (\\n \\r \\t \\f \\v <space>)
+         * 
+         * @param TEXT 
+         * @return std::string_view 
+         */
+        std::string_view str_trim_view(const std::string_view TEXT);
     }
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,598 @@
+#include "dependencies.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "filesystem.h"
+#include "commands.h"
+#include "console.hpp"
+#include "files.h"
+#include "formatting.h"
+#include "threadpool.h"
+
+using namespace std;
+using namespace console;
+
+namespace colors = formatting::colors::fg;
+namespace fs = FILESYSTEM_NAMESPACE;
+
+namespace dependencies {
+    namespace {
+        bool is_identifier_char(const char C) {
+            return (C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z') || (C >= '0' && C <= '9') || C == '_';
+        }
+
+        bool is_blank(const char C) {
+            return C == ' ' || C == '\t' || C == '\r' || C == '\f' || C == '\v';
+        }
+
+        /// @brief Identifies dependency cache files, followed by CACHE_VERSION
+        const char CACHE_MAGIC[8] = {'C','O','G','D','E','P','S','\0'};
+
+        /// @brief Bump whenever the layout written by save_cache changes
+        const uint32_t CACHE_VERSION = 2;
+
+        template<typename T>
+        void put(string &buffer, const T VALUE) {
+            buffer.append(reinterpret_cast<const char*>(&VALUE), sizeof(T));
+        }
+
+        template<typename T>
+        bool take(const string_view BUFFER, size_t &offset, T &value) {
+            if(BUFFER.length() - offset < sizeof(T)) {
+                return false;
+            }
+            memcpy(&value, BUFFER.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+    }
+
+    /// @brief Gets the target of every #include "..." directive in TEXT, skipping comments and string literals.
+    /// Targets of #include <...> directives are added to systemIncludes if given
+    std::vector<std::string> find_includes(const std::string_view TEXT, std::vector<std::string> *systemIncludes) {
+        vector<string> result;
+        const size_t LENGTH = TEXT.length();
+        const auto AT = [&TEXT, LENGTH](const size_t I) { return I < LENGTH ? TEXT[I] : '\0'; };
+
+        size_t i = 0;
+        bool lineStart = true;
+        while(i < LENGTH) {
+            const char C = TEXT[i];
+            if(C == '\n') {
+                lineStart = true;
+                i++;
+            } else if(is_blank(C)) {
+                i++;
+            } else if(C == '\\' && (AT(i + 1) == '\n' || (AT(i + 1) == '\r' && AT(i + 2) == '\n'))) {
+                // Line continuation
+                i += AT(i + 1) == '\n' ? 2 : 3;
+            } else if(C == '/' && AT(i + 1) == '/') {
+                while(i < LENGTH && TEXT[i] != '\n') {
+                    i += TEXT[i] == '\\' && AT(i + 1) == '\n' ? 2 : 1;
+                }
+            } else if(C == '/' && AT(i + 1) == '*') {
+                const size_t END = TEXT.find("*/", i + 2);
+                i = END == string::npos ? LENGTH : END + 2;
+            } else if(C == '#' && lineStart) {
+                lineStart = false;
+                i++;
+                while(is_blank(AT(i))) i++;
+                if(TEXT.compare(i, 7, "include") == 0 && !is_identifier_char(AT(i + 7))) {
+                    i += 7;
+                    while(is_blank(AT(i))) i++;
+                    if(AT(i) == '"') {
+                        const size_t START = ++i;
+                        while(i < LENGTH && TEXT[i] != '"' && TEXT[i] != '\n') i++;
+                        if(AT(i) == '"') {
+                            result.push_back(string(TEXT.substr(START, i - START)));
+                            i++;
+                        }
+                    } else if(AT(i) == '<' && systemIncludes) {
+                        const size_t START = ++i;
+                        while(i < LENGTH && TEXT[i] != '>' && TEXT[i] != '\n') i++;
+                        if(AT(i) == '>') {
+                            systemIncludes->push_back(string(TEXT.substr(START, i - START)));
+                            i++;
+                        }
+                    }
+                }
+            } else if(C == '"' || C == '\'') {
+                lineStart = false;
+                const bool RAW = C == '"' && i > 0 && TEXT[i - 1] == 'R' && (i < 2 || !is_identifier_char(TEXT[i - 2]) || TEXT[i - 2] == 'u' || TEXT[i - 2] == 'U' || TEXT[i - 2] == 'L' || TEXT[i - 2] == '8');
+                const size_t OPEN = RAW ? TEXT.find('(', i + 1) : string::npos;
+                if(OPEN != string::npos) {
+                    // R"delim( ... )delim"
+                    const string CLOSE = ")" + string(TEXT.substr(i + 1, OPEN - i - 1)) + "\"";
+                    const size_t END = TEXT.find(CLOSE, OPEN + 1);
+                    i = END == string::npos ? LENGTH : END + CLOSE.length();
+                } else {
+                    i++;
+                    while(i < LENGTH && TEXT[i] != C && TEXT[i] != '\n') {
+                        i += TEXT[i] == '\\' ? 2 : 1;
+                    }
+                    i++;
+                }
+            } else {
+                lineStart = false;
+                i++;
+            }
+        }
+        return result;
+    }
+
+    /// @brief Lexically normalizes PATH with / as the separator, dropping . segments and resolving .. where possible
+    std::string normalize_path(const std::string &PATH) {
+        const bool ABSOLUTE = !PATH.empty() && (PATH[0] == '/' || PATH[0] == '\\');
+        vector<string> segments;
+        size_t start = 0;
+        while(start <= PATH.length()) {
+            size_t end = PATH.find_first_of("/\\", start);
+            if(end == string::npos) end = PATH.length();
+            const string SEGMENT = PATH.substr(start, end - start);
+            if(SEGMENT == "..") {
+                if(!segments.empty() && segments.back() != "..") {
+                    segments.pop_back();
+                } else if(!ABSOLUTE) {
+                    segments.push_back(SEGMENT);
+                }
+            } else if(!SEGMENT.empty() && SEGMENT != ".") {
+                segments.push_back(SEGMENT);
+            }
+            start = end + 1;
+        }
+
+        string result = ABSOLUTE ? "/" : "";
+        for(size_t i = 0; i < segments.size(); i++) {
+            result += (i > 0 ? "/" : "") + segments[i];
+        }
+        return result.empty() ? "." : result;
+    }
+
+    /// @brief Resolves the target of #include "TARGET" against the directory of the file FROM that contains it
+    std::string resolve_include(const std::string &FROM, const std::string &TARGET) {
+        if(!TARGET.empty() && (TARGET[0] == '/' || TARGET[0] == '\\')) {
+            return normalize_path(TARGET);
+        }
+        const size_t SLASH = FROM.find_last_of("/\\");
+        return normalize_path(SLASH == string::npos ? TARGET : FROM.substr(0, SLASH + 1) + TARGET);
+    }
+
+    /// @brief Gets an #include "..." directive for FILE (relative to the project) that works in a file inside DIR.
+    /// The path is relative so the directive does not depend on where the project is checked out
+    std::string include_directive(const std::string &FILE, const std::string &DIR) {
+        const string PATH = normalize_path(fs::relative(fs::absolute(FILE), fs::absolute(DIR)).string());
+        return "#include \"" + commands::escape_quotes(PATH) + "\"\n";
+    }
+
+    /// @brief Finds the direct includes of PATH, reusing the cached ones if its stat is unchanged. Sets reread if the file had to be read
+    IncludeGraph::Node IncludeGraph::load(const std::string &PATH, bool &reread) const {
+        Node node;
+        node.state = Node::SCANNED;
+        node.stat = files::stat(PATH);
+        node.readable = node.stat.exists;
+        reread = false;
+
+        // mCache is not modified during a scan, so it can be read without locking
+        const auto CACHED = mCache.find(PATH);
+        if(node.readable && CACHED != mCache.end() && CACHED->second.readable && CACHED->second.stat == node.stat) {
+            node.includes = CACHED->second.includes;
+            node.systemIncludes = CACHED->second.systemIncludes;
+        } else if(node.readable) {
+            files::MappedFile text;
+            node.readable = files::try_read(PATH, text);
+            reread = true;
+            vector<string> systemIncludes;
+            for(const string &TARGET : find_includes(text.view(), &systemIncludes)) {
+                const string RESOLVED = resolve_include(PATH, TARGET);
+                if(find(node.includes.begin(), node.includes.end(), RESOLVED) == node.includes.end()) {
+                    node.includes.push_back(RESOLVED);
+                }
+            }
+            for(const string &TARGET : systemIncludes) {
+                if(find(node.systemIncludes.begin(), node.systemIncludes.end(), TARGET) == node.systemIncludes.end()) {
+                    node.systemIncludes.push_back(TARGET);
+                }
+            }
+        }
+        return node;
+    }
+
+    /// @brief Stores the scanned NODE for PATH, adding includes not seen before as unscanned. mMutex must be held
+    void IncludeGraph::store(const std::string &PATH, Node node, const bool REREAD) {
+        mDirty = mDirty || REREAD;
+        if(!node.readable) {
+            mUnreadable.push_back(PATH);
+        }
+        for(const string &INCLUDE : node.includes) {
+            mNodes.emplace(INCLUDE, Node());
+        }
+        mNodes[PATH] = move(node);
+    }
+
+    /// @brief Reads the prerequisites of the first rule in the make depfile NAME (as written by -MMD) into prerequisites, returning false if it cannot be read
+    bool read_depfile(const std::string NAME, std::vector<std::string> &prerequisites) {
+        files::MappedFile file;
+        if(!files::try_map(NAME, file)) {
+            return false;
+        }
+        const string_view TEXT = file.view();
+
+        prerequisites.clear();
+        string word;
+        bool inPrerequisites = false;
+        for(size_t i = 0; i < TEXT.length(); i++) {
+            const char C = TEXT[i];
+            if(C == '\\' && i + 1 < TEXT.length() && (TEXT[i + 1] == '\n' || TEXT[i + 1] == '\r')) {
+                // Line continuation
+                i += TEXT[i + 1] == '\r' ? 2 : 1;
+                if(!word.empty() && inPrerequisites) {
+                    prerequisites.push_back(word);
+                }
+                word.clear();
+            } else if(C == '\\' && i + 1 < TEXT.length() && (TEXT[i + 1] == ' ' || TEXT[i + 1] == '#')) {
+                word += TEXT[++i];
+            } else if(C == '$' && i + 1 < TEXT.length() && TEXT[i + 1] == '$') {
+                word += TEXT[++i];
+            } else if(C == ':' && !inPrerequisites && (i + 1 >= TEXT.length() || TEXT[i + 1] == ' ' || TEXT[i + 1] == '\n' || TEXT[i + 1] == '\r')) {
+                inPrerequisites = true;
+                word.clear();
+            } else if(C == ' ' || C == '\t' || C == '\n' || C == '\r') {
+                if(!word.empty() && inPrerequisites) {
+                    prerequisites.push_back(word);
+                }
+                word.clear();
+                if(C == '\n' && inPrerequisites) {
+                    return true;
+                }
+            } else {
+                word += C;
+            }
+        }
+        if(!word.empty() && inPrerequisites) {
+            prerequisites.push_back(word);
+        }
+        return true;
+    }
+
+    /// @brief Queues every file the current scan has not reached yet that is PATH or included by it on POOL if it is unscanned, following the
+    /// includes of files that are already scanned so files marked as changed anywhere below them are read again. mMutex must be held
+    void IncludeGraph::reach(threads::ThreadPool &pool, const std::string &PATH) {
+        vector<string> next;
+        if(mReached.insert(PATH).second) {
+            next.push_back(PATH);
+        }
+        while(!next.empty()) {
+            const string CURRENT = move(next.back());
+            next.pop_back();
+            Node &node = mNodes[CURRENT];
+            if(node.state == Node::UNSCANNED) {
+                node.state = Node::SCANNING;
+                pool.submit([this, &pool, CURRENT] { visit(pool, CURRENT); });
+            } else if(node.state == Node::SCANNED) {
+                for(const string &INCLUDE : node.includes) {
+                    if(mReached.insert(INCLUDE).second) {
+                        next.push_back(INCLUDE);
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief Reads and lexes PATH, then reaches its includes (see reach)
+    void IncludeGraph::visit(threads::ThreadPool &pool, const std::string PATH) {
+        bool reread;
+        Node node = load(PATH, reread);
+
+        lock_guard<mutex> lock(mMutex);
+        store(PATH, move(node), reread);
+        for(const string &INCLUDE : mNodes[PATH].includes) {
+            reach(pool, INCLUDE);
+        }
+    }
+
+    /// @brief Scans FILES and everything they include (directly or not) using THREADS threads (one per hardware thread if 0).
+    /// Files scanned before are only read again if they were marked as changed, but their includes are still followed
+    void IncludeGraph::scan(const std::vector<std::string> &FILES, const size_t THREADS) {
+        {
+            threads::ThreadPool pool(THREADS);
+            {
+                lock_guard<mutex> lock(mMutex);
+                mReached.clear();
+                for(const string &FILE : FILES) {
+                    reach(pool, normalize_path(FILE));
+                }
+            }
+            pool.wait_idle();
+        }
+        mReached.clear();
+
+        report_unreadable();
+    }
+
+    /// @brief Scans FILE and everything it includes in the calling thread (waiting on files other threads are scanning) and returns its closure.
+    /// newest is set to the latest modification time of FILE and every file in its closure
+    std::vector<std::string> IncludeGraph::require(const std::string &FILE, long long &newest) {
+        vector<string> result;
+        const string ROOT = normalize_path(FILE);
+        unordered_set<string> visited {ROOT};
+        queue<string> next;
+        next.push(ROOT);
+        newest = 0;
+
+        unique_lock<mutex> lock(mMutex);
+        while(!next.empty()) {
+            const string PATH = next.front();
+            next.pop();
+
+            if(mNodes[PATH].state == Node::UNSCANNED) {
+                mNodes[PATH].state = Node::SCANNING;
+                lock.unlock();
+                bool reread;
+                Node node = load(PATH, reread);
+                lock.lock();
+                // Anything discovered is scanned by whichever thread reaches it first
+                store(PATH, move(node), reread);
+                mScanned.notify_all();
+            }
+            mScanned.wait(lock, [this, &PATH] { return mNodes[PATH].state == Node::SCANNED; });
+
+            const Node &NODE = mNodes[PATH];
+            if(!NODE.readable) {
+                continue;
+            }
+            if(PATH != ROOT) {
+                result.push_back(PATH);
+            }
+            newest = max(newest, NODE.stat.mtime);
+            for(const string &INCLUDE : NODE.includes) {
+                if(visited.insert(INCLUDE).second) {
+                    next.push(INCLUDE);
+                }
+            }
+        }
+        return result;
+    }
+
+    /// @brief Prints a warning for every file that could not be opened since the last report
+    void IncludeGraph::report_unreadable() {
+        lock_guard<mutex> lock(mMutex);
+        sort(mUnreadable.begin(), mUnreadable.end());
+        for(const string &PATH : mUnreadable) {
+            eprintlnf("%sCould not access file %s%s", colors::YELLOW, PATH.c_str(), colors::REVERT);
+        }
+        mUnreadable.clear();
+    }
+
+    /// @brief Loads direct includes recorded by save_cache from NAME so unchanged files are not read again. A missing or invalid cache is ignored
+    void IncludeGraph::load_cache(const std::string NAME) {
+        files::MappedFile file;
+        if(!files::try_map(NAME, file)) {
+            return;
+        }
+        const string_view BUFFER = file.view();
+        if(BUFFER.length() < sizeof(CACHE_MAGIC) || memcmp(BUFFER.data(), CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+            return;
+        }
+
+        // Layout: magic, version, count, then count records of
+        // [path length, path, size, mtime, inode, include count, include indices..., system include count, (length, system include)...]
+        size_t offset = sizeof(CACHE_MAGIC);
+        uint32_t version = 0, count = 0;
+        if(!take(BUFFER, offset, version) || version != CACHE_VERSION || !take(BUFFER, offset, count)) {
+            return;
+        }
+
+        vector<string> paths;
+        vector<Node> nodes;
+        vector<vector<uint32_t>> indices;
+        for(uint32_t i = 0; i < count; i++) {
+            uint32_t length = 0, includeCount = 0;
+            Node node;
+            if(!take(BUFFER, offset, length) || BUFFER.length() - offset < length) {
+                return;
+            }
+            paths.push_back(string(BUFFER.substr(offset, length)));
+            offset += length;
+
+            uint64_t size = 0, inode = 0;
+            int64_t mtime = 0;
+            if(!take(BUFFER, offset, size) || !take(BUFFER, offset, mtime) || !take(BUFFER, offset, inode) || !take(BUFFER, offset, includeCount)) {
+                return;
+            }
+            node.readable = true;
+            node.stat.exists = true;
+            node.stat.size = size;
+            node.stat.mtime = mtime;
+            node.stat.inode = inode;
+
+            vector<uint32_t> includes(includeCount);
+            for(uint32_t &index : includes) {
+                if(!take(BUFFER, offset, index) || index >= count) {
+                    return;
+                }
+            }
+
+            uint32_t systemCount = 0;
+            if(!take(BUFFER, offset, systemCount)) {
+                return;
+            }
+            for(uint32_t j = 0; j < systemCount; j++) {
+                if(!take(BUFFER, offset, length) || BUFFER.length() - offset < length) {
+                    return;
+                }
+                node.systemIncludes.push_back(string(BUFFER.substr(offset, length)));
+                offset += length;
+            }
+            nodes.push_back(move(node));
+            indices.push_back(move(includes));
+        }
+
+        mCache.clear();
+        for(uint32_t i = 0; i < count; i++) {
+            for(const uint32_t INDEX : indices[i]) {
+                nodes[i].includes.push_back(paths[INDEX]);
+            }
+            mCache.emplace(paths[i], move(nodes[i]));
+        }
+        mDirty = false;
+    }
+
+    /// @brief Records the direct includes and stat of every scanned file in NAME (nothing is written if no file changed)
+    void IncludeGraph::save_cache(const std::string NAME) const {
+        // Only readable files are recorded, unreadable ones are checked again next time anyway
+        vector<string> paths;
+        for(const auto &[PATH, NODE] : mNodes) {
+            if(NODE.readable) {
+                paths.push_back(PATH);
+            }
+        }
+        if(!mDirty && paths.size() == mCache.size()) {
+            return;
+        }
+        sort(paths.begin(), paths.end());
+
+        unordered_map<string, uint32_t> indices;
+        for(uint32_t i = 0; i < paths.size(); i++) {
+            indices.emplace(paths[i], i);
+        }
+
+        string buffer(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+        put<uint32_t>(buffer, CACHE_VERSION);
+        put<uint32_t>(buffer, paths.size());
+        for(const string &PATH : paths) {
+            const Node &NODE = mNodes.at(PATH);
+            put<uint32_t>(buffer, PATH.length());
+            buffer += PATH;
+            put<uint64_t>(buffer, NODE.stat.size);
+            put<int64_t>(buffer, NODE.stat.mtime);
+            put<uint64_t>(buffer, NODE.stat.inode);
+
+            vector<uint32_t> includes;
+            for(const string &INCLUDE : NODE.includes) {
+                const auto ITER = indices.find(INCLUDE);
+                if(ITER != indices.end()) {
+                    includes.push_back(ITER->second);
+                }
+            }
+            put<uint32_t>(buffer, includes.size());
+            for(const uint32_t INDEX : includes) {
+                put<uint32_t>(buffer, INDEX);
+            }
+
+            put<uint32_t>(buffer, NODE.systemIncludes.size());
+            for(const string &INCLUDE : NODE.systemIncludes) {
+                put<uint32_t>(buffer, INCLUDE.length());
+                buffer += INCLUDE;
+            }
+        }
+
+        ofstream stream(NAME, ios::binary | ios::trunc);
+        if(stream.fail()) {
+            throw runtime_error(format("Error creating file \"%s\"", commands::escape_quotes(NAME).c_str()));
+        }
+        stream.write(buffer.data(), buffer.length());
+    }
+
+    /// @brief Every readable file FILE includes directly or indirectly, in breadth first order (FILE itself is not included)
+    std::vector<std::string> IncludeGraph::closure(const std::string &FILE) const {
+        vector<string> result;
+        const string ROOT = normalize_path(FILE);
+        unordered_set<string> visited {ROOT};
+        queue<string> next;
+        next.push(ROOT);
+
+        while(!next.empty()) {
+            const auto ITER = mNodes.find(next.front());
+            next.pop();
+            if(ITER == mNodes.end()) {
+                continue;
+            }
+            for(const string &INCLUDE : ITER->second.includes) {
+                if(visited.insert(INCLUDE).second) {
+                    const auto INCLUDED = mNodes.find(INCLUDE);
+                    if(INCLUDED != mNodes.end() && INCLUDED->second.readable) {
+                        result.push_back(INCLUDE);
+                        next.push(INCLUDE);
+                    }
+                }
+            }
+        }
+        return result;
+    }
+
+    /// @brief Every #include <...> target in FILE or any file in its closure, in breadth first order
+    std::vector<std::string> IncludeGraph::system_includes(const std::string &FILE) const {
+        vector<string> result;
+        unordered_set<string> seen;
+        vector<string> files = closure(FILE);
+        files.insert(files.begin(), normalize_path(FILE));
+        for(const string &PATH : files) {
+            const auto ITER = mNodes.find(PATH);
+            if(ITER == mNodes.end()) {
+                continue;
+            }
+            for(const string &INCLUDE : ITER->second.systemIncludes) {
+                if(seen.insert(INCLUDE).second) {
+                    result.push_back(INCLUDE);
+                }
+            }
+        }
+        return result;
+    }
+
+    /// @brief The number of files in the graph
+    size_t IncludeGraph::size() const {
+        return mNodes.size();
+    }
+
+    /// @brief Every file in the graph, including included files that could not be opened
+    std::vector<std::string> IncludeGraph::paths() const {
+        vector<string> result;
+        result.reserve(mNodes.size());
+        for(const auto &[PATH, NODE] : mNodes) {
+            result.push_back(PATH);
+        }
+        return result;
+    }
+
+    /// @brief Marks FILES as changed so the next scan or require reads them again (files not in the graph are ignored)
+    void IncludeGraph::invalidate(const std::vector<std::string> &FILES) {
+        lock_guard<mutex> lock(mMutex);
+        for(const string &FILE : FILES) {
+            const auto NODE = mNodes.find(normalize_path(FILE));
+            if(NODE != mNodes.end()) {
+                NODE->second.state = Node::UNSCANNED;
+            }
+        }
+    }
+
+    /// @brief Marks every file whose stat changed since it was scanned as changed (see invalidate), so a graph kept between builds stays correct
+    void IncludeGraph::refresh() {
+        lock_guard<mutex> lock(mMutex);
+        vector<string> paths;
+        vector<Node*> nodes;
+        for(auto &[PATH, node] : mNodes) {
+            if(node.state == Node::SCANNED) {
+                paths.push_back(PATH);
+                nodes.push_back(&node);
+            }
+        }
+        const vector<files::FileStat> STATS = files::stat_all(paths);
+        for(size_t i = 0; i < nodes.size(); i++) {
+            if(STATS[i] != nodes[i]->stat) {
+                nodes[i]->state = Node::UNSCANNED;
+            }
+        }
+    }
+}
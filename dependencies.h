@@ -0,0 +1,125 @@
+#ifndef DEPENDENCIES_H
+#define DEPENDENCIES_H
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "files.h"
+#include "threadpool.h"
+
+namespace dependencies {
+    /// @brief Gets the target of every #include "..." directive in TEXT, skipping comments and string literals.
+    /// Targets of #include <...> directives are added to systemIncludes if given
+    std::vector<std::string> find_includes(const std::string_view TEXT, std::vector<std::string> *systemIncludes = nullptr);
+
+    /// @brief Lexically normalizes PATH with / as the separator, dropping . segments and resolving .. where possible
+    std::string normalize_path(const std::string &PATH);
+
+    /// @brief Resolves the target of #include "TARGET" against the directory of the file FROM that contains it
+    std::string resolve_include(const std::string &FROM, const std::string &TARGET);
+
+    /// @brief Gets an #include "..." directive for FILE (relative to the project) that works in a file inside DIR.
+    /// The path is relative so the directive does not depend on where the project is checked out
+    std::string include_directive(const std::string &FILE, const std::string &DIR);
+
+    /// @brief Reads the prerequisites of the first rule in the make depfile NAME (as written by -MMD) into prerequisites, returning false if it cannot be read
+    bool read_depfile(const std::string NAME, std::vector<std::string> &prerequisites);
+
+    /// @brief The #include "..." graph of a set of source files. Every reachable file is read exactly once, no matter how many files include it
+    class IncludeGraph final {
+        private:
+            struct Node {
+                enum State {
+                    UNSCANNED, SCANNING, SCANNED
+                };
+                State state = State::UNSCANNED;
+
+                /// @brief False if the file could not be opened (it has no includes and is left out of closures)
+                bool readable = false;
+
+                /// @brief Stat of the file when its includes were found
+                files::FileStat stat;
+
+                /// @brief Normalized paths of the files this file includes, in the order they appear
+                std::vector<std::string> includes;
+
+                /// @brief Targets of the #include <...> directives in this file, in the order they appear (they are not followed)
+                std::vector<std::string> systemIncludes;
+            };
+
+            /// @brief Normalized path => node for every file seen so far
+            std::unordered_map<std::string, Node> mNodes;
+
+            /// @brief Nodes loaded by load_cache; reused during a scan if the file's stat is unchanged
+            std::unordered_map<std::string, Node> mCache;
+
+            /// @brief True if any file was (re)read since the cache was loaded
+            bool mDirty = false;
+
+            /// @brief Files that could not be opened during the last scan
+            std::vector<std::string> mUnreadable;
+
+            /// @brief Files the current scan has reached, so each is followed once even if it was scanned before
+            std::unordered_set<std::string> mReached;
+
+            /// @brief Guards mNodes, mDirty, mUnreadable, and mReached while scanning
+            std::mutex mMutex;
+
+            /// @brief Signaled when a node finishes scanning in require
+            std::condition_variable mScanned;
+
+            /// @brief Finds the direct includes of PATH, reusing the cached ones if its stat is unchanged. Sets reread if the file had to be read
+            Node load(const std::string &PATH, bool &reread) const;
+
+            /// @brief Stores the scanned NODE for PATH, adding includes not seen before as unscanned. mMutex must be held
+            void store(const std::string &PATH, Node node, const bool REREAD);
+
+            /// @brief Queues every file the current scan has not reached yet that is PATH or included by it on POOL if it is unscanned, following the
+            /// includes of files that are already scanned so files marked as changed anywhere below them are read again. mMutex must be held
+            void reach(threads::ThreadPool &pool, const std::string &PATH);
+
+            /// @brief Reads and lexes PATH, then reaches its includes (see reach)
+            void visit(threads::ThreadPool &pool, const std::string PATH);
+
+        public:
+            /// @brief Scans FILES and everything they include (directly or not) using THREADS threads (one per hardware thread if 0).
+            /// Files scanned before are only read again if they were marked as changed, but their includes are still followed
+            void scan(const std::vector<std::string> &FILES, const size_t THREADS = 0);
+
+            /// @brief Scans FILE and everything it includes in the calling thread (waiting on files other threads are scanning) and returns its closure.
+            /// newest is set to the latest modification time of FILE and every file in its closure
+            std::vector<std::string> require(const std::string &FILE, long long &newest);
+
+            /// @brief Prints a warning for every file that could not be opened since the last report
+            void report_unreadable();
+
+            /// @brief Loads direct includes recorded by save_cache from NAME so unchanged files are not read again. A missing or invalid cache is ignored
+            void load_cache(const std::string NAME);
+
+            /// @brief Records the direct includes and stat of every scanned file in NAME (nothing is written if no file changed)
+            void save_cache(const std::string NAME) const;
+
+            /// @brief Every readable file FILE includes directly or indirectly, in breadth first order (FILE itself is not included)
+            std::vector<std::string> closure(const std::string &FILE) const;
+
+            /// @brief Every #include <...> target in FILE or any file in its closure, in breadth first order
+            std::vector<std::string> system_includes(const std::string &FILE) const;
+
+            /// @brief The number of files in the graph
+            size_t size() const;
+
+            /// @brief Every file in the graph, including included files that could not be opened
+            std::vector<std::string> paths() const;
+
+            /// @brief Marks FILES as changed so the next scan or require reads them again (files not in the graph are ignored)
+            void invalidate(const std::vector<std::string> &FILES);
+
+            /// @brief Marks every file whose stat changed since it was scanned as changed (see invalidate), so a graph kept between builds stays correct
+            void refresh();
+    };
+}
+#endif
@@ -0,0 +1,175 @@
+#include "executor.h"
+
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "jobserver.h"
+#include "threadpool.h"
+
+using namespace std;
+
+namespace executor {
+    /// @brief Starts WORKERS worker threads (one per hardware thread if 0)
+    Scheduler::Scheduler(const size_t WORKERS) {
+        const size_t COUNT = WORKERS > 0 ? WORKERS : threads::default_concurrency();
+        mQueues.resize(COUNT);
+        for(size_t i = 0; i < COUNT; i++) {
+            mWorkers.emplace_back(&Scheduler::work, this, i);
+        }
+    }
+
+    /// @brief Loop run by worker INDEX
+    void Scheduler::work(const size_t INDEX) {
+        unique_lock<mutex> lock(mMutex);
+        while(true) {
+            size_t id;
+            while(!take(INDEX, id)) {
+                if(mSealed && mUnfinished == 0) {
+                    return;
+                }
+                mChanged.wait(lock);
+            }
+
+            if(mCancelled) {
+                finish(id, JobResult::CANCELLED, INDEX);
+                continue;
+            }
+
+            // Jobs live in a deque, so this reference survives other threads adding jobs
+            const Job &JOB = mJobs[id];
+            const bool FREE_SLOT = !mFreeSlotTaken;
+            mFreeSlotTaken = true;
+            lock.unlock();
+
+            const bool TOKEN = !FREE_SLOT && jobserver::acquire();
+            string output;
+            JobResult result;
+            try {
+                result = JOB.task(JOB.dependencyBuilt, output);
+            } catch(const exception &ERR) {
+                output += string(ERR.what()) + "\n";
+                result = JobResult::FAILED;
+            }
+            if(TOKEN) {
+                jobserver::release();
+            }
+
+            if(!output.empty()) {
+                lock_guard<mutex> outputLock(mOutputMutex);
+                cerr << output << flush;
+            }
+
+            lock.lock();
+            mFreeSlotTaken = mFreeSlotTaken && !FREE_SLOT;
+            finish(id, result, INDEX);
+        }
+    }
+
+    /// @brief Takes a ready job for worker INDEX from its own queue or another's. mMutex must be held
+    bool Scheduler::take(const size_t INDEX, size_t &job) {
+        if(!mQueues[INDEX].empty()) {
+            job = mQueues[INDEX].back();
+            mQueues[INDEX].pop_back();
+            return true;
+        }
+        for(size_t i = 1; i < mQueues.size(); i++) {
+            deque<size_t> &victim = mQueues[(INDEX + i) % mQueues.size()];
+            if(!victim.empty()) {
+                job = victim.front();
+                victim.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Queues JOB on worker INDEX's queue (or round robin if INDEX is out of range). mMutex must be held
+    void Scheduler::ready(const size_t JOB, const size_t INDEX) {
+        mQueues[INDEX < mQueues.size() ? INDEX : mNextQueue++ % mQueues.size()].push_back(JOB);
+        mChanged.notify_one();
+    }
+
+    /// @brief Records the result of JOB and readies or cancels its dependents. mMutex must be held
+    void Scheduler::finish(const size_t JOB, const JobResult RESULT, const size_t INDEX) {
+        Job &job = mJobs[JOB];
+        job.finished = true;
+        job.result = RESULT;
+        mUnfinished--;
+
+        // Dependents still get queued after a failure, they are marked cancelled when taken
+        if(RESULT == JobResult::FAILED) {
+            mCancelled = true;
+        }
+        for(const size_t DEPENDENT : job.dependents) {
+            Job &dependent = mJobs[DEPENDENT];
+            dependent.dependencyBuilt = dependent.dependencyBuilt || RESULT == JobResult::BUILT || RESULT == JobResult::FETCHED;
+            if(--dependent.waitingOn == 0) {
+                ready(DEPENDENT, INDEX);
+            }
+        }
+
+        if(mUnfinished == 0) {
+            mChanged.notify_all();
+        }
+    }
+
+    /// @brief Adds a job that runs once every job in DEPENDENCIES has finished and returns its id
+    size_t Scheduler::add(const std::string NAME, Task task, const std::vector<size_t> DEPENDENCIES) {
+        lock_guard<mutex> lock(mMutex);
+        const size_t ID = mJobs.size();
+        mJobs.emplace_back();
+        Job &job = mJobs.back();
+        job.name = NAME;
+        job.task = task;
+        mUnfinished++;
+
+        for(const size_t DEPENDENCY : DEPENDENCIES) {
+            Job &dependency = mJobs.at(DEPENDENCY);
+            if(dependency.finished) {
+                job.dependencyBuilt = job.dependencyBuilt || dependency.result == JobResult::BUILT || dependency.result == JobResult::FETCHED;
+            } else {
+                job.waitingOn++;
+                dependency.dependents.push_back(ID);
+            }
+        }
+
+        if(job.waitingOn == 0) {
+            ready(ID, mQueues.size());
+        }
+        return ID;
+    }
+
+    /// @brief Waits until every job has finished (no more jobs may be added after), returning true if none failed or were cancelled
+    bool Scheduler::wait() {
+        {
+            unique_lock<mutex> lock(mMutex);
+            mSealed = true;
+            mChanged.notify_all();
+            mChanged.wait(lock, [this] { return mUnfinished == 0; });
+        }
+        for(thread &worker : mWorkers) {
+            worker.join();
+        }
+        mWorkers.clear();
+        return !mCancelled;
+    }
+
+    /// @brief The result of job ID (only meaningful after wait)
+    JobResult Scheduler::result(const size_t ID) const {
+        return mJobs.at(ID).result;
+    }
+
+    Scheduler::~Scheduler() {
+        if(!mWorkers.empty()) {
+            {
+                lock_guard<mutex> lock(mMutex);
+                mCancelled = true;
+            }
+            wait();
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace executor {
+    enum JobResult {
+        /// @brief Nothing had to be done
+        UP_TO_DATE,
+        /// @brief The job produced new output
+        BUILT,
+        /// @brief The job's new output was taken from a cache rather than produced, which dependents treat like BUILT
+        FETCHED,
+        /// @brief The job failed, outstanding jobs are cancelled
+        FAILED,
+        /// @brief The job never ran because a dependency failed or another job failed first
+        CANCELLED
+    };
+
+    /// @brief The work done by a job. DEPENDENCY_BUILT is true if any job this depends on returned BUILT or FETCHED.
+    /// Diagnostics should be appended to output instead of printed so they are not interleaved with other jobs
+    typedef std::function<JobResult(const bool DEPENDENCY_BUILT, std::string &output)> Task;
+
+    /// @brief Runs a DAG of jobs on a pool of workers. Each worker keeps its own deque of ready jobs,
+    /// taking the newest from its own and stealing the oldest from others when it runs out. Under a jobserver (see jobserver.h),
+    /// every job besides one also waits for a token so processes sharing it stay within its budget.
+    /// Jobs may be added while the scheduler is running so work can start before the whole graph is known
+    class Scheduler final {
+        private:
+            struct Job {
+                std::string name;
+                Task task;
+                /// @brief Jobs waiting on this one
+                std::vector<size_t> dependents;
+                /// @brief Number of dependencies that have not finished yet
+                size_t waitingOn = 0;
+                bool finished = false;
+                bool dependencyBuilt = false;
+                JobResult result = JobResult::UP_TO_DATE;
+            };
+
+            std::deque<Job> mJobs;
+
+            /// @brief Ready jobs for each worker
+            std::vector<std::deque<size_t>> mQueues;
+
+            std::vector<std::thread> mWorkers;
+
+            /// @brief Guards all scheduler state. Jobs are processes that take far longer than any lock hold, so one lock is enough
+            std::mutex mMutex;
+
+            /// @brief Signaled when a job becomes ready or the last job finishes
+            std::condition_variable mChanged;
+
+            /// @brief Guards console output so each job's output is printed in one piece
+            std::mutex mOutputMutex;
+
+            size_t mUnfinished = 0;
+            /// @brief True while a job runs in the one slot this process has without a jobserver token (see jobserver::acquire)
+            bool mFreeSlotTaken = false;
+            size_t mNextQueue = 0;
+            bool mCancelled = false;
+            bool mSealed = false;
+
+            /// @brief Loop run by worker INDEX
+            void work(const size_t INDEX);
+
+            /// @brief Takes a ready job for worker INDEX from its own queue or another's. mMutex must be held
+            bool take(const size_t INDEX, size_t &job);
+
+            /// @brief Queues JOB on worker INDEX's queue (or round robin if INDEX is out of range). mMutex must be held
+            void ready(const size_t JOB, const size_t INDEX);
+
+            /// @brief Records the result of JOB and readies or cancels its dependents. mMutex must be held
+            void finish(const size_t JOB, const JobResult RESULT, const size_t INDEX);
+
+        public:
+            /// @brief Starts WORKERS worker threads (one per hardware thread if 0)
+            explicit Scheduler(const size_t WORKERS = 0);
+
+            /// @brief Adds a job that runs once every job in DEPENDENCIES has finished and returns its id
+            size_t add(const std::string NAME, Task task, const std::vector<size_t> DEPENDENCIES = std::vector<size_t>());
+
+            /// @brief Waits until every job has finished (no more jobs may be added after), returning true if none failed or were cancelled
+            bool wait();
+
+            /// @brief The result of job ID (only meaningful after wait)
+            JobResult result(const size_t ID) const;
+
+            Scheduler(const Scheduler&) = delete;
+            Scheduler& operator=(const Scheduler&) = delete;
+            ~Scheduler();
+    };
+}
+#endif
@@ -1,17 +1,72 @@
 #include "files.h"
 
+#include <algorithm>
 #include <fstream> 
+#include <functional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifndef WINDOWS
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "filesystem.h"
 #include "console.hpp"
 #include "commands.h"
+#include "threadpool.h"
 
 namespace fs = FILESYSTEM_NAMESPACE;
 using namespace std;
 using namespace console;
 
 namespace files {
+    namespace {
+        /// @brief Files at least this large are memory mapped, smaller ones are cheaper to read
+        const size_t MAP_THRESHOLD = 32 * 1024;
+
+        /// @brief Batches smaller than this are handled in the calling thread, where starting threads would cost more than it saves
+        const size_t PARALLEL_THRESHOLD = 64;
+
+        FileStat to_file_stat(const struct ::stat &INFO) {
+            FileStat result;
+            result.exists = true;
+            result.size = INFO.st_size;
+#ifdef __linux__
+            result.mtime = (long long)INFO.st_mtim.tv_sec * 1000000000LL + INFO.st_mtim.tv_nsec;
+#else
+            result.mtime = (long long)INFO.st_mtime * 1000000000LL;
+#endif
+            result.inode = INFO.st_ino;
+            return result;
+        }
+
+        /// @brief Calls WORK(begin, end) on contiguous ranges covering [0, COUNT), spread over up to THREADS threads
+        void for_ranges(const size_t COUNT, const size_t THREADS, const function<void(size_t, size_t)> &WORK) {
+            const size_t WORKERS = min(THREADS == 0 ? threads::default_concurrency() : THREADS, COUNT / PARALLEL_THRESHOLD);
+            if(WORKERS <= 1) {
+                WORK(0, COUNT);
+                return;
+            }
+            threads::ThreadPool pool(WORKERS);
+            for(size_t i = 0; i < WORKERS; i++) {
+                pool.submit([&WORK, COUNT, WORKERS, i] { WORK(COUNT * i / WORKERS, COUNT * (i + 1) / WORKERS); });
+            }
+            pool.wait_idle();
+        }
+    }
+
+    bool FileStat::operator==(const FileStat &OTHER) const {
+        return exists == OTHER.exists && size == OTHER.size && mtime == OTHER.mtime && inode == OTHER.inode;
+    }
+
+    bool FileStat::operator!=(const FileStat &OTHER) const {
+        return !(*this == OTHER);
+    }
+
     /// @brief Creates a directory named NAME if it does not exist already
     void mkdir(const std::string NAME) {
         if (!fs::is_directory(NAME) || !fs::exists(NAME)) {
@@ -29,17 +84,196 @@ namespace files {
         stream.close();
     }
     
+    /// @brief Writes TEXT to NAME unless NAME already holds exactly TEXT, so its modification time only changes with its contents. Returns true if written
+    bool fwrite_if_changed(const std::string NAME, const std::string TEXT) {
+        const FileStat STAT = stat(NAME);
+        if(STAT.exists && STAT.size == TEXT.length() && fread(NAME) == TEXT) {
+            return false;
+        }
+        fwrite(NAME, TEXT);
+        return true;
+    }
+
     /// @brief Opens a file, reads it in its entirety to a string, and closes the file
     std::string fread(const std::string NAME) {
-        ifstream stream(NAME);
+        return string(load(NAME).view());
+    }
+
+    /// @brief An empty file
+    MappedFile::MappedFile() {}
+
+    /// @brief The contents, valid while this MappedFile exists (and is not assigned to)
+    std::string_view MappedFile::view() const {
+        return mpMapping ? string_view(mpMapping, mMappedSize) : string_view(mBuffer);
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept: mpMapping(other.mpMapping), mMappedSize(other.mMappedSize), mBuffer(move(other.mBuffer)) {
+        other.mpMapping = nullptr;
+        other.mMappedSize = 0;
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile &&other) noexcept {
+        if(this != &other) {
+            release();
+            mpMapping = other.mpMapping;
+            mMappedSize = other.mMappedSize;
+            mBuffer = move(other.mBuffer);
+            other.mpMapping = nullptr;
+            other.mMappedSize = 0;
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        release();
+    }
+
+    /// @brief Unmaps the mapping if there is one (mBuffer is left alone)
+    void MappedFile::release() {
+#ifndef WINDOWS
+        if(mpMapping) {
+            munmap(const_cast<char*>(mpMapping), mMappedSize);
+        }
+#endif
+        mpMapping = nullptr;
+        mMappedSize = 0;
+    }
+
+    /// @brief Reads NAME into file (never mapping it), and sets *pStat to its stat if given, returning false (leaving file empty) if it is not a readable file.
+    /// Files the user or other tools may rewrite while cog runs are read this way, since a mapped file truncated in place raises SIGBUS when read
+    bool try_read(const std::string NAME, MappedFile &file, FileStat *pStat) {
+        file = MappedFile();
+        if(pStat) {
+            *pStat = FileStat();
+        }
+#ifdef WINDOWS
+        ifstream stream(NAME, ios::binary | ios::ate);
         if(stream.fail()) {
+            return false;
+        }
+        const streamoff SIZE = stream.tellg();
+        file.mBuffer.resize(SIZE > 0 ? (size_t)SIZE : 0);
+        stream.seekg(0);
+        stream.read(&file.mBuffer[0], file.mBuffer.size());
+        file.mBuffer.resize(stream.gcount());
+        if(pStat) {
+            *pStat = stat(NAME);
+        }
+        return true;
+#else
+        const int FD = ::open(NAME.c_str(), O_RDONLY | O_CLOEXEC);
+        if(FD < 0) {
+            return false;
+        }
+        struct ::stat info;
+        if(fstat(FD, &info) != 0 || !S_ISREG(info.st_mode)) {
+            close(FD);
+            return false;
+        }
+        if(pStat) {
+            *pStat = to_file_stat(info);
+        }
+
+        const size_t SIZE = info.st_size;
+        // One spare byte so a file that has not grown is read in a single read plus the one that finds its end
+        file.mBuffer.resize(SIZE + 1);
+        size_t done = 0;
+        while(true) {
+            if(done == file.mBuffer.size()) {
+                file.mBuffer.resize(file.mBuffer.size() * 2);
+            }
+            const ssize_t READ = ::read(FD, &file.mBuffer[done], file.mBuffer.size() - done);
+            if(READ < 0) {
+                close(FD);
+                file.mBuffer.clear();
+                if(pStat) {
+                    *pStat = FileStat();
+                }
+                return false;
+            } else if(READ == 0) {
+                break;
+            }
+            done += READ;
+        }
+        close(FD);
+        file.mBuffer.resize(done);
+        return true;
+#endif
+    }
+
+    /// @brief Maps NAME into file if it is large, otherwise reads it (see try_read). Only for files cog writes itself, like the caches in the build
+    /// directory, which nothing truncates while they are read
+    bool try_map(const std::string NAME, MappedFile &file, FileStat *pStat) {
+        file = MappedFile();
+#ifndef WINDOWS
+        const int FD = ::open(NAME.c_str(), O_RDONLY | O_CLOEXEC);
+        if(FD < 0) {
+            if(pStat) {
+                *pStat = FileStat();
+            }
+            return false;
+        }
+        struct ::stat info;
+        if(fstat(FD, &info) == 0 && S_ISREG(info.st_mode) && (size_t)info.st_size >= MAP_THRESHOLD) {
+            void* const P_MAPPING = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, FD, 0);
+            if(P_MAPPING != MAP_FAILED) {
+                // Files are read front to back, so read ahead aggressively and start now
+                madvise(P_MAPPING, info.st_size, MADV_SEQUENTIAL);
+                madvise(P_MAPPING, info.st_size, MADV_WILLNEED);
+                close(FD);
+                file.mpMapping = static_cast<const char*>(P_MAPPING);
+                file.mMappedSize = info.st_size;
+                if(pStat) {
+                    *pStat = to_file_stat(info);
+                }
+                return true;
+            }
+        }
+        close(FD);
+#endif
+        return try_read(NAME, file, pStat);
+    }
+
+    /// @brief Reads NAME (see try_read). Throws like fread if it cannot be read
+    MappedFile load(const std::string NAME) {
+        MappedFile file;
+        if(!try_read(NAME, file)) {
             throw runtime_error(format("Error reading file \"%s\"", commands::escape_quotes(NAME).c_str()));
         }
-        stringstream buffer;
-        buffer << stream.rdbuf();
-        stream.close();
+        return file;
+    }
+
+    /// @brief Stats every path in NAMES using up to THREADS threads (one per hardware thread if 0), so the latency of many stats overlaps
+    std::vector<FileStat> stat_all(const std::vector<std::string> &NAMES, const size_t THREADS) {
+        vector<FileStat> result(NAMES.size());
+        for_ranges(NAMES.size(), THREADS, [&NAMES, &result](const size_t BEGIN, const size_t END) {
+            for(size_t i = BEGIN; i < END; i++) {
+                result[i] = stat(NAMES[i]);
+            }
+        });
+        return result;
+    }
 
-        return buffer.str();
+    /// @brief Stats and reads every path in NAMES (see try_read) using up to THREADS threads (one per hardware thread if 0), so the latency of many reads overlaps.
+    /// Paths that cannot be read have a FileStat that does not exist and an empty MappedFile
+    void read_all(const std::vector<std::string> &NAMES, std::vector<FileStat> &stats, std::vector<MappedFile> &contents, const size_t THREADS) {
+        stats.assign(NAMES.size(), FileStat());
+        contents.clear();
+        contents.resize(NAMES.size());
+        for_ranges(NAMES.size(), THREADS, [&NAMES, &stats, &contents](const size_t BEGIN, const size_t END) {
+            for(size_t i = BEGIN; i < END; i++) {
+                try_read(NAMES[i], contents[i], &stats[i]);
+            }
+        });
+    }
+
+    /// @brief Gets the size, modification time, and inode of NAME (exists is false if it cannot be accessed)
+    FileStat stat(const std::string NAME) {
+        struct ::stat info;
+        if(::stat(NAME.c_str(), &info) != 0) {
+            return FileStat();
+        }
+        return to_file_stat(info);
     }
 
     /// @brief Returns true if NAME exists and is a file, false otherwise
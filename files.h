@@ -1,17 +1,85 @@
 #ifndef FILES_H
 #define FILES_H
+#include <cstddef>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace files {
+    /// @brief Size, modification time, and identity of a file; enough to tell if it changed without reading it
+    struct FileStat {
+        bool exists = false;
+        unsigned long long size = 0;
+        /// @brief Modification time in nanoseconds (only second precision on some platforms)
+        long long mtime = 0;
+        /// @brief Inode number (0 on platforms without them)
+        unsigned long long inode = 0;
+
+        bool operator==(const FileStat &OTHER) const;
+        bool operator!=(const FileStat &OTHER) const;
+    };
+
     /// @brief Creates a directory named NAME if it does not exist already
     void mkdir(const std::string NAME);
 
     /// @brief Opens a file, writes to it, and closes the file
     void fwrite(const std::string NAME, const std::string TEXT);
     
+    /// @brief Writes TEXT to NAME unless NAME already holds exactly TEXT, so its modification time only changes with its contents. Returns true if written
+    bool fwrite_if_changed(const std::string NAME, const std::string TEXT);
+
     /// @brief Opens a file, reads it in its entirety to a string, and closes the file
     std::string fread(const std::string NAME);
 
+    /// @brief The read-only contents of a whole file: memory mapped if it is large and try_map was used, otherwise read into memory with a single read
+    class MappedFile final {
+        private:
+            /// @brief The mapping, or nullptr if the file was read into mBuffer
+            const char* mpMapping = nullptr;
+            size_t mMappedSize = 0;
+            std::string mBuffer;
+
+            friend bool try_read(const std::string NAME, MappedFile &file, FileStat *pStat);
+            friend bool try_map(const std::string NAME, MappedFile &file, FileStat *pStat);
+
+            /// @brief Unmaps the mapping if there is one (mBuffer is left alone)
+            void release();
+
+        public:
+            /// @brief An empty file
+            MappedFile();
+
+            /// @brief The contents, valid while this MappedFile exists (and is not assigned to)
+            std::string_view view() const;
+
+            MappedFile(MappedFile &&other) noexcept;
+            MappedFile& operator=(MappedFile &&other) noexcept;
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+            ~MappedFile();
+    };
+
+    /// @brief Reads NAME into file (never mapping it), and sets *pStat to its stat if given, returning false (leaving file empty) if it is not a readable file.
+    /// Files the user or other tools may rewrite while cog runs are read this way, since a mapped file truncated in place raises SIGBUS when read
+    bool try_read(const std::string NAME, MappedFile &file, FileStat *pStat = nullptr);
+
+    /// @brief Maps NAME into file if it is large, otherwise reads it (see try_read). Only for files cog writes itself, like the caches in the build
+    /// directory, which nothing truncates while they are read
+    bool try_map(const std::string NAME, MappedFile &file, FileStat *pStat = nullptr);
+
+    /// @brief Reads NAME (see try_read). Throws like fread if it cannot be read
+    MappedFile load(const std::string NAME);
+
+    /// @brief Stats every path in NAMES using up to THREADS threads (one per hardware thread if 0), so the latency of many stats overlaps
+    std::vector<FileStat> stat_all(const std::vector<std::string> &NAMES, const size_t THREADS = 0);
+
+    /// @brief Stats and reads every path in NAMES (see try_read) using up to THREADS threads (one per hardware thread if 0), so the latency of many reads overlaps.
+    /// Paths that cannot be read have a FileStat that does not exist and an empty MappedFile
+    void read_all(const std::vector<std::string> &NAMES, std::vector<FileStat> &stats, std::vector<MappedFile> &contents, const size_t THREADS = 0);
+
+    /// @brief Gets the size, modification time, and inode of NAME (exists is false if it cannot be accessed)
+    FileStat stat(const std::string NAME);
+
     /// @brief Returns true if NAME exists and is a file, false otherwise
     bool fexists(const std::string NAME);
 
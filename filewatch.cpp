@@ -0,0 +1,174 @@
+#include "filewatch.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "filesystem.h"
+#include "dependencies.h"
+
+namespace fs = FILESYSTEM_NAMESPACE;
+using namespace std;
+
+namespace filewatch {
+    namespace {
+        /// @brief Normalized path of NAME inside directory DIR
+        string join(const string &DIR, const string &NAME) {
+            return dependencies::normalize_path(DIR == "." ? NAME : DIR + "/" + NAME);
+        }
+
+        /// @brief True if PATH is DIR or inside it
+        bool is_within(const string &PATH, const string &DIR) {
+            return PATH == DIR || (PATH.length() > DIR.length() && PATH.compare(0, DIR.length(), DIR) == 0 && PATH[DIR.length()] == '/');
+        }
+    }
+
+    /// @brief Throws if watching files is not supported on this platform
+    Watcher::Watcher() {
+#ifdef __linux__
+        mFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if(mFd < 0) {
+            throw runtime_error("Cannot watch for changes (inotify is unavailable)");
+        }
+#else
+        throw runtime_error("Watching for changes is only supported on Linux");
+#endif
+    }
+
+    Watcher::~Watcher() {
+#ifdef __linux__
+        if(mFd >= 0) {
+            close(mFd);
+        }
+#endif
+    }
+
+    /// @brief Watches directory NAME and returns false if it cannot be watched
+    bool Watcher::add_dir(const std::string &NAME) {
+#ifdef __linux__
+        const int WD = inotify_add_watch(mFd, NAME.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_ONLYDIR);
+        if(WD < 0) {
+            return false;
+        }
+        mDirs[WD] = NAME;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// @brief Watches DIR and every directory under it, including ones created later (a missing DIR is ignored)
+    void Watcher::add_tree(const std::string DIR) {
+        const string PATH = dependencies::normalize_path(DIR);
+        if(!fs::is_directory(PATH) || !add_dir(PATH)) {
+            return;
+        }
+        if(find(mTrees.begin(), mTrees.end(), PATH) == mTrees.end()) {
+            mTrees.push_back(PATH);
+        }
+
+        error_code error;
+        for(auto it = fs::recursive_directory_iterator(PATH, error); !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+            if(it->is_directory()) {
+                add_dir(dependencies::normalize_path(it->path().string()));
+            }
+        }
+    }
+
+    /// @brief Watches the file NAME, even if it is replaced or does not exist yet
+    void Watcher::add_file(const std::string NAME) {
+        const string PATH = dependencies::normalize_path(NAME);
+        const string PARENT = fs::path(PATH).parent_path().string();
+        // Editors often save by replacing the file, which would end a watch on the file itself, so its directory is watched instead
+        add_dir(PARENT.empty() ? "." : PARENT);
+        mFiles.push_back(PATH);
+    }
+
+    /// @brief Reads pending events and adds the changed paths to changed. Returns false if no events arrived within TIMEOUT_MS (-1 to wait forever)
+    bool Watcher::read_events(const int TIMEOUT_MS, std::vector<std::string> &changed) {
+#ifdef __linux__
+        pollfd request = {mFd, POLLIN, 0};
+        if(poll(&request, 1, TIMEOUT_MS) <= 0) {
+            return false;
+        }
+
+        alignas(inotify_event) char buffer[16 * 1024];
+        ssize_t length;
+        while((length = read(mFd, buffer, sizeof(buffer))) > 0) {
+            for(ssize_t i = 0; i < length; i += sizeof(inotify_event) + ((inotify_event*)(buffer + i))->len) {
+                const inotify_event *EVENT = (inotify_event*)(buffer + i);
+                if(EVENT->mask & IN_Q_OVERFLOW) {
+                    // Events were lost, so every tree and file counts as changed, and directories created meanwhile are watched now
+                    const vector<string> TREES = mTrees;
+                    for(const string &TREE : TREES) {
+                        add_tree(TREE);
+                        changed.push_back(TREE);
+                    }
+                    changed.insert(changed.end(), mFiles.begin(), mFiles.end());
+                    continue;
+                }
+                const auto DIR = mDirs.find(EVENT->wd);
+                if(EVENT->mask & IN_IGNORED) {
+                    mDirs.erase(EVENT->wd);
+                    continue;
+                }
+                if(DIR == mDirs.end() || EVENT->len == 0) {
+                    continue;
+                }
+
+                const string PATH = join(DIR->second, EVENT->name);
+                const bool IN_TREE = any_of(mTrees.begin(), mTrees.end(), [&PATH](const string &TREE) { return is_within(PATH, TREE); });
+                if(!IN_TREE && find(mFiles.begin(), mFiles.end(), PATH) == mFiles.end()) {
+                    continue;
+                }
+                if(IN_TREE && (EVENT->mask & IN_ISDIR) && (EVENT->mask & (IN_CREATE | IN_MOVED_TO))) {
+                    // Files may already be in the new directory by the time it is watched, so they count as changed too
+                    add_dir(PATH);
+                    error_code error;
+                    for(auto it = fs::recursive_directory_iterator(PATH, error); !error && it != fs::recursive_directory_iterator(); it.increment(error)) {
+                        const string CHILD = dependencies::normalize_path(it->path().string());
+                        if(it->is_directory()) {
+                            add_dir(CHILD);
+                        } else {
+                            changed.push_back(CHILD);
+                        }
+                    }
+                }
+                changed.push_back(PATH);
+            }
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /// @brief Waits up to TIMEOUT_MS (-1 to wait forever) for a change, then keeps collecting changes until none arrive for DEBOUNCE_MS.
+    /// Returns the changed paths (normalized, sorted, and unique), or nothing on timeout. If events were lost, every watched tree and file is returned
+    std::vector<std::string> Watcher::wait(const int DEBOUNCE_MS, const int TIMEOUT_MS) {
+        vector<string> changed;
+        // Events for files nobody asked about (like other files next to a watched file) do not count
+        while(changed.empty()) {
+            if(!read_events(TIMEOUT_MS, changed)) {
+                return changed;
+            }
+        }
+        // Saving a file or checking out a branch arrives as a burst of events, which should cause one rebuild
+        size_t count;
+        do {
+            count = changed.size();
+        } while(read_events(DEBOUNCE_MS, changed) && changed.size() > count);
+
+        sort(changed.begin(), changed.end());
+        changed.erase(unique(changed.begin(), changed.end()), changed.end());
+        return changed;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef FILEWATCH_H
+#define FILEWATCH_H
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace filewatch {
+    /// @brief Watches directory trees and single files for changes (inotify, so only supported on Linux)
+    class Watcher final {
+        private:
+            /// @brief inotify descriptor, or -1 if unsupported
+            int mFd = -1;
+
+            /// @brief Watch descriptor => normalized path of the watched directory
+            std::unordered_map<int, std::string> mDirs;
+
+            /// @brief Directories added with add_tree, whose new subdirectories are watched too
+            std::vector<std::string> mTrees;
+
+            /// @brief Normalized paths of files added with add_file (their parent directories are watched)
+            std::vector<std::string> mFiles;
+
+            /// @brief Watches directory NAME and returns false if it cannot be watched
+            bool add_dir(const std::string &NAME);
+
+            /// @brief Reads pending events and adds the changed paths to changed. Returns false if no events arrived within TIMEOUT_MS (-1 to wait forever)
+            bool read_events(const int TIMEOUT_MS, std::vector<std::string> &changed);
+
+        public:
+            /// @brief Throws if watching files is not supported on this platform
+            Watcher();
+
+            /// @brief Watches DIR and every directory under it, including ones created later (a missing DIR is ignored)
+            void add_tree(const std::string DIR);
+
+            /// @brief Watches the file NAME, even if it is replaced or does not exist yet
+            void add_file(const std::string NAME);
+
+            /// @brief Waits up to TIMEOUT_MS (-1 to wait forever) for a change, then keeps collecting changes until none arrive for DEBOUNCE_MS.
+            /// Returns the changed paths (normalized, sorted, and unique), or nothing on timeout. If events were lost, every watched tree and file is returned
+            std::vector<std::string> wait(const int DEBOUNCE_MS, const int TIMEOUT_MS = -1);
+
+            Watcher(const Watcher&) = delete;
+            Watcher& operator=(const Watcher&) = delete;
+            ~Watcher();
+    };
+}
+#endif
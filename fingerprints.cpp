@@ -0,0 +1,218 @@
+#include "fingerprints.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hashing.h"
+
+using namespace std;
+
+namespace fingerprints {
+    /// @brief Digest of running PROGRAM with ARGS, which changes whenever anything affecting the output of the command does
+    std::string of(const std::string &PROGRAM, const std::vector<std::string> &ARGS) {
+        hashing::Hasher hasher;
+        hasher.add(PROGRAM);
+        for(const string &ARG : ARGS) {
+            hasher.add(ARG);
+        }
+        return hasher.digest();
+    }
+
+    /// @brief Loads fingerprints recorded by save from NAME. A missing or invalid file is ignored
+    void CommandLog::load(const std::string &NAME) {
+        // One "<digest> <output>" pair per line, or "- <output>" appended by forget
+        files::MappedFile file;
+        lock_guard<mutex> lock(mMutex);
+        if(!files::try_map(NAME, file)) {
+            return;
+        }
+        const string_view TEXT = file.view();
+        for(size_t start = 0; start < TEXT.length();) {
+            const size_t END = min(TEXT.find('\n', start), TEXT.length());
+            const string_view LINE = TEXT.substr(start, END - start);
+            const size_t SPACE = LINE.find(' ');
+            if(SPACE == string_view::npos || SPACE == 0 || SPACE + 1 == LINE.length()) {
+                mDigests.clear();
+                return;
+            }
+            if(LINE.substr(0, SPACE) == "-") {
+                mDigests.erase(string(LINE.substr(SPACE + 1)));
+            } else {
+                mDigests[string(LINE.substr(SPACE + 1))] = string(LINE.substr(0, SPACE));
+            }
+            start = END + 1;
+        }
+    }
+
+    /// @brief Writes the fingerprints to NAME if any changed
+    void CommandLog::save(const std::string &NAME) const {
+        lock_guard<mutex> lock(mMutex);
+        if(!mDirty) {
+            return;
+        }
+
+        vector<pair<string, string>> entries(mDigests.begin(), mDigests.end());
+        sort(entries.begin(), entries.end());
+        string text;
+        for(const auto &[OUTPUT, DIGEST] : entries) {
+            text += DIGEST + " " + OUTPUT + "\n";
+        }
+        ofstream stream(NAME, ios::binary | ios::trunc);
+        stream << text;
+    }
+
+    /// @brief True if OUTPUT was last produced by the command with fingerprint DIGEST
+    bool CommandLog::matches(const std::string &OUTPUT, const std::string &DIGEST) const {
+        lock_guard<mutex> lock(mMutex);
+        const auto ITER = mDigests.find(OUTPUT);
+        return ITER != mDigests.end() && ITER->second == DIGEST;
+    }
+
+    /// @brief Records that OUTPUT was produced by the command with fingerprint DIGEST
+    void CommandLog::record(const std::string &OUTPUT, const std::string &DIGEST) {
+        lock_guard<mutex> lock(mMutex);
+        string &digest = mDigests[OUTPUT];
+        if(digest != DIGEST) {
+            digest = DIGEST;
+            mDirty = true;
+        }
+    }
+
+    /// @brief Forgets the command that produced OUTPUT, right away in the file NAME as well, so a build stopped while a different command
+    /// rewrites OUTPUT (before save) does not leave it recorded as produced by the old one
+    void CommandLog::forget(const std::string &OUTPUT, const std::string &NAME) {
+        lock_guard<mutex> lock(mMutex);
+        if(mDigests.erase(OUTPUT) == 0) {
+            return;
+        }
+        mDirty = true;
+
+        // Appending keeps this cheap when a changed flag rebuilds everything, and save rewrites the file without these lines
+        ofstream stream(NAME, ios::binary | ios::app);
+        stream << "- " << OUTPUT << "\n";
+        stream.flush();
+    }
+
+    /// @brief Appends PATH with its stat STAT
+    void StatManifest::add(const std::string &PATH, const files::FileStat &STAT) {
+        mEntries.push_back({mPaths.length(), STAT});
+        mPaths.append(PATH).push_back('\0');
+    }
+
+    /// @brief Loads a manifest written by save from NAME. A missing or invalid file loads a manifest that is never current
+    void StatManifest::load(const std::string &NAME) {
+        // The digest on the first line, then one "<mtime> <size> <inode> <path>" line per path ("- <path>" if it did not exist).
+        // The whole file becomes mPaths, with each line ending at a NUL after its path
+        mDigest.clear();
+        mEntries.clear();
+        ifstream stream(NAME, ios::binary | ios::ate);
+        mPaths.assign(stream.fail() ? 0 : max((streamoff)stream.tellg(), (streamoff)0), '\0');
+        stream.seekg(0);
+        stream.read(&mPaths[0], mPaths.size());
+        mPaths.resize(stream.gcount());
+
+        size_t start = mPaths.find('\n');
+        if(start == string::npos) {
+            mPaths.clear();
+            return;
+        }
+        const string DIGEST = mPaths.substr(0, start++);
+        while(start < mPaths.length()) {
+            const size_t END = mPaths.find('\n', start);
+            if(END == string::npos) {
+                mEntries.clear();
+                return;
+            }
+            mPaths[END] = '\0';
+
+            files::FileStat stat;
+            const char *pField = mPaths.c_str() + start;
+            if(*pField == '-') {
+                pField++;
+            } else {
+                char *pEnd = nullptr;
+                stat.exists = true;
+                stat.mtime = strtoll(pField, &pEnd, 10);
+                stat.size = strtoull(pEnd, &pEnd, 10);
+                stat.inode = strtoull(pEnd, &pEnd, 10);
+                pField = pEnd;
+            }
+            const size_t PATH = pField - mPaths.c_str() + 1;
+            if(*pField != ' ' || PATH >= END) {
+                mEntries.clear();
+                return;
+            }
+            mEntries.push_back({PATH, stat});
+            start = END + 1;
+        }
+        mDigest = DIGEST;
+    }
+
+    /// @brief Writes the manifest to NAME (or removes NAME if nothing is recorded)
+    void StatManifest::save(const std::string &NAME) const {
+        if(mDigest.empty()) {
+            remove(NAME.c_str());
+            return;
+        }
+        string text = mDigest + "\n";
+        for(const Entry &ENTRY : mEntries) {
+            if(ENTRY.stat.exists) {
+                text += to_string(ENTRY.stat.mtime) + " " + to_string(ENTRY.stat.size) + " " + to_string(ENTRY.stat.inode) + " ";
+            } else {
+                text += "- ";
+            }
+            text += mPaths.c_str() + ENTRY.path;
+            text += "\n";
+        }
+        ofstream stream(NAME, ios::binary | ios::trunc);
+        stream << text;
+    }
+
+    /// @brief True if the manifest was recorded for a build with fingerprint DIGEST and none of its paths changed since
+    bool StatManifest::is_current(const std::string &DIGEST) const {
+        if(mDigest.empty() || mDigest != DIGEST) {
+            return false;
+        }
+        // Stat every path at once so large builds overlap the latency of each call
+        vector<string> paths;
+        paths.reserve(mEntries.size());
+        for(const Entry &ENTRY : mEntries) {
+            paths.push_back(mPaths.c_str() + ENTRY.path);
+        }
+        const vector<files::FileStat> STATS = files::stat_all(paths);
+        for(size_t i = 0; i < mEntries.size(); i++) {
+            if(STATS[i] != mEntries[i].stat) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Records the current stats of INPUTS and OUTPUTS for a build with fingerprint DIGEST. If any input was modified at or after SINCE (the start of the build)
+    /// nothing is recorded and false is returned, since the build may have read it before the change
+    bool StatManifest::record(const std::string &DIGEST, const std::vector<std::string> &INPUTS, const std::vector<std::string> &OUTPUTS, const long long SINCE) {
+        mDigest.clear();
+        mPaths.clear();
+        mEntries.clear();
+        for(const string &PATH : INPUTS) {
+            const files::FileStat STAT = files::stat(PATH);
+            if(STAT.mtime >= SINCE) {
+                mPaths.clear();
+                mEntries.clear();
+                return false;
+            }
+            add(PATH, STAT);
+        }
+        for(const string &PATH : OUTPUTS) {
+            add(PATH, files::stat(PATH));
+        }
+        mDigest = DIGEST;
+        return true;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef FINGERPRINTS_H
+#define FINGERPRINTS_H
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "files.h"
+
+namespace fingerprints {
+    /// @brief Digest of running PROGRAM with ARGS, which changes whenever anything affecting the output of the command does
+    std::string of(const std::string &PROGRAM, const std::vector<std::string> &ARGS);
+
+    /// @brief Remembers the command that last produced each build output, so an output is only rebuilt when its own command changes.
+    /// Thread-safe, so compile jobs can check and record their commands in parallel
+    class CommandLog final {
+        private:
+            /// @brief Fingerprint of the command that produced each output
+            std::unordered_map<std::string, std::string> mDigests;
+            mutable std::mutex mMutex;
+            bool mDirty = false;
+
+        public:
+            /// @brief Loads fingerprints recorded by save from NAME. A missing or invalid file is ignored
+            void load(const std::string &NAME);
+
+            /// @brief Writes the fingerprints to NAME if any changed
+            void save(const std::string &NAME) const;
+
+            /// @brief True if OUTPUT was last produced by the command with fingerprint DIGEST
+            bool matches(const std::string &OUTPUT, const std::string &DIGEST) const;
+
+            /// @brief Records that OUTPUT was produced by the command with fingerprint DIGEST
+            void record(const std::string &OUTPUT, const std::string &DIGEST);
+
+            /// @brief Forgets the command that produced OUTPUT, right away in the file NAME as well, so a build stopped while a different command
+            /// rewrites OUTPUT (before save) does not leave it recorded as produced by the old one
+            void forget(const std::string &OUTPUT, const std::string &NAME);
+    };
+
+    /// @brief The stat of every input of a build as of its last success, so a build with nothing to do is recognized by stats alone
+    /// without walking, scanning, or checking anything else. Directories are recorded too, since adding or removing a file changes their stat
+    class StatManifest final {
+        private:
+            /// @brief Fingerprint of everything about the build besides its inputs
+            std::string mDigest;
+
+            /// @brief Every recorded path, each ending in a NUL. Manifests list every file in the project, so paths are not stored as separate strings
+            std::string mPaths;
+
+            struct Entry {
+                /// @brief Offset of the path in mPaths
+                size_t path;
+                files::FileStat stat;
+            };
+            std::vector<Entry> mEntries;
+
+            /// @brief Appends PATH with its stat STAT
+            void add(const std::string &PATH, const files::FileStat &STAT);
+
+        public:
+            /// @brief Loads a manifest written by save from NAME. A missing or invalid file loads a manifest that is never current
+            void load(const std::string &NAME);
+
+            /// @brief Writes the manifest to NAME (or removes NAME if nothing is recorded)
+            void save(const std::string &NAME) const;
+
+            /// @brief True if the manifest was recorded for a build with fingerprint DIGEST and none of its paths changed since
+            bool is_current(const std::string &DIGEST) const;
+
+            /// @brief Records the current stats of INPUTS and OUTPUTS for a build with fingerprint DIGEST. If any input was modified at or after SINCE (the start of the build)
+            /// nothing is recorded and false is returned, since the build may have read it before the change
+            bool record(const std::string &DIGEST, const std::vector<std::string> &INPUTS, const std::vector<std::string> &OUTPUTS, const long long SINCE);
+    };
+}
+#endif
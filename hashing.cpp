@@ -0,0 +1,150 @@
+#include "hashing.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+using namespace std;
+
+namespace hashing {
+    namespace {
+        const uint64_t IV[8] = {
+            0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+            0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+        };
+
+        /// @brief Order in which each round reads the words of a block
+        const unsigned char SIGMA[12][16] = {
+            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+            {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+            {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+            {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+            {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+            {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+            {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+            {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+            {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+            {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+            {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+            {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}
+        };
+
+        /// @brief Bytes in a digest
+        const size_t DIGEST_SIZE = 16;
+
+        /// @brief Reads the 16 little endian words of BLOCK into WORDS
+        void load(const unsigned char* BLOCK, uint64_t WORDS[16]) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            memcpy(WORDS, BLOCK, 16 * sizeof(uint64_t));
+#else
+            for(int i = 0; i < 16; i++) {
+                WORDS[i] = 0;
+                for(int j = 7; j >= 0; j--) {
+                    WORDS[i] = (WORDS[i] << 8) | BLOCK[i * 8 + j];
+                }
+            }
+#endif
+        }
+
+        // The mixing function G on words A, B, C, and D of v with message words X and Y, and a round of it with the words of m in the order of SIGMA[R].
+        // Macros rather than functions, since cog is built without optimizations by default and this runs over every preprocessed source
+        #define HASHING_ROTATE(X, BITS) (((X) >> (BITS)) | ((X) << (64 - (BITS))))
+        #define HASHING_G(A, B, C, D, X, Y) \
+            v[A] = v[A] + v[B] + (X); v[D] = HASHING_ROTATE(v[D] ^ v[A], 32); v[C] = v[C] + v[D]; v[B] = HASHING_ROTATE(v[B] ^ v[C], 24); \
+            v[A] = v[A] + v[B] + (Y); v[D] = HASHING_ROTATE(v[D] ^ v[A], 16); v[C] = v[C] + v[D]; v[B] = HASHING_ROTATE(v[B] ^ v[C], 63);
+        #define HASHING_ROUND(R) \
+            HASHING_G(0, 4, 8, 12, m[SIGMA[R][0]], m[SIGMA[R][1]]) HASHING_G(1, 5, 9, 13, m[SIGMA[R][2]], m[SIGMA[R][3]]) \
+            HASHING_G(2, 6, 10, 14, m[SIGMA[R][4]], m[SIGMA[R][5]]) HASHING_G(3, 7, 11, 15, m[SIGMA[R][6]], m[SIGMA[R][7]]) \
+            HASHING_G(0, 5, 10, 15, m[SIGMA[R][8]], m[SIGMA[R][9]]) HASHING_G(1, 6, 11, 12, m[SIGMA[R][10]], m[SIGMA[R][11]]) \
+            HASHING_G(2, 7, 8, 13, m[SIGMA[R][12]], m[SIGMA[R][13]]) HASHING_G(3, 4, 9, 14, m[SIGMA[R][14]], m[SIGMA[R][15]])
+    }
+
+    /// @brief Hashes TEXT into a 32 character hex digest (see Hasher), which names cache entries by content
+    std::string digest(const std::string &TEXT) {
+        return Hasher().add(TEXT).digest();
+    }
+
+    Hasher::Hasher() {
+        for(int i = 0; i < 8; i++) {
+            mState[i] = IV[i];
+        }
+        // No key, and a DIGEST_SIZE byte digest
+        mState[0] ^= 0x01010000ULL ^ DIGEST_SIZE;
+    }
+
+    void Hasher::compress(const unsigned char* BLOCK, const bool LAST) {
+        uint64_t m[16], v[16];
+        load(BLOCK, m);
+        for(int i = 0; i < 8; i++) {
+            v[i] = mState[i];
+            v[i + 8] = IV[i];
+        }
+        // The high word of the byte counter stays 0, since nothing hashed here comes near 2^64 bytes
+        v[12] ^= mCompressed;
+        if(LAST) {
+            v[14] = ~v[14];
+        }
+
+        HASHING_ROUND(0) HASHING_ROUND(1) HASHING_ROUND(2) HASHING_ROUND(3) HASHING_ROUND(4) HASHING_ROUND(5)
+        HASHING_ROUND(6) HASHING_ROUND(7) HASHING_ROUND(8) HASHING_ROUND(9) HASHING_ROUND(10) HASHING_ROUND(11)
+        for(int i = 0; i < 8; i++) {
+            mState[i] ^= v[i] ^ v[i + 8];
+        }
+    }
+
+    void Hasher::mix(const char* DATA, const size_t LENGTH) {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(DATA);
+        size_t left = LENGTH;
+        while(left > 0) {
+            // A full block is only compressed once more input arrives, since the last one is compressed with LAST
+            if(mBlockLength == BLOCK_SIZE) {
+                mCompressed += BLOCK_SIZE;
+                compress(mBlock, false);
+                mBlockLength = 0;
+            }
+            // Whole blocks are compressed straight from DATA as long as more input follows them
+            if(mBlockLength == 0) {
+                for(; left > BLOCK_SIZE; bytes += BLOCK_SIZE, left -= BLOCK_SIZE) {
+                    mCompressed += BLOCK_SIZE;
+                    compress(bytes, false);
+                }
+            }
+            const size_t COPIED = min(left, BLOCK_SIZE - mBlockLength);
+            memcpy(mBlock + mBlockLength, bytes, COPIED);
+            mBlockLength += COPIED;
+            bytes += COPIED;
+            left -= COPIED;
+        }
+    }
+
+    /// @brief Adds TEXT to the digest
+    Hasher& Hasher::add(const std::string_view TEXT) {
+        // The length is always hashed as 8 little endian bytes, so digests are the same on every machine
+        unsigned char length[8];
+        for(int i = 0; i < 8; i++) {
+            length[i] = (unsigned char)((uint64_t)TEXT.length() >> (i * 8));
+        }
+        mix(reinterpret_cast<const char*>(length), sizeof(length));
+        mix(TEXT.data(), TEXT.length());
+        return *this;
+    }
+
+    /// @brief The 32 character hex digest of everything added so far
+    std::string Hasher::digest() const {
+        Hasher last = *this;
+        last.mCompressed += last.mBlockLength;
+        memset(last.mBlock + last.mBlockLength, 0, BLOCK_SIZE - last.mBlockLength);
+        last.compress(last.mBlock, true);
+
+        const char* HEX = "0123456789abcdef";
+        string text;
+        for(size_t i = 0; i < DIGEST_SIZE; i++) {
+            const unsigned char BYTE = (unsigned char)(last.mState[i / 8] >> (i % 8 * 8));
+            text += HEX[BYTE >> 4];
+            text += HEX[BYTE & 15];
+        }
+        return text;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef HASHING_H
+#define HASHING_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace hashing {
+    /// @brief Hashes TEXT into a 32 character hex digest (see Hasher), which names cache entries by content
+    std::string digest(const std::string &TEXT);
+
+    /// @brief Incrementally builds a digest from several pieces of text. Each piece is length prefixed so ("ab","c") and ("a","bc") differ.
+    /// The digest is BLAKE2b (RFC 7693) with a 128 bit output, so distinct inputs that share a digest are not a practical concern
+    class Hasher final {
+        private:
+            /// @brief Size of the blocks BLAKE2b compresses
+            static constexpr size_t BLOCK_SIZE = 128;
+
+            uint64_t mState[8];
+            /// @brief Bytes compressed so far
+            uint64_t mCompressed = 0;
+            /// @brief Input not compressed yet, since the last block is compressed differently and any block may turn out to be the last
+            unsigned char mBlock[BLOCK_SIZE];
+            size_t mBlockLength = 0;
+
+            void mix(const char* DATA, const size_t LENGTH);
+
+            /// @brief Compresses BLOCK into mState, which must be the LAST one if nothing follows
+            void compress(const unsigned char* BLOCK, const bool LAST);
+
+        public:
+            Hasher();
+
+            /// @brief Adds TEXT to the digest
+            Hasher& add(const std::string_view TEXT);
+
+            /// @brief The 32 character hex digest of everything added so far
+            std::string digest() const;
+    };
+}
+#endif
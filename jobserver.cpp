@@ -0,0 +1,128 @@
+#include "jobserver.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#ifndef WINDOWS
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "commands.h"
+#include "console.hpp"
+
+using namespace std;
+using namespace console;
+
+namespace jobserver {
+    namespace {
+        /// @brief The jobserver from MAKEFLAGS, found the first time it is needed (and again after a Server changes MAKEFLAGS)
+        struct Client {
+            bool parsed = false;
+            int read = -1, write = -1;
+        };
+        mutex clientMutex;
+        Client client;
+
+        /// @brief The jobserver advertised in MAKEFLAGS, with -1 descriptors if there is none or it cannot be used
+        Client& get_client() {
+            lock_guard<mutex> lock(clientMutex);
+            if(client.parsed) {
+                return client;
+            }
+            client = Client {true, -1, -1};
+#ifndef WINDOWS
+            // make 4.2 and later write --jobserver-auth (4.4 may use a named pipe), older versions --jobserver-fds
+            const string FLAGS = commands::get_env_var("MAKEFLAGS");
+            string auth = "";
+            for(const string &OPTION : {string("--jobserver-auth="), string("--jobserver-fds=")}) {
+                const size_t START = FLAGS.rfind(OPTION);
+                if(START != string::npos) {
+                    auth = FLAGS.substr(START + OPTION.length(), FLAGS.find(' ', START) - START - OPTION.length());
+                    break;
+                }
+            }
+            if(auth.rfind("fifo:", 0) == 0) {
+                client.read = client.write = open(auth.substr(5).c_str(), O_RDWR | O_CLOEXEC);
+            } else if(auth.find(',') != string::npos) {
+                int read = -1, write = -1;
+                if(sscanf(auth.c_str(), "%d,%d", &read, &write) == 2 && read >= 0 && write >= 0 && fcntl(read, F_GETFD) != -1 && fcntl(write, F_GETFD) != -1) {
+                    client.read = read;
+                    client.write = write;
+                }
+            }
+#endif
+            return client;
+        }
+    }
+
+    /// @brief Creates a jobserver allowing JOBS jobs at once and advertises it in MAKEFLAGS for child processes
+    Server::Server(const size_t JOBS) {
+#ifdef WINDOWS
+        throw runtime_error("Sharing jobs between processes is not supported on Windows");
+#else
+        // The descriptors are inherited on purpose, that is how children find the jobserver
+        int fds[2];
+        if(pipe(fds) != 0) {
+            throw runtime_error("Cannot create a jobserver");
+        }
+        mRead = fds[0];
+        mWrite = fds[1];
+        const string TOKENS(JOBS > 1 ? JOBS - 1 : 0, '+');
+        if(!TOKENS.empty() && ::write(mWrite, TOKENS.data(), TOKENS.length()) != (ssize_t)TOKENS.length()) {
+            throw runtime_error("Cannot create a jobserver");
+        }
+
+        mPreviousFlags = commands::get_env_var("MAKEFLAGS");
+        commands::set_env_var("MAKEFLAGS", format(" -j%zu --jobserver-auth=%d,%d", JOBS, mRead, mWrite));
+        lock_guard<mutex> lock(clientMutex);
+        client.parsed = false;
+#endif
+    }
+
+    /// @brief Restores MAKEFLAGS and closes the pipe
+    Server::~Server() {
+#ifndef WINDOWS
+        commands::set_env_var("MAKEFLAGS", mPreviousFlags);
+        {
+            lock_guard<mutex> lock(clientMutex);
+            client.parsed = false;
+        }
+        close(mRead);
+        close(mWrite);
+#endif
+    }
+
+    /// @brief True if this process was given a jobserver in MAKEFLAGS (by make or a cog workspace build)
+    bool is_available() {
+        return get_client().read >= 0;
+    }
+
+    /// @brief Blocks until a job token is free and takes it, returning false if there is no jobserver to take one from. Every process may run one job without a token
+    bool acquire() {
+#ifdef WINDOWS
+        return false;
+#else
+        const Client &CLIENT = get_client();
+        if(CLIENT.read < 0) {
+            return false;
+        }
+        char token;
+        ssize_t count;
+        while((count = ::read(CLIENT.read, &token, 1)) < 0 && errno == EINTR);
+        // If the jobserver went away the job simply runs
+        return count == 1;
+#endif
+    }
+
+    /// @brief Returns a token taken by acquire
+    void release() {
+#ifndef WINDOWS
+        const Client &CLIENT = get_client();
+        while(CLIENT.write >= 0 && ::write(CLIENT.write, "+", 1) < 0 && errno == EINTR);
+#endif
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef JOBSERVER_H
+#define JOBSERVER_H
+#include <cstddef>
+#include <string>
+
+namespace jobserver {
+    /// @brief A GNU make compatible jobserver: a pipe holding one token per job that may run besides the one every process is allowed without a token.
+    /// Processes started while it exists (cog, make, and compilers like gcc -flto) learn about it from MAKEFLAGS and share its budget
+    class Server final {
+        private:
+            int mRead = -1, mWrite = -1;
+            std::string mPreviousFlags;
+
+        public:
+            /// @brief Creates a jobserver allowing JOBS jobs at once and advertises it in MAKEFLAGS for child processes
+            explicit Server(const size_t JOBS);
+
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+            /// @brief Restores MAKEFLAGS and closes the pipe
+            ~Server();
+    };
+
+    /// @brief True if this process was given a jobserver in MAKEFLAGS (by make or a cog workspace build)
+    bool is_available();
+
+    /// @brief Blocks until a job token is free and takes it, returning false if there is no jobserver to take one from. Every process may run one job without a token
+    bool acquire();
+
+    /// @brief Returns a token taken by acquire
+    void release();
+}
+#endif
@@ -1,4 +1,5 @@
 #include <string>
+#include <string_view>
 #include <vector>
 #include <regex>
 
@@ -7,6 +8,9 @@
 #include "version.h"
 #include "actions.h"
 #include "files.h"
+#include "objectcache.h"
+#include "timings.h"
+#include "buildserver.h"
 
 #include "third_party/matchOS.h"
 
@@ -26,6 +30,15 @@ void warn_unexpected_argument(const string ARG) {
 	warn_unexpected_argument(ARG.c_str());
 }
 
+/// @brief Parses the value of -j/--jobs, warning and returning 0 (use the default) if it is not a positive integer
+size_t parse_jobs(const string ARG, const string VALUE) {
+	if(!VALUE.empty() && VALUE.find_first_not_of("0123456789") == string::npos && stoul(VALUE) > 0) {
+		return stoul(VALUE);
+	}
+	warn_unexpected_argument(ARG + " " + VALUE);
+	return 0;
+}
+
 /// @brief A simple hash function, not cryptographically secure
 size_t cyrb(string text, size_t seed = 0) {
     size_t h1 = 0xdeadbeef ^ seed, h2 = 0x41c6ce57 ^ seed;
@@ -65,6 +78,7 @@ int main(int argc, char *argv[]) {
 			const BuildType TYPE = ARG == "test" ? BuildType::TEST : BuildType::NORMAL;
 			vector<string> projectArgs, features;
 			bool debug = true, readingThisArgs = true, defaultFeatures = true;
+			size_t jobs = 0;
 			for(int i = 2; i < argc; i++) {
 				const auto ARG_I = string(argv[i]);
 				if(readingThisArgs && ARG_I == "--") {
@@ -79,20 +93,40 @@ int main(int argc, char *argv[]) {
 					} else {
 						warn_unexpected_argument(ARG_I);
 					}
+				} else if(readingThisArgs && (ARG_I == "--jobs" || ARG_I == "-j")) {
+					if(i + 1 < argc) {
+						jobs = parse_jobs(ARG_I, argv[++i]);
+					} else {
+						warn_unexpected_argument(ARG_I);
+					}
 				} else if(readingThisArgs) {
 					warn_unexpected_argument(ARG_I);
 				} else {
 					projectArgs.push_back(ARG_I);
 				}
 			}
-			run(debug, defaultFeatures, features, projectArgs, TYPE);
+			run(debug, defaultFeatures, features, projectArgs, TYPE, jobs);
 		} else if(ARG == "build") {
-			vector<string> features;
-			bool debug = true, defaultFeatures = true;
+			vector<string> trainingArgs, features;
+			bool debug = true, readingThisArgs = true, defaultFeatures = true;
+			PgoPhase pgo = PgoPhase::OFF;
+			bool pgoTests = false;
+			size_t jobs = 0;
 			for(int i = 2; i < argc; i++) {
 				const auto ARG_I = string(argv[i]);
-				if((ARG_I == "--release" || ARG_I == "-r")) {
+				if(!readingThisArgs) {
+					trainingArgs.push_back(ARG_I);
+				} else if(ARG_I == "--") {
+					readingThisArgs = false;
+				} else if((ARG_I == "--release" || ARG_I == "-r")) {
 					debug = false;
+				} else if(ARG_I == "--pgo" || ARG_I == "--pgo-test") {
+					pgo = PgoPhase::GENERATE;
+					pgoTests = ARG_I == "--pgo-test";
+				} else if(ARG_I == "--pgo-use") {
+					pgo = PgoPhase::USE;
+				} else if(ARG_I == "--timings" || ARG_I == "--time-report") {
+					timings::enable(ARG_I == "--time-report");
 				} else if((ARG_I == "--no-default-features" || ARG_I == "-x")) {
 					defaultFeatures = false;
 				} else if((ARG_I == "--feature" || ARG_I == "-F")) {
@@ -101,11 +135,118 @@ int main(int argc, char *argv[]) {
 					} else {
 						warn_unexpected_argument(ARG_I);
 					}
+				} else if((ARG_I == "--jobs" || ARG_I == "-j")) {
+					if(i + 1 < argc) {
+						jobs = parse_jobs(ARG_I, argv[++i]);
+					} else {
+						warn_unexpected_argument(ARG_I);
+					}
 				} else {
 					warn_unexpected_argument(ARG_I);
 				}
 			}
-			build(debug, defaultFeatures, features, BuildType::NORMAL);
+			if(is_workspace()) {
+				if(pgo != PgoPhase::OFF || timings::is_enabled() || !defaultFeatures || !features.empty() || !trainingArgs.empty()) {
+					throw runtime_error("Profile guided optimization, timings, and features are not supported when building a workspace");
+				}
+				build_workspace(debug, jobs);
+			} else if(pgo == PgoPhase::GENERATE) {
+				build_with_pgo(defaultFeatures, features, pgoTests, trainingArgs, jobs);
+			} else {
+				for(const string &TRAINING_ARG : trainingArgs) {
+					warn_unexpected_argument(TRAINING_ARG);
+				}
+				string executable;
+				if(pgo != PgoPhase::OFF || timings::is_enabled() || !build_on_server(debug, defaultFeatures, features, BuildType::NORMAL, jobs, executable)) {
+					build(debug && pgo == PgoPhase::OFF, defaultFeatures, features, BuildType::NORMAL, jobs, pgo);
+				}
+			}
+		} else if(ARG == "watch") {
+			int first = 2;
+			string mode = "build";
+			if(argc > 2 && (string(argv[2]) == "build" || string(argv[2]) == "run" || string(argv[2]) == "test")) {
+				mode = argv[first++];
+			}
+			const BuildType TYPE = mode == "test" ? BuildType::TEST : BuildType::NORMAL;
+			vector<string> projectArgs, features;
+			bool debug = true, readingThisArgs = true, defaultFeatures = true;
+			size_t jobs = 0;
+			for(int i = first; i < argc; i++) {
+				const auto ARG_I = string(argv[i]);
+				if(readingThisArgs && ARG_I == "--") {
+					readingThisArgs = false;
+				} else if(readingThisArgs && (ARG_I == "--release" || ARG_I == "-r") && TYPE == BuildType::NORMAL) {
+					debug = false;
+				} else if(readingThisArgs && (ARG_I == "--no-default-features" || ARG_I == "-x")) {
+					defaultFeatures = false;
+				} else if(readingThisArgs && (ARG_I == "--feature" || ARG_I == "-F")) {
+					if(i + 1 < argc) {
+						features.push_back(argv[++i]);
+					} else {
+						warn_unexpected_argument(ARG_I);
+					}
+				} else if(readingThisArgs && (ARG_I == "--jobs" || ARG_I == "-j")) {
+					if(i + 1 < argc) {
+						jobs = parse_jobs(ARG_I, argv[++i]);
+					} else {
+						warn_unexpected_argument(ARG_I);
+					}
+				} else if(readingThisArgs || mode == "build") {
+					warn_unexpected_argument(ARG_I);
+				} else {
+					projectArgs.push_back(ARG_I);
+				}
+			}
+			watch(mode != "build", debug, defaultFeatures, features, projectArgs, TYPE, jobs);
+		} else if(ARG == "daemon") {
+			const string ACTION = argc > 2 ? argv[2] : "start";
+			for(int i = 3; i < argc; i++) {
+				warn_unexpected_argument(argv[i]);
+			}
+			buildserver::Response response;
+			if(ACTION == "serve") {
+				serve_builds();
+			} else if(ACTION == "start") {
+				if(buildserver::send({"status"}, response) && response.status == "ok") {
+					printlnf("%s", response.message.c_str());
+				} else if(buildserver::spawn() && buildserver::send({"status"}, response) && response.status == "ok") {
+					printlnf("%s", response.message.c_str());
+				} else {
+					throw runtime_error("Could not start a build server (cog daemon serve runs one in the foreground)");
+				}
+			} else if(ACTION == "status") {
+				printlnf("%s", buildserver::send({"status"}, response) && response.status == "ok" ? response.message.c_str() : "No build server is running for this project");
+			} else if(ACTION == "stop") {
+				printlnf("%s", buildserver::send({"stop"}, response) ? "Stopped the build server" : "No build server is running for this project");
+			} else {
+				warn_unexpected_argument(ACTION);
+			}
+		} else if(ARG == "gc") {
+			double days = 7;
+			if(argc > 2) {
+				const string VALUE = argv[2];
+				if(!VALUE.empty() && VALUE.find_first_not_of("0123456789") == string::npos) {
+					days = stoul(VALUE);
+				} else {
+					warn_unexpected_argument(VALUE);
+				}
+			}
+			for(int i = 3; i < argc; i++) {
+				warn_unexpected_argument(argv[i]);
+			}
+			collect_garbage(days);
+		} else if(ARG == "cache") {
+			const string ACTION = argc > 2 ? argv[2] : "stats";
+			for(int i = 3; i < argc; i++) {
+				warn_unexpected_argument(argv[i]);
+			}
+			if(ACTION == "stats") {
+				objectcache::print_stats();
+			} else if(ACTION == "clear") {
+				objectcache::clear();
+			} else {
+				warn_unexpected_argument(ACTION);
+			}
 		} else if(ARG == "features") {
 			const configstring::ConfigObject CONFIG = get_config();
 
@@ -118,9 +259,10 @@ int main(int argc, char *argv[]) {
 			bool hasAny = false;
 			const string FEATURE_PREFIX = "feature.", FEATURE_NOTE_SUFFIX = ".notes", FEATURE_REQUIRED_SUFFIX = ".required";
 			regex featurePattern(format("^%s([A-Z0-9_]+)$", FEATURE_PREFIX.c_str()));
-			for(const string &KEY : CONFIG.keys()) {
+			for(const string_view KEY_VIEW : CONFIG.keys_with_prefix(FEATURE_PREFIX)) {
+				const string KEY(KEY_VIEW);
 				const bool
-					IS_FEATURE = KEY.length() > FEATURE_PREFIX.length() && KEY.rfind(FEATURE_PREFIX,0) == 0,
+					IS_FEATURE = KEY.length() > FEATURE_PREFIX.length(),
 					IS_FEATURE_DTL = IS_FEATURE && KEY.length() > FEATURE_PREFIX.length() + FEATURE_REQUIRED_SUFFIX.length() && KEY.substr(KEY.length() - FEATURE_REQUIRED_SUFFIX.length()) == FEATURE_REQUIRED_SUFFIX,
 					IS_FEATURE_NOTE = IS_FEATURE && KEY.length() > FEATURE_PREFIX.length() + FEATURE_NOTE_SUFFIX.length() && KEY.substr(KEY.length() - FEATURE_NOTE_SUFFIX.length()) == FEATURE_NOTE_SUFFIX;
 
@@ -130,13 +272,15 @@ int main(int argc, char *argv[]) {
 					
 					string notes = "";
 					if(CONFIG.has(KEY + FEATURE_NOTE_SUFFIX)) {
-						if(const auto VALUE = CONFIG.get(KEY + FEATURE_NOTE_SUFFIX)->as<configstring::Null>());
-						else get_optional_string_from_config(CONFIG , KEY + FEATURE_NOTE_SUFFIX, notes);
+						if(!CONFIG.is<nullptr_t>(KEY + FEATURE_NOTE_SUFFIX)) {
+							get_optional_string_from_config(CONFIG , KEY + FEATURE_NOTE_SUFFIX, notes);
+						}
 					}
 
 					bool defaultValue = true;
-					if(const auto VALUE = CONFIG.get(KEY)->as<configstring::Null>());
-					else get_optional_bool_from_config(CONFIG , KEY, defaultValue);
+					if(!CONFIG.is<nullptr_t>(KEY)) {
+						get_optional_bool_from_config(CONFIG , KEY, defaultValue);
+					}
 
 					printlnf("\t%s%s%s", KEY.substr(8).c_str(), (notes != "" ? " - " + notes : "").c_str(), (defaultValue ? " (default)" : ""));
 				}
@@ -153,5 +297,6 @@ int main(int argc, char *argv[]) {
 		return 0;
 	} catch(const runtime_error &ERR) {
 		eprintlnf("%sRuntime error: %s%s", colors::RED, ERR.what(), colors::REVERT);
+		return 1;
 	}
 }
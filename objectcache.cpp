@@ -0,0 +1,277 @@
+#include "objectcache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef WINDOWS
+#include <process.h>
+#define getpid _getpid
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include "filesystem.h"
+#include "commands.h"
+#include "confighelper.h"
+#include "configstring/configstring.h"
+#include "console.hpp"
+#include "files.h"
+
+using namespace std;
+using namespace console;
+
+namespace fs = FILESYSTEM_NAMESPACE;
+
+namespace objectcache {
+    namespace {
+        const string HITS_KEY = "hits", MISSES_KEY = "misses", BYTES_SAVED_KEY = "bytesSaved", SIZE_KEY = "size";
+
+        /// @brief Holds an exclusive lock on a file for as long as it exists (no-op where flock is unavailable)
+        class FileLock final {
+            private:
+                int mFd = -1;
+            public:
+                explicit FileLock(const string &NAME) {
+#ifndef WINDOWS
+                    mFd = open(NAME.c_str(), O_RDWR | O_CREAT, 0644);
+                    if(mFd >= 0) {
+                        flock(mFd, LOCK_EX);
+                    }
+#endif
+                }
+                ~FileLock() {
+#ifndef WINDOWS
+                    if(mFd >= 0) {
+                        flock(mFd, LOCK_UN);
+                        close(mFd);
+                    }
+#endif
+                }
+                FileLock(const FileLock&) = delete;
+                FileLock& operator=(const FileLock&) = delete;
+        };
+
+        /// @brief Reads the statistics file in DIR (missing keys are 0)
+        void read_stats(const string &DIR, double &hits, double &misses, double &bytesSaved, double &size) {
+            hits = misses = bytesSaved = size = 0;
+            if(!files::fexists(DIR + "/stats")) {
+                return;
+            }
+            try {
+                const configstring::ConfigObject STATS = configstring::parse(files::fread(DIR + "/stats"));
+                get_optional_double_from_config(STATS, HITS_KEY, hits);
+                get_optional_double_from_config(STATS, MISSES_KEY, misses);
+                get_optional_double_from_config(STATS, BYTES_SAVED_KEY, bytesSaved);
+                get_optional_double_from_config(STATS, SIZE_KEY, size);
+            } catch(const runtime_error &ERR) {
+                // A corrupted stats file only loses statistics
+                hits = misses = bytesSaved = size = 0;
+            }
+        }
+
+        /// @brief Every entry in DIR as (last use, path, bytes)
+        vector<tuple<fs::file_time_type, fs::path, unsigned long long>> list_entries(const string &DIR) {
+            vector<tuple<fs::file_time_type, fs::path, unsigned long long>> entries;
+            if(!fs::is_directory(DIR + "/objects")) {
+                return entries;
+            }
+            for(const auto &shard : fs::directory_iterator(DIR + "/objects")) {
+                for(const auto &entry : fs::directory_iterator(shard.path())) {
+                    error_code error;
+                    const fs::path OBJECT = entry.path() / "object";
+                    const auto TIME = fs::last_write_time(OBJECT, error);
+                    if(error) {
+                        continue;
+                    }
+                    unsigned long long bytes = 0;
+                    for(const auto &file : fs::directory_iterator(entry.path())) {
+                        bytes += fs::file_size(file.path(), error);
+                    }
+                    entries.emplace_back(TIME, entry.path(), bytes);
+                }
+            }
+            return entries;
+        }
+    }
+
+    /// @brief The shared cache directory: $COG_CACHE_DIR, else $XDG_CACHE_HOME/cog, else ~/.cache/cog
+    std::string get_cache_dir() {
+        const string OVERRIDE = commands::get_env_var("COG_CACHE_DIR");
+        if(!OVERRIDE.empty()) {
+            return OVERRIDE;
+        }
+        const string XDG = commands::get_env_var("XDG_CACHE_HOME");
+        if(!XDG.empty()) {
+            return XDG + "/cog";
+        }
+#ifdef WINDOWS
+        return commands::get_env_var("LOCALAPPDATA") + "/cog";
+#else
+        return commands::get_env_var("HOME") + "/.cache/cog";
+#endif
+    }
+
+    /// @brief Maximum cache size in bytes from $COG_CACHE_SIZE (a number with an optional K, M, or G suffix, 5G by default)
+    unsigned long long get_max_size() {
+        const string TEXT = commands::get_env_var("COG_CACHE_SIZE");
+        const unsigned long long DEFAULT_SIZE = 5ULL << 30;
+        if(TEXT.empty()) {
+            return DEFAULT_SIZE;
+        }
+        try {
+            size_t end = 0;
+            const double VALUE = stod(TEXT, &end);
+            const string SUFFIX = configstring::stringlib::str_to_lower(TEXT.substr(end));
+            const unsigned long long SCALE = SUFFIX == "k" ? 1ULL << 10 : SUFFIX == "m" ? 1ULL << 20 : SUFFIX == "g" ? 1ULL << 30 : 1;
+            return (unsigned long long)(VALUE * SCALE);
+        } catch(const exception &ERR) {
+            throw runtime_error(format("Invalid COG_CACHE_SIZE \"%s\"", commands::escape_quotes(TEXT).c_str()));
+        }
+    }
+
+    /// @brief Uses the cache in DIR, creating it if needed
+    ObjectCache::ObjectCache(const std::string DIR): mDir(DIR) {
+        fs::create_directories(mDir + "/objects");
+        fs::create_directories(mDir + "/tmp");
+    }
+
+    /// @brief Directory holding the entry for KEY
+    std::string ObjectCache::entry_dir(const std::string &KEY) const {
+        return mDir + "/objects/" + KEY.substr(0, 2) + "/" + KEY;
+    }
+
+    /// @brief If KEY is cached, places its object at OBJECT (hard linked when possible), sets diagnostics, and returns true
+    bool ObjectCache::fetch(const std::string &KEY, const std::string &OBJECT, std::string &diagnostics) {
+        const string ENTRY = entry_dir(KEY);
+        error_code error;
+        const unsigned long long SIZE = fs::file_size(ENTRY + "/object", error);
+        if(error) {
+            mMisses++;
+            return false;
+        }
+
+        // Another process may evict the entry at any point, which just turns this into a miss
+        fs::remove(OBJECT, error);
+        fs::create_hard_link(ENTRY + "/object", OBJECT, error);
+        if(error) {
+            error.clear();
+            fs::copy_file(ENTRY + "/object", OBJECT, error);
+            if(error) {
+                mMisses++;
+                return false;
+            }
+        }
+
+        // Marks the entry as recently used and, through the hard link, makes the object newer than its sources
+        fs::last_write_time(ENTRY + "/object", fs::file_time_type::clock::now(), error);
+        fs::last_write_time(OBJECT, fs::file_time_type::clock::now(), error);
+
+        diagnostics = files::fexists(ENTRY + "/diagnostics") ? files::fread(ENTRY + "/diagnostics") : "";
+        mHits++;
+        mBytesSaved += SIZE;
+        return true;
+    }
+
+    /// @brief Stores the freshly compiled OBJECT and the DIAGNOSTICS printed compiling it under KEY
+    void ObjectCache::store(const std::string &KEY, const std::string &OBJECT, const std::string &DIAGNOSTICS) {
+        const string ENTRY = entry_dir(KEY);
+        const string TEMPORARY = format("%s/tmp/%s.%d.%zx", mDir.c_str(), KEY.c_str(), (int)getpid(), hash<thread::id>{}(this_thread::get_id()));
+        error_code error;
+        fs::create_directories(TEMPORARY, error);
+        fs::copy_file(OBJECT, TEMPORARY + "/object", fs::copy_options::overwrite_existing, error);
+        if(error) {
+            fs::remove_all(TEMPORARY, error);
+            return;
+        }
+        if(!DIAGNOSTICS.empty()) {
+            files::fwrite(TEMPORARY + "/diagnostics", DIAGNOSTICS);
+        }
+
+        // Renaming is atomic, so readers see the whole entry or none of it. If another process stored it first, keep theirs
+        fs::create_directories(fs::path(ENTRY).parent_path(), error);
+        fs::rename(TEMPORARY, ENTRY, error);
+        if(error) {
+            fs::remove_all(TEMPORARY, error);
+            return;
+        }
+        mBytesStored += fs::file_size(ENTRY + "/object", error) + DIAGNOSTICS.length();
+    }
+
+    /// @brief Adds this build's hits and misses to the shared statistics and evicts the least recently used entries if the cache is too big
+    void ObjectCache::flush() {
+        if(mHits == 0 && mMisses == 0 && mBytesStored == 0) {
+            return;
+        }
+
+        FileLock lock(mDir + "/lock");
+        double hits, misses, bytesSaved, size;
+        read_stats(mDir, hits, misses, bytesSaved, size);
+        hits += mHits.exchange(0);
+        misses += mMisses.exchange(0);
+        bytesSaved += mBytesSaved.exchange(0);
+        size += mBytesStored.exchange(0);
+
+        const unsigned long long MAX_SIZE = get_max_size();
+        if(size > MAX_SIZE) {
+            // Evict least recently used entries until 90% full so eviction does not run on every build
+            auto entries = list_entries(mDir);
+            sort(entries.begin(), entries.end());
+            size = 0;
+            for(const auto &ENTRY : entries) {
+                size += get<2>(ENTRY);
+            }
+            error_code error;
+            for(const auto &ENTRY : entries) {
+                if(size <= MAX_SIZE * 0.9) {
+                    break;
+                }
+                fs::remove_all(get<1>(ENTRY), error);
+                size -= get<2>(ENTRY);
+            }
+        }
+
+        // Written by hand since Number::stringify would switch to exponent notation, which parse reads back as a string
+        files::fwrite(mDir + "/stats", format("%s=%.0f;%s=%.0f;%s=%.0f;%s=%.0f;", HITS_KEY.c_str(), hits, MISSES_KEY.c_str(), misses, BYTES_SAVED_KEY.c_str(), bytesSaved, SIZE_KEY.c_str(), size));
+    }
+
+    /// @brief Prints hit rate, bytes saved, and size of the cache in DIR
+    void print_stats(const std::string DIR) {
+        double hits, misses, bytesSaved, size;
+        {
+            FileLock lock(DIR + "/lock");
+            read_stats(DIR, hits, misses, bytesSaved, size);
+        }
+        const auto ENTRIES = list_entries(DIR);
+        unsigned long long bytes = 0;
+        for(const auto &ENTRY : ENTRIES) {
+            bytes += get<2>(ENTRY);
+        }
+
+        const double MB = 1024.0 * 1024.0;
+        printlnf("Object cache: %s", DIR.c_str());
+        printlnf("\tEntries:     %zu", ENTRIES.size());
+        printlnf("\tSize:        %.1f MB of %.1f MB", bytes / MB, get_max_size() / MB);
+        printlnf("\tHits:        %.0f", hits);
+        printlnf("\tMisses:      %.0f", misses);
+        printlnf("\tHit rate:    %.1f%%", hits + misses > 0 ? 100 * hits / (hits + misses) : 0.0);
+        printlnf("\tBytes saved: %.1f MB", bytesSaved / MB);
+    }
+
+    /// @brief Removes every entry, config snapshot, and statistic from the cache in DIR
+    void clear(const std::string DIR) {
+        FileLock lock(DIR + "/lock");
+        error_code error;
+        fs::remove_all(DIR + "/objects", error);
+        fs::remove_all(DIR + "/tmp", error);
+        fs::remove_all(DIR + "/configs", error);
+        fs::remove(DIR + "/stats", error);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef OBJECTCACHE_H
+#define OBJECTCACHE_H
+#include <atomic>
+#include <string>
+
+namespace objectcache {
+    /// @brief The shared cache directory: $COG_CACHE_DIR, else $XDG_CACHE_HOME/cog, else ~/.cache/cog
+    std::string get_cache_dir();
+
+    /// @brief Maximum cache size in bytes from $COG_CACHE_SIZE (a number with an optional K, M, or G suffix, 5G by default)
+    unsigned long long get_max_size();
+
+    /// @brief A content addressed store of compiled objects and the diagnostics printed while compiling them, shared by every project.
+    /// Entries are written to a temporary directory and renamed into place, so parallel cog processes never see partial entries
+    class ObjectCache final {
+        private:
+            std::string mDir;
+            std::atomic<unsigned long long> mHits {0}, mMisses {0}, mBytesSaved {0}, mBytesStored {0};
+
+            /// @brief Directory holding the entry for KEY
+            std::string entry_dir(const std::string &KEY) const;
+
+        public:
+            /// @brief Uses the cache in DIR, creating it if needed
+            explicit ObjectCache(const std::string DIR = get_cache_dir());
+
+            /// @brief If KEY is cached, places its object at OBJECT (hard linked when possible), sets diagnostics, and returns true
+            bool fetch(const std::string &KEY, const std::string &OBJECT, std::string &diagnostics);
+
+            /// @brief Stores the freshly compiled OBJECT and the DIAGNOSTICS printed compiling it under KEY
+            void store(const std::string &KEY, const std::string &OBJECT, const std::string &DIAGNOSTICS);
+
+            /// @brief Adds this build's hits and misses to the shared statistics and evicts the least recently used entries if the cache is too big
+            void flush();
+    };
+
+    /// @brief Prints hit rate, bytes saved, and size of the cache in DIR
+    void print_stats(const std::string DIR = get_cache_dir());
+
+    /// @brief Removes every entry, config snapshot, and statistic from the cache in DIR
+    void clear(const std::string DIR = get_cache_dir());
+}
+#endif
@@ -0,0 +1,98 @@
+#include "precompiled.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "commands.h"
+#include "dependencies.h"
+#include "files.h"
+
+using namespace std;
+
+namespace precompiled {
+    namespace {
+        /// @brief Upper bound on how many headers are precompiled, since every source pays to load the whole precompiled header
+        const size_t MAX_HEADERS = 32;
+
+        /// @brief Reads the sizes remembered by save_sizes from NAME ("<size> <header>" per line)
+        map<string, unsigned long long> load_sizes(const string &NAME) {
+            map<string, unsigned long long> sizes;
+            ifstream stream(NAME);
+            unsigned long long size;
+            string header;
+            while(stream >> size && getline(stream >> ws, header)) {
+                sizes[header] = size;
+            }
+            return sizes;
+        }
+
+        void save_sizes(const string &NAME, const map<string, unsigned long long> &SIZES) {
+            string text;
+            for(const auto &[HEADER, SIZE] : SIZES) {
+                text += to_string(SIZE) + " " + HEADER + "\n";
+            }
+            files::fwrite_if_changed(NAME, text);
+        }
+    }
+
+    /// @brief Header cog writes in the build directory and force includes in every source; its precompiled form is this name followed by ".gch"
+    const std::string HEADER_NAME = "__Precompiled__.hpp";
+
+    /// @brief Picks the #include <...> headers worth precompiling for SOURCES: those included (directly or not) by at least half of them,
+    /// ranked by fan-in times preprocessed size. Sizes are measured with WHICH_CPP and FLAGS and remembered in BUILD_DIR.
+    /// Returns the text of a header including the chosen headers
+    std::string choose_headers(const dependencies::IncludeGraph &GRAPH, const std::vector<std::string> &SOURCES, const std::string &WHICH_CPP, const std::vector<std::string> &FLAGS, const std::string &BUILD_DIR) {
+        // Project headers are left out: they change far more often (rebuilding the precompiled header and every object) and may not compile on their own
+        map<string, size_t> fanIn;
+        for(const string &SOURCE : SOURCES) {
+            for(const string &HEADER : GRAPH.system_includes(SOURCE)) {
+                fanIn[HEADER]++;
+            }
+        }
+
+        const string SIZES_FILE = BUILD_DIR + "/pch.sizes", MEASURE_FILE = BUILD_DIR + "/__Measure__.hpp";
+        map<string, unsigned long long> sizes = load_sizes(SIZES_FILE);
+        vector<pair<unsigned long long, string>> ranked;
+        for(const auto &[HEADER, COUNT] : fanIn) {
+            if(COUNT < 2 || COUNT * 2 < SOURCES.size()) {
+                continue;
+            }
+
+            // Headers that do not exist here (like ones only included on other platforms) measure as 0 and are never picked
+            if(sizes.find(HEADER) == sizes.end()) {
+                files::fwrite(MEASURE_FILE, "#include <" + HEADER + ">\n");
+                vector<string> args;
+                copy_if(FLAGS.begin(), FLAGS.end(), back_inserter(args), [](const string &FLAG) { return FLAG != "-MMD" && FLAG != "-MP"; });
+                args.insert(args.end(), {"-E", MEASURE_FILE});
+                const auto RESULT = commands::run_and_read(WHICH_CPP, args, true);
+                sizes[HEADER] = RESULT.status == 0 ? RESULT.output.length() : 0;
+            }
+            if(sizes[HEADER] > 0) {
+                ranked.emplace_back(COUNT * sizes[HEADER], HEADER);
+            }
+        }
+        save_sizes(SIZES_FILE, sizes);
+
+        sort(ranked.begin(), ranked.end(), [](const auto &A, const auto &B) { return A.first != B.first ? A.first > B.first : A.second < B.second; });
+        if(ranked.size() > MAX_HEADERS) {
+            ranked.resize(MAX_HEADERS);
+        }
+
+        // Sorted by name so the header (and everything depending on it) only changes when the chosen set does
+        vector<string> chosen;
+        for(const auto &ENTRY : ranked) {
+            chosen.push_back(ENTRY.second);
+        }
+        sort(chosen.begin(), chosen.end());
+
+        string text = "// Chosen by cog from the headers most sources include (cpp.pch=auto)\n";
+        for(const string &HEADER : chosen) {
+            text += "#include <" + HEADER + ">\n";
+        }
+        return text;
+    }
+}
@@ -0,0 +1,17 @@
+#ifndef PRECOMPILED_H
+#define PRECOMPILED_H
+#include <string>
+#include <vector>
+
+#include "dependencies.h"
+
+namespace precompiled {
+    /// @brief Header cog writes in the build directory and force includes in every source; its precompiled form is this name followed by ".gch"
+    extern const std::string HEADER_NAME;
+
+    /// @brief Picks the #include <...> headers worth precompiling for SOURCES: those included (directly or not) by at least half of them,
+    /// ranked by fan-in times preprocessed size. Sizes are measured with WHICH_CPP and FLAGS and remembered in BUILD_DIR.
+    /// Returns the text of a header including the chosen headers
+    std::string choose_headers(const dependencies::IncludeGraph &GRAPH, const std::vector<std::string> &SOURCES, const std::string &WHICH_CPP, const std::vector<std::string> &FLAGS, const std::string &BUILD_DIR);
+}
+#endif
@@ -10,7 +10,13 @@
  * Adapted from https://stackoverflow.com/a/12099167 with slight variable renaming and c++ string wrapper
  */
 
+#include <cstdlib>
 #include <string>
+#include <vector>
+
+#ifndef WINDOWS
+#include <sys/utsname.h>
+#endif
 
 #include "matchOS.h"
 
@@ -47,4 +53,48 @@ else
     ifneq ($(filter arm%,$(UNAME_P)),)
         CFLAGS += -DARM
     endif
-endif)""";
\ No newline at end of file
+endif)""";
+
+/// @brief The flags MAKE_MATCH_OS adds to CFLAGS, computed in process for builds that do not go through make
+std::vector<std::string> match_os_flags() {
+    std::vector<std::string> flags;
+    const auto ENV = [](const char* NAME) { const char* VALUE = std::getenv(NAME); return std::string(VALUE ? VALUE : ""); };
+    if(ENV("OS") == "Windows_NT") {
+        flags.push_back("-DWIN32");
+        if(ENV("PROCESSOR_ARCHITEW6432") == "AMD64") {
+            flags.push_back("-DAMD64");
+        } else {
+            if(ENV("PROCESSOR_ARCHITECTURE") == "AMD64") {
+                flags.push_back("-DAMD64");
+            }
+            if(ENV("PROCESSOR_ARCHITECTURE") == "x86") {
+                flags.push_back("-DIA32");
+            }
+        }
+    }
+#ifndef WINDOWS
+    else {
+        // uname -p is "unknown" on some Linux distributions, so the machine name (uname -m) is used instead
+        struct utsname names;
+        if(uname(&names) == 0) {
+            const std::string SYSTEM = names.sysname, MACHINE = names.machine;
+            if(SYSTEM == "Linux") {
+                flags.push_back("-DLINUX");
+            }
+            if(SYSTEM == "Darwin") {
+                flags.push_back("-DOSX");
+            }
+            if(MACHINE == "x86_64") {
+                flags.push_back("-DAMD64");
+            }
+            if(MACHINE.length() >= 2 && MACHINE.substr(MACHINE.length() - 2) == "86") {
+                flags.push_back("-DIA32");
+            }
+            if(MACHINE.rfind("arm", 0) == 0) {
+                flags.push_back("-DARM");
+            }
+        }
+    }
+#endif
+    return flags;
+}
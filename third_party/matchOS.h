@@ -13,5 +13,9 @@
 #ifndef MATCHOS_H
 #define MATCHOS_H
 #include <string>
+#include <vector>
 extern const std::string MAKE_MATCH_OS;
+
+/// @brief The flags MAKE_MATCH_OS adds to CFLAGS, computed in process for builds that do not go through make
+std::vector<std::string> match_os_flags();
 #endif
\ No newline at end of file
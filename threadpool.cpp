@@ -0,0 +1,81 @@
+#include "threadpool.h"
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+namespace threads {
+    /// @brief Number of worker threads to use when none is given (one per hardware thread, at least 1)
+    size_t default_concurrency() {
+        const unsigned int COUNT = thread::hardware_concurrency();
+        return COUNT > 0 ? COUNT : 1;
+    }
+
+    /// @brief Starts THREADS worker threads (default_concurrency() if 0)
+    ThreadPool::ThreadPool(const size_t THREADS) {
+        const size_t COUNT = THREADS > 0 ? THREADS : default_concurrency();
+        for(size_t i = 0; i < COUNT; i++) {
+            mWorkers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    /// @brief Loop run by each worker thread
+    void ThreadPool::work() {
+        while(true) {
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(mMutex);
+                mTaskReady.wait(lock, [this] { return mStopping || !mTasks.empty(); });
+                if(mTasks.empty()) {
+                    return;
+                }
+                task = move(mTasks.front());
+                mTasks.pop();
+                mActive++;
+            }
+
+            task();
+
+            lock_guard<mutex> lock(mMutex);
+            mActive--;
+            if(mActive == 0 && mTasks.empty()) {
+                mIdle.notify_all();
+            }
+        }
+    }
+
+    /// @brief Queues TASK to be run by a worker. TASK must not throw
+    void ThreadPool::submit(std::function<void()> task) {
+        {
+            lock_guard<mutex> lock(mMutex);
+            mTasks.push(move(task));
+        }
+        mTaskReady.notify_one();
+    }
+
+    /// @brief Blocks until every submitted task (including tasks submitted by tasks) has finished
+    void ThreadPool::wait_idle() {
+        unique_lock<mutex> lock(mMutex);
+        mIdle.wait(lock, [this] { return mActive == 0 && mTasks.empty(); });
+    }
+
+    /// @brief The number of worker threads
+    size_t ThreadPool::size() const {
+        return mWorkers.size();
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            lock_guard<mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mTaskReady.notify_all();
+        for(thread &worker : mWorkers) {
+            worker.join();
+        }
+    }
+}
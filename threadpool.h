@@ -0,0 +1,60 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace threads {
+    /// @brief Number of worker threads to use when none is given (one per hardware thread, at least 1)
+    size_t default_concurrency();
+
+    /// @brief A fixed size pool of worker threads that run submitted tasks in FIFO order
+    class ThreadPool final {
+        private:
+            /// @brief Worker threads, joined on destruction
+            std::vector<std::thread> mWorkers;
+
+            /// @brief Tasks that have been submitted but not started
+            std::queue<std::function<void()>> mTasks;
+
+            /// @brief Guards mTasks, mActive, and mStopping
+            std::mutex mMutex;
+
+            /// @brief Signaled when a task is submitted or the pool is stopping
+            std::condition_variable mTaskReady;
+
+            /// @brief Signaled when the pool runs out of queued and running tasks
+            std::condition_variable mIdle;
+
+            /// @brief Number of tasks currently running
+            size_t mActive = 0;
+
+            /// @brief Set on destruction to release the workers
+            bool mStopping = false;
+
+            /// @brief Loop run by each worker thread
+            void work();
+
+        public:
+            /// @brief Starts THREADS worker threads (default_concurrency() if 0)
+            explicit ThreadPool(const size_t THREADS = 0);
+
+            /// @brief Queues TASK to be run by a worker. TASK must not throw
+            void submit(std::function<void()> task);
+
+            /// @brief Blocks until every submitted task (including tasks submitted by tasks) has finished
+            void wait_idle();
+
+            /// @brief The number of worker threads
+            size_t size() const;
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+            ~ThreadPool();
+    };
+}
+#endif
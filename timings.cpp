@@ -0,0 +1,212 @@
+#include "timings.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "console.hpp"
+#include "files.h"
+
+using namespace std;
+using namespace console;
+
+namespace timings {
+    namespace {
+        struct Span {
+            string name, category, details;
+            /// @brief Microseconds since recording started
+            double start, duration;
+            size_t thread, peakMemory;
+        };
+
+        bool enabled = false, compilerReports = false;
+        chrono::steady_clock::time_point origin;
+        mutex spansMutex;
+        vector<Span> spans;
+        map<thread::id, size_t> threads;
+
+        /// @brief Microseconds since recording started
+        double now() {
+            return chrono::duration<double, micro>(chrono::steady_clock::now() - origin).count();
+        }
+
+        /// @brief Escapes TEXT for a JSON string
+        string escape_json(const string &TEXT) {
+            string result;
+            for(const char C : TEXT) {
+                if(C == '"' || C == '\\') {
+                    result += '\\';
+                    result += C;
+                } else if(C == '\n') {
+                    result += "\\n";
+                } else if((unsigned char)C < 0x20) {
+                    result += format("\\u%04x", (int)C);
+                } else {
+                    result += C;
+                }
+            }
+            return result;
+        }
+
+        /// @brief Escapes TEXT for HTML text or attributes
+        string escape_html(const string &TEXT) {
+            string result;
+            for(const char C : TEXT) {
+                switch(C) {
+                    case '<': result += "&lt;"; break;
+                    case '>': result += "&gt;"; break;
+                    case '&': result += "&amp;"; break;
+                    case '"': result += "&quot;"; break;
+                    default: result += C;
+                }
+            }
+            return result;
+        }
+
+        /// @brief Chrome trace JSON for SPANS, one complete ("X") event per span
+        string to_trace(const vector<Span> &SPANS) {
+            string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            for(size_t i = 0; i < SPANS.size(); i++) {
+                const Span &SPAN = SPANS[i];
+                string args = "";
+                if(SPAN.peakMemory > 0) {
+                    args += format("\"peak_rss_kb\":%zu", SPAN.peakMemory);
+                }
+                if(!SPAN.details.empty()) {
+                    args += (args.empty() ? "" : ",") + format("\"details\":\"%s\"", escape_json(SPAN.details).c_str());
+                }
+                json += format("{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.0f,\"dur\":%.0f,\"pid\":1,\"tid\":%zu,\"args\":{%s}}%s\n",
+                    escape_json(SPAN.name).c_str(), escape_json(SPAN.category).c_str(), SPAN.start, SPAN.duration, SPAN.thread, args.c_str(), i + 1 < SPANS.size() ? "," : "");
+            }
+            return json + "]}\n";
+        }
+
+        /// @brief A self-contained HTML summary of SPANS: totals per category, every phase, and the compiles slowest first
+        string to_html(const vector<Span> &SPANS) {
+            double first = 0, last = 0;
+            map<string, pair<size_t, double>> categories;
+            vector<const Span*> phases, compiles;
+            for(const Span &SPAN : SPANS) {
+                first = min(first, SPAN.start);
+                last = max(last, SPAN.start + SPAN.duration);
+                categories[SPAN.category].first++;
+                categories[SPAN.category].second += SPAN.duration;
+                (SPAN.category == "phase" ? phases : compiles).push_back(&SPAN);
+            }
+            sort(compiles.begin(), compiles.end(), [](const Span *A, const Span *B) { return A->duration > B->duration; });
+            const double LONGEST = compiles.empty() ? 1 : max(compiles.front()->duration, 1.0);
+
+            string html = R"""(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>cog build timings</title>
+<style>
+body { font-family: sans-serif; margin: 2em; color: #222; }
+table { border-collapse: collapse; margin-bottom: 2em; }
+th, td { text-align: left; padding: 0.2em 1em 0.2em 0; vertical-align: top; }
+td.number { text-align: right; font-variant-numeric: tabular-nums; }
+.bar { background: #4a90d9; height: 0.8em; margin-top: 0.3em; }
+pre { font-size: 0.8em; }
+</style></head><body>
+)""";
+            html += format("<h1>Build timings</h1>\n<p>Wall time: %.1f ms over %zu spans. Open <code>timings.json</code> in chrome://tracing or ui.perfetto.dev for the timeline.</p>\n", (last - first) / 1000, SPANS.size());
+
+            html += "<h2>Categories</h2>\n<table><tr><th>Category</th><th>Spans</th><th>Total ms</th></tr>\n";
+            for(const auto &[CATEGORY, TOTAL] : categories) {
+                html += format("<tr><td>%s</td><td class=\"number\">%zu</td><td class=\"number\">%.1f</td></tr>\n", escape_html(CATEGORY).c_str(), TOTAL.first, TOTAL.second / 1000);
+            }
+            html += "</table>\n";
+
+            html += "<h2>Phases</h2>\n<table><tr><th>Phase</th><th>Start ms</th><th>Duration ms</th></tr>\n";
+            for(const Span *pSpan : phases) {
+                html += format("<tr><td>%s</td><td class=\"number\">%.1f</td><td class=\"number\">%.1f</td></tr>\n", escape_html(pSpan->name).c_str(), pSpan->start / 1000, pSpan->duration / 1000);
+            }
+            html += "</table>\n";
+
+            html += "<h2>Jobs, slowest first</h2>\n<table><tr><th>Job</th><th>Category</th><th>Duration ms</th><th>Peak memory MB</th><th></th></tr>\n";
+            for(const Span *pSpan : compiles) {
+                html += format("<tr><td>%s", escape_html(pSpan->name).c_str());
+                if(!pSpan->details.empty()) {
+                    html += format("<details><summary>Compiler report</summary><pre>%s</pre></details>", escape_html(pSpan->details).c_str());
+                }
+                html += format("</td><td>%s</td><td class=\"number\">%.1f</td><td class=\"number\">%s</td><td style=\"width: 20em\"><div class=\"bar\" style=\"width: %.1f%%\"></div></td></tr>\n",
+                    escape_html(pSpan->category).c_str(), pSpan->duration / 1000, pSpan->peakMemory > 0 ? format("%.1f", pSpan->peakMemory / 1024.0).c_str() : "", 100 * pSpan->duration / LONGEST);
+            }
+            return html + "</table>\n</body></html>\n";
+        }
+    }
+
+    /// @brief Starts recording spans (nothing is recorded until then). With COMPILER_REPORTS, compiles also ask the compiler for its own time report
+    void enable(const bool COMPILER_REPORTS) {
+        lock_guard<mutex> lock(spansMutex);
+        if(!enabled) {
+            origin = chrono::steady_clock::now();
+        }
+        enabled = true;
+        compilerReports = COMPILER_REPORTS;
+    }
+
+    /// @brief True once enable has been called
+    bool is_enabled() {
+        return enabled;
+    }
+
+    /// @brief True if compiles should ask the compiler for its own time report
+    bool wants_compiler_reports() {
+        return compilerReports;
+    }
+
+    /// @brief Records the wall time between its construction and destruction as a span named NAME in CATEGORY (a no-op unless enabled).
+    /// Spans made on the same thread while another is open are nested inside it
+    Scope::Scope(const std::string NAME, const std::string CATEGORY): mActive(enabled) {
+        if(mActive) {
+            mName = NAME;
+            mCategory = CATEGORY;
+            mStart = now();
+        }
+    }
+
+    /// @brief Sets the peak resident memory in KB of the process this span waited on
+    void Scope::set_peak_memory(const size_t KB) {
+        mPeakMemory = KB;
+    }
+
+    /// @brief Attaches text shown with the span, like the compiler's time report
+    void Scope::set_details(const std::string DETAILS) {
+        mDetails = DETAILS;
+    }
+
+    /// @brief Ends the span now instead of when the scope is destroyed
+    void Scope::finish() {
+        if(!mActive) {
+            return;
+        }
+        mActive = false;
+        const double END = now();
+        lock_guard<mutex> lock(spansMutex);
+        const auto INSERTED = threads.insert({this_thread::get_id(), threads.size() + 1});
+        spans.push_back(Span {mName, mCategory, mDetails, mStart, END - mStart, INSERTED.first->second, mPeakMemory});
+    }
+
+    Scope::~Scope() {
+        finish();
+    }
+
+    /// @brief Writes the spans recorded so far to DIR/timings.json (Chrome trace format, for chrome://tracing or ui.perfetto.dev)
+    /// and a self-contained summary to DIR/timings.html, then forgets them. Returns the path of the summary
+    std::string write_reports(const std::string DIR) {
+        vector<Span> recorded;
+        {
+            lock_guard<mutex> lock(spansMutex);
+            recorded.swap(spans);
+        }
+        // Outer spans end last but should be listed before what they contain
+        sort(recorded.begin(), recorded.end(), [](const Span &A, const Span &B) { return A.start < B.start || (A.start == B.start && A.duration > B.duration); });
+
+        files::fwrite(DIR + "/timings.json", to_trace(recorded));
+        files::fwrite(DIR + "/timings.html", to_html(recorded));
+        return DIR + "/timings.html";
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef TIMINGS_H
+#define TIMINGS_H
+#include <cstddef>
+#include <string>
+
+namespace timings {
+    /// @brief Starts recording spans (nothing is recorded until then). With COMPILER_REPORTS, compiles also ask the compiler for its own time report
+    void enable(const bool COMPILER_REPORTS = false);
+
+    /// @brief True once enable has been called
+    bool is_enabled();
+
+    /// @brief True if compiles should ask the compiler for its own time report
+    bool wants_compiler_reports();
+
+    /// @brief Records the wall time between its construction and destruction as a span named NAME in CATEGORY (a no-op unless enabled).
+    /// Spans made on the same thread while another is open are nested inside it
+    class Scope final {
+        private:
+            std::string mName, mCategory, mDetails;
+            double mStart = 0;
+            size_t mPeakMemory = 0;
+            bool mActive = false;
+
+        public:
+            Scope(const std::string NAME, const std::string CATEGORY);
+
+            /// @brief Sets the peak resident memory in KB of the process this span waited on
+            void set_peak_memory(const size_t KB);
+
+            /// @brief Attaches text shown with the span, like the compiler's time report
+            void set_details(const std::string DETAILS);
+
+            /// @brief Ends the span now instead of when the scope is destroyed
+            void finish();
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+            ~Scope();
+    };
+
+    /// @brief Writes the spans recorded so far to DIR/timings.json (Chrome trace format, for chrome://tracing or ui.perfetto.dev)
+    /// and a self-contained summary to DIR/timings.html, then forgets them. Returns the path of the summary
+    std::string write_reports(const std::string DIR);
+}
+#endif
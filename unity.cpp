@@ -0,0 +1,93 @@
+#include "unity.h"
+
+#include <algorithm>
+#include <map>
+#include <system_error>
+#include <string>
+#include <vector>
+
+#include "filesystem.h"
+#include "dependencies.h"
+#include "files.h"
+#include "hashing.h"
+
+using namespace std;
+
+namespace fs = FILESYSTEM_NAMESPACE;
+
+namespace unity {
+    namespace {
+        /// @brief Hash of TEXT that is the same on every machine, unlike std::hash
+        size_t get_hash(const string &TEXT) {
+            return (size_t)stoull(hashing::digest(TEXT).substr(0, 16), nullptr, 16);
+        }
+    }
+
+    /// @brief True if SOURCE is one of EXCLUDES or inside a directory in EXCLUDES (all paths normalized)
+    bool is_excluded(const std::string &SOURCE, const std::vector<std::string> &EXCLUDES) {
+        for(const string &EXCLUDE : EXCLUDES) {
+            if(SOURCE == EXCLUDE || SOURCE.rfind(EXCLUDE + "/", 0) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Splits SOURCES into COUNT batches (some possibly empty) by directory, then by a hash of each path, so adding or removing a file
+    /// leaves the other batches as they were. A directory is spread over as many batches as its share of the sources needs, starting at one picked by a hash of its name
+    std::vector<std::vector<std::string>> make_batches(const std::vector<std::string> &SOURCES, const size_t COUNT) {
+        map<string, vector<string>> directories;
+        for(const string &SOURCE : SOURCES) {
+            directories[fs::path(SOURCE).parent_path().string()].push_back(SOURCE);
+        }
+
+        const size_t BATCHES = min(COUNT, SOURCES.size());
+        vector<vector<string>> batches(BATCHES);
+        if(BATCHES == 0) {
+            return batches;
+        }
+        // Only changes when the number of sources crosses a multiple of BATCHES
+        const size_t BATCH_SIZE = (SOURCES.size() + BATCHES - 1) / BATCHES;
+        for(auto &[DIRECTORY, sources] : directories) {
+            sort(sources.begin(), sources.end());
+            const size_t FIRST = get_hash(DIRECTORY) % BATCHES, SPAN = min(BATCHES, (sources.size() + BATCH_SIZE - 1) / BATCH_SIZE);
+            for(const string &SOURCE : sources) {
+                batches[(FIRST + get_hash(SOURCE) % SPAN) % BATCHES].push_back(SOURCE);
+            }
+        }
+        return batches;
+    }
+
+    /// @brief Writes one unity source per batch of SOURCES to BUILD_DIR (only rewriting those whose batch changed) and returns their paths.
+    /// Sources in EXCLUDES are not batched and are added to separate instead
+    std::vector<std::string> write_batches(const std::vector<std::string> &SOURCES, const size_t COUNT, const std::vector<std::string> &EXCLUDES, const std::string &BUILD_DIR, std::vector<std::string> &separate) {
+        vector<string> batched;
+        for(const string &SOURCE : SOURCES) {
+            (is_excluded(SOURCE, EXCLUDES) ? separate : batched).push_back(SOURCE);
+        }
+
+        vector<string> result;
+        const auto BATCHES = make_batches(batched, COUNT);
+        for(size_t i = 0; i < BATCHES.size(); i++) {
+            const string NAME = BUILD_DIR + "/__Unity" + to_string(i) + "__.cpp";
+            if(BATCHES[i].empty()) {
+                error_code error;
+                fs::remove(NAME, error);
+                continue;
+            }
+            string text = "// Generated by cog for build.unity, do not edit\n";
+            for(const string &SOURCE : BATCHES[i]) {
+                text += dependencies::include_directive(SOURCE, BUILD_DIR);
+            }
+            files::fwrite_if_changed(NAME, text);
+            result.push_back(NAME);
+        }
+
+        // Batches left over from a larger build.unity would never be compiled again
+        error_code error;
+        for(size_t i = BATCHES.size(); fs::exists(BUILD_DIR + "/__Unity" + to_string(i) + "__.cpp", error); i++) {
+            fs::remove(BUILD_DIR + "/__Unity" + to_string(i) + "__.cpp", error);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,18 @@
+#ifndef UNITY_H
+#define UNITY_H
+#include <string>
+#include <vector>
+
+namespace unity {
+    /// @brief True if SOURCE is one of EXCLUDES or inside a directory in EXCLUDES (all paths normalized)
+    bool is_excluded(const std::string &SOURCE, const std::vector<std::string> &EXCLUDES);
+
+    /// @brief Splits SOURCES into COUNT batches (some possibly empty) by directory, then by a hash of each path, so adding or removing a file
+    /// leaves the other batches as they were. A directory is spread over as many batches as its share of the sources needs, starting at one picked by a hash of its name
+    std::vector<std::vector<std::string>> make_batches(const std::vector<std::string> &SOURCES, const size_t COUNT);
+
+    /// @brief Writes one unity source per batch of SOURCES to BUILD_DIR (only rewriting those whose batch changed) and returns their paths.
+    /// Sources in EXCLUDES are not batched and are added to separate instead
+    std::vector<std::string> write_batches(const std::vector<std::string> &SOURCES, const size_t COUNT, const std::vector<std::string> &EXCLUDES, const std::string &BUILD_DIR, std::vector<std::string> &separate);
+}
+#endif